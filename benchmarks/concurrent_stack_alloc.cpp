@@ -0,0 +1,74 @@
+// NOLINTBEGIN
+
+#include "trutils/concurrent_stack_alloc.hpp"
+#include "trutils/stack_alloc.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+using namespace tr;
+
+namespace {
+
+/// StackAlloc behind a mutex, the baseline for sharing one arena between threads.
+class locked_stack_alloc {
+  public:
+   void *allocate(size_t size, size_t alignment) {
+      std::lock_guard lock(mMutex);
+      return mAlloc.allocate(size, alignment);
+   }
+   void reset() { mAlloc.reset(); }
+
+  private:
+   std::mutex mMutex;
+   StackAlloc<> mAlloc;
+};
+
+/// Fixed per-thread iteration count: the arena is only reset between runs, when no thread is
+/// allocating, so the count bounds how much memory a run can use.
+constexpr int64_t ITERATIONS = 50000;
+constexpr size_t ALLOC_SIZE = 24;
+
+template<typename Arena>
+std::unique_ptr<Arena> gArena;
+
+template<typename Arena>
+void setup(const benchmark::State &) {
+   gArena<Arena> = std::make_unique<Arena>();
+}
+
+template<typename Arena>
+void teardown(const benchmark::State &) {
+   gArena<Arena>.reset();
+}
+
+template<typename Arena>
+void BM_SharedAllocate(benchmark::State &state) {
+   Arena &arena = *gArena<Arena>;
+   for (auto _ : state) {
+      auto *p = static_cast<std::byte *>(arena.allocate(ALLOC_SIZE, alignof(std::max_align_t)));
+      *p = std::byte {1};
+      benchmark::DoNotOptimize(p);
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(BM_SharedAllocate<ConcurrentStackAlloc<>>)
+    ->Setup(setup<ConcurrentStackAlloc<>>)
+    ->Teardown(teardown<ConcurrentStackAlloc<>>)
+    ->Iterations(ITERATIONS)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+BENCHMARK(BM_SharedAllocate<locked_stack_alloc>)
+    ->Setup(setup<locked_stack_alloc>)
+    ->Teardown(teardown<locked_stack_alloc>)
+    ->Iterations(ITERATIONS)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+// NOLINTEND
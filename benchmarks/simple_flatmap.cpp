@@ -0,0 +1,74 @@
+// NOLINTBEGIN
+
+#include "trutils/simple_flatmap.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+template<typename K, typename H, typename E>
+using open_addressing = open_addressing_index<K, H, E>;
+
+template<typename K, typename H, typename E>
+using chained = unordered_index<K, H, E>;
+
+template<template<typename, typename, typename> class Index>
+using flatmap_type = simple_flatmap<uint64_t, uint64_t, std::hash<uint64_t>,
+                                    std::equal_to<uint64_t>, Index>;
+
+/// Keys spread over the full 64-bit range so the hash sees realistic ids, in random order.
+std::vector<uint64_t> make_keys(size_t count) {
+   std::vector<uint64_t> keys(count);
+   std::mt19937_64 rng {42};
+   for (auto &key : keys) { key = rng(); }
+   return keys;
+}
+
+template<typename Map>
+void run_lookups(benchmark::State &state, const Map &map, const std::vector<uint64_t> &keys) {
+   size_t next = 0;
+   for (auto _ : state) {
+      benchmark::DoNotOptimize(map.find(keys[next]));
+      if (++next == keys.size()) { next = 0; }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<template<typename, typename, typename> class Index>
+void BM_FlatmapLookup(benchmark::State &state) {
+   auto keys = make_keys(static_cast<size_t>(state.range(0)));
+   flatmap_type<Index> map;
+   map.reserve(keys.size());
+   for (const uint64_t key : keys) { map.insert(key, key); }
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {7});
+   run_lookups(state, map, keys);
+}
+
+void BM_UnorderedMapLookup(benchmark::State &state) {
+   auto keys = make_keys(static_cast<size_t>(state.range(0)));
+   std::unordered_map<uint64_t, uint64_t> map;
+   map.reserve(keys.size());
+   for (const uint64_t key : keys) { map.emplace(key, key); }
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {7});
+   run_lookups(state, map, keys);
+}
+
+constexpr int64_t MIN_SIZE = 1'000;
+constexpr int64_t MAX_SIZE = 10'000'000;
+
+} // namespace
+
+BENCHMARK(BM_FlatmapLookup<open_addressing>)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_FlatmapLookup<chained>)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_UnorderedMapLookup)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+
+// NOLINTEND
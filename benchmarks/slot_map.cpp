@@ -0,0 +1,131 @@
+// NOLINTBEGIN
+
+#include "trutils/slot_map.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+using key_type = Key<DefaultTag>;
+using map_type = SlotMap<key_type, uint64_t>;
+
+void BM_SlotMapGetRandom(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_type map;
+   map.reserve(count);
+   std::vector<key_type> keys;
+   keys.reserve(count);
+   for (uint64_t i = 0; i < count; ++i) { keys.push_back(map.insert(i)); }
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {42});
+
+   size_t next = 0;
+   for (auto _ : state) {
+      benchmark::DoNotOptimize(map.get(keys[next]));
+      if (++next == count) { next = 0; }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/// Copies the values of every key, in random order, one get() at a time.
+void BM_SlotMapGetLoop(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_type map;
+   map.reserve(count);
+   std::vector<key_type> keys;
+   keys.reserve(count);
+   for (uint64_t i = 0; i < count; ++i) { keys.push_back(map.insert(i)); }
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {42});
+
+   std::vector<uint64_t> values(count);
+   for (auto _ : state) {
+      for (size_t i = 0; i < count; ++i) { values[i] = map.get(keys[i]); }
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// BM_SlotMapGetLoop through the prefetching get_many.
+void BM_SlotMapGetMany(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_type map;
+   map.reserve(count);
+   std::vector<key_type> keys;
+   keys.reserve(count);
+   for (uint64_t i = 0; i < count; ++i) { keys.push_back(map.insert(i)); }
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {42});
+
+   std::vector<uint64_t> values(count);
+   for (auto _ : state) {
+      map.get_many(keys, values.begin());
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// Gathers a 4-byte hot field of 64-byte values, against gathering whole values.
+template<bool Hot>
+void BM_SplitSlotMapGather(benchmark::State &state) {
+   struct value_type {
+      uint32_t hot;
+      uint32_t cold[15];
+   };
+   auto project = [](const value_type &value) { return value.hot; };
+   const auto count = static_cast<size_t>(state.range(0));
+   SplitSlotMap<key_type, value_type, decltype(project)> map(project);
+   map.reserve(count);
+   std::vector<key_type> keys;
+   keys.reserve(count);
+   for (uint32_t i = 0; i < count; ++i) { keys.push_back(map.insert(value_type {i, {}})); }
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {42});
+
+   std::vector<uint32_t> hot(count);
+   std::vector<value_type> values(Hot ? 0 : count);
+   for (auto _ : state) {
+      if constexpr (Hot) {
+         map.get_hot_many(keys, hot.begin());
+      } else {
+         map.get_many(keys, values.begin());
+      }
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// Steady-state churn: remove a random live value and insert a replacement at a constant size.
+void BM_SlotMapRemoveInsert(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_type map;
+   map.reserve(count);
+   std::vector<key_type> keys;
+   keys.reserve(count);
+   for (uint64_t i = 0; i < count; ++i) { keys.push_back(map.insert(i)); }
+
+   std::mt19937_64 rng {7};
+   for (auto _ : state) {
+      const size_t victim = rng() % count;
+      benchmark::DoNotOptimize(map.remove(keys[victim]));
+      keys[victim] = map.insert(victim);
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+constexpr int64_t MIN_SIZE = 1'000;
+constexpr int64_t MAX_SIZE = 10'000'000;
+
+} // namespace
+
+BENCHMARK(BM_SlotMapGetRandom)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_SlotMapGetLoop)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_SlotMapGetMany)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_SplitSlotMapGather<true>)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_SplitSlotMapGather<false>)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_SlotMapRemoveInsert)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+
+// NOLINTEND
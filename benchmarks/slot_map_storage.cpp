@@ -0,0 +1,107 @@
+// NOLINTBEGIN
+
+#include "trutils/slot_map.hpp"
+#include "trutils/slot_map_storage.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+using key_type = Key<DefaultTag>;
+
+template<typename T>
+using inline_64k = inline_vector<T, 65536>;
+
+/// Builds a map of the storage under test; pmr maps draw from a per-benchmark pool. Maps are
+/// default-initialized on the heap so inline storage is neither zero-filled nor put on the stack.
+template<template<typename> class Storage>
+struct map_factory {
+   using map_type = SlotMap<key_type, uint64_t, Storage>;
+   std::unique_ptr<map_type> make() { return std::unique_ptr<map_type>(new map_type); }
+};
+
+template<>
+struct map_factory<std::pmr::vector> {
+   using map_type = SlotMap<key_type, uint64_t, std::pmr::vector>;
+   std::pmr::unsynchronized_pool_resource pool;
+   std::unique_ptr<map_type> make() {
+      return std::make_unique<map_type>(std::pmr::vector<uint64_t>(&pool));
+   }
+};
+
+template<template<typename> class Storage>
+void BM_Insert(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_factory<Storage> factory;
+   for (auto _ : state) {
+      auto map = factory.make();
+      for (uint64_t i = 0; i < count; ++i) { benchmark::DoNotOptimize(map->insert(i)); }
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+template<template<typename> class Storage>
+void BM_RemoveRandom(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_factory<Storage> factory;
+   std::vector<key_type> keys;
+   keys.reserve(count);
+   for (auto _ : state) {
+      state.PauseTiming();
+      auto map = factory.make();
+      keys.clear();
+      for (uint64_t i = 0; i < count; ++i) { keys.push_back(map->insert(i)); }
+      std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {42});
+      state.ResumeTiming();
+
+      for (const auto key : keys) { benchmark::DoNotOptimize(map->remove(key)); }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+template<template<typename> class Storage>
+void BM_Iterate(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   map_factory<Storage> factory;
+   auto map = factory.make();
+   for (uint64_t i = 0; i < count; ++i) { (void)map->insert(i); }
+   for (auto _ : state) {
+      uint64_t sum = 0;
+      for (const uint64_t value : *map) { sum += value; }
+      benchmark::DoNotOptimize(sum);
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+constexpr int64_t MIN_SIZE = 1 << 10;
+constexpr int64_t MAX_SIZE = 1 << 20;
+constexpr int64_t MAX_INLINE_SIZE = 1 << 16;
+
+} // namespace
+
+BENCHMARK(BM_Insert<std::vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_Insert<chunked_vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_Insert<std::pmr::vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_Insert<inline_64k>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_INLINE_SIZE);
+
+BENCHMARK(BM_RemoveRandom<std::vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_RemoveRandom<chunked_vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_RemoveRandom<std::pmr::vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_RemoveRandom<inline_64k>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_INLINE_SIZE);
+
+BENCHMARK(BM_Iterate<std::vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_Iterate<chunked_vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_Iterate<std::pmr::vector>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_Iterate<inline_64k>)->RangeMultiplier(8)->Range(MIN_SIZE, MAX_INLINE_SIZE);
+
+// NOLINTEND
@@ -0,0 +1,66 @@
+// NOLINTBEGIN
+
+#include "trutils/stack_alloc.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+constexpr size_t ALLOC_SIZE = 48;
+
+/// One frame: range(0) small allocations, then everything is released at once.
+void BM_StackAllocFrame(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   StackAlloc<> arena;
+   for (auto _ : state) {
+      for (size_t i = 0; i < count; ++i) {
+         benchmark::DoNotOptimize(arena.allocate(ALLOC_SIZE, alignof(std::max_align_t)));
+      }
+      arena.reset();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_NewDeleteFrame(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   std::vector<void *> live(count);
+   for (auto _ : state) {
+      for (size_t i = 0; i < count; ++i) {
+         live[i] = ::operator new(ALLOC_SIZE);
+         benchmark::DoNotOptimize(live[i]);
+      }
+      for (void *p : live) { ::operator delete(p, ALLOC_SIZE); }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// release() hands the buffers back upstream, whereas StackAlloc::reset keeps its blocks.
+void BM_PmrMonotonicFrame(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   std::pmr::monotonic_buffer_resource arena;
+   for (auto _ : state) {
+      for (size_t i = 0; i < count; ++i) {
+         benchmark::DoNotOptimize(arena.allocate(ALLOC_SIZE, alignof(std::max_align_t)));
+      }
+      arena.release();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+constexpr int64_t MIN_SIZE = 1'000;
+constexpr int64_t MAX_SIZE = 10'000'000;
+
+} // namespace
+
+BENCHMARK(BM_StackAllocFrame)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_NewDeleteFrame)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_PmrMonotonicFrame)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+
+// NOLINTEND
@@ -0,0 +1,266 @@
+// NOLINTBEGIN
+
+#include "trutils/table.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+using table_type = table<>;
+using column_key = table_type::column_key;
+
+struct position {
+   float x, y, z;
+};
+
+/// A table with an int and a position row and @p count columns, plus its keys in random order.
+struct filled_table {
+   explicit filled_table(size_t count) {
+      (void)tab.create_row<int>();
+      (void)tab.create_row<position>();
+      keys.reserve(count);
+      tab.insert_columns(count, std::back_inserter(keys));
+      auto ints = tab.get_row<int>();
+      for (size_t i = 0; i < ints.size(); ++i) { ints[i] = static_cast<int>(i); }
+      std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {42});
+   }
+
+   table_type tab;
+   std::vector<column_key> keys;
+};
+
+void BM_TableInsertEraseChurn(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   std::mt19937_64 rng {7};
+   for (auto _ : state) {
+      const size_t victim = rng() % count;
+      benchmark::DoNotOptimize(filled.tab.erase_column(filled.keys[victim]));
+      filled.keys[victim] = filled.tab.insert_column();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void BM_TableIterateColumnsIter(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   const table_type &tab = filled.tab;
+   for (auto _ : state) {
+      int64_t sum = 0;
+      for (auto it = tab.columns_begin<int>(); it != tab.columns_end<int>(); ++it) {
+         sum += std::get<0>((*it).second);
+      }
+      benchmark::DoNotOptimize(sum);
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_TableIterateGetRow(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   const table_type &tab = filled.tab;
+   for (auto _ : state) {
+      int64_t sum = 0;
+      for (const int value : tab.get_row<int>()) { sum += value; }
+      benchmark::DoNotOptimize(sum);
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_TableRandomCell(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   const table_type &tab = filled.tab;
+   size_t next = 0;
+   for (auto _ : state) {
+      benchmark::DoNotOptimize(tab.cell<int>(filled.keys[next]));
+      if (++next == count) { next = 0; }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/// Fills a whole row through its ty_kernels, knowing only its ty_id.
+void BM_TableFillRowUntyped(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   const position value {1.0F, 2.0F, 3.0F};
+   for (auto _ : state) {
+      filled.tab.fill_row(getTypeID<position>(), &value);
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// BM_TableFillRowUntyped with T known at the call site.
+void BM_TableFillRowTyped(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   const position value {1.0F, 2.0F, 3.0F};
+   for (auto _ : state) {
+      std::ranges::fill(filled.tab.get_row<position>(), value);
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+void BM_TableHashRow(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   for (auto _ : state) { benchmark::DoNotOptimize(filled.tab.hash_row(getTypeID<int>())); }
+   state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(int)));
+}
+
+/// row_hash() after one cell write, which rehashes only that cell's chunk; compare BM_TableHashRow.
+void BM_TableRowHashIncremental(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   filled.tab.track_hashes<int>();
+   size_t next = 0;
+   for (auto _ : state) {
+      ++filled.tab.cell<int>(filled.keys[next]);
+      if (++next == count) { next = 0; }
+      benchmark::DoNotOptimize(filled.tab.row_hash<int>());
+   }
+   state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(int)));
+}
+
+/// publish() after one cell write, which copies only that cell's chunk into the back buffer.
+void BM_TablePublishFewWrites(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   filled.tab.buffer_row<int>();
+   auto reader = filled.tab.reader<int>();
+   size_t next = 0;
+   for (auto _ : state) {
+      ++filled.tab.cell<int>(filled.keys[next]);
+      if (++next == count) { next = 0; }
+      filled.tab.publish<int>();
+      benchmark::DoNotOptimize(reader.acquire().values().data());
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/// The copy-the-whole-row alternative to BM_TablePublishFewWrites.
+void BM_TableCopyRow(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   filled_table filled(count);
+   std::vector<int> copy(count);
+   size_t next = 0;
+   for (auto _ : state) {
+      ++filled.tab.cell<int>(filled.keys[next]);
+      if (++next == count) { next = 0; }
+      std::ranges::copy(filled.tab.get_row<int>(), copy.begin());
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+/// Grows a table one insert_column() at a time from empty, letting every row and the column mapping
+/// double as they go.
+void BM_TableGrowColumns(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   for (auto _ : state) {
+      table_type tab;
+      (void)tab.create_row<int>();
+      (void)tab.create_row<position>();
+      for (size_t i = 0; i < count; ++i) { benchmark::DoNotOptimize(tab.insert_column()); }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// BM_TableGrowColumns after reserve_columns(), which leaves no reallocation in the loop.
+void BM_TableGrowColumnsReserved(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   for (auto _ : state) {
+      table_type tab;
+      tab.reserve_columns(count);
+      (void)tab.create_row<int>();
+      (void)tab.create_row<position>();
+      for (size_t i = 0; i < count; ++i) { benchmark::DoNotOptimize(tab.insert_column()); }
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+
+/// Puts the columns of @p tab in a random dense order, as after long insert/erase churn.
+void shuffle_columns(table_type &tab, uint64_t seed) {
+   std::vector<size_t> order(tab.column_count());
+   std::iota(order.begin(), order.end(), size_t {0});
+   std::shuffle(order.begin(), order.end(), std::mt19937_64 {seed});
+   tab.reorder_columns(order);
+}
+
+/// A filled_table, and a second table sharing its key space that holds every other column. Both
+/// dense orders are shuffled.
+struct joined_tables {
+   explicit joined_tables(size_t count) : left(count) {
+      (void)right.create_row<position>();
+      std::vector<column_key> keys;
+      keys.reserve(count);
+      right.insert_columns(count, std::back_inserter(keys));
+      for (size_t i = 0; i < keys.size(); i += 2) { (void)right.erase_column(keys[i]); }
+      shuffle_columns(left.tab, 1);
+      shuffle_columns(right, 2);
+   }
+
+   filled_table left;
+   table_type right;
+};
+
+/// Joining by hand: contains_column() and cell() on the second table for every column.
+void BM_TableJoinLookup(benchmark::State &state) {
+   joined_tables tables(static_cast<size_t>(state.range(0)));
+   for (auto _ : state) {
+      float sum = 0.0F;
+      tables.left.tab.query<int>().for_each([&](column_key key, int &i) {
+         if (tables.right.contains_column(key)) {
+            sum += static_cast<float>(i) + tables.right.cell<position>(key).x;
+         }
+      });
+      benchmark::DoNotOptimize(sum);
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+
+/// BM_TableJoinLookup through join(), driven from the smaller table with batched prefetching.
+void BM_TableJoin(benchmark::State &state) {
+   joined_tables tables(static_cast<size_t>(state.range(0)));
+   for (auto _ : state) {
+      float sum = 0.0F;
+      join(tables.left.tab, tables.right).query<int, position>().for_each([&](int &i, position &p) {
+         sum += static_cast<float>(i) + p.x;
+      });
+      benchmark::DoNotOptimize(sum);
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * state.range(0)));
+}
+
+constexpr int64_t MIN_SIZE = 1'000;
+constexpr int64_t MAX_SIZE = 10'000'000;
+
+} // namespace
+
+BENCHMARK(BM_TableInsertEraseChurn)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableIterateColumnsIter)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableIterateGetRow)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableRandomCell)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableFillRowUntyped)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableFillRowTyped)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableHashRow)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableRowHashIncremental)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TablePublishFewWrites)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableCopyRow)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableGrowColumns)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableGrowColumnsReserved)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableJoinLookup)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_TableJoin)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+
+// NOLINTEND
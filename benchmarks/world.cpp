@@ -0,0 +1,80 @@
+// NOLINTBEGIN
+
+#include "trutils/table.hpp"
+#include "trutils/world.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+
+using namespace tr;
+
+namespace {
+
+struct position {
+   float x, y, z;
+};
+
+struct velocity {
+   float dx, dy, dz;
+};
+
+/// One entity in this many has a velocity.
+constexpr size_t MOVER_RATIO = 10;
+
+/// Integrates the movers of a world, which only visits the {position, velocity} archetype.
+void BM_WorldQueryMovers(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   world<> w;
+   for (size_t i = 0; i < count; ++i) {
+      const auto e = w.create();
+      w.add<position>(e);
+      if (i % MOVER_RATIO == 0) { w.add<velocity>(e, {1.0F, 2.0F, 3.0F}); }
+   }
+   for (auto _ : state) {
+      w.for_each<position, velocity>([](position &p, const velocity &v) {
+         p.x += v.dx;
+         p.y += v.dy;
+         p.z += v.dz;
+      });
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (count / MOVER_RATIO)));
+}
+
+/// The same update on one flat table, where every column has both rows and a flag selects movers.
+void BM_FlatTableQueryMovers(benchmark::State &state) {
+   const auto count = static_cast<size_t>(state.range(0));
+   table<> tab;
+   (void)tab.create_row<position>();
+   (void)tab.create_row<velocity>();
+   (void)tab.create_row<uint8_t>();
+   for (size_t i = 0; i < count; ++i) {
+      const auto key = tab.insert_column();
+      if (i % MOVER_RATIO == 0) {
+         tab.cell<velocity>(key) = {1.0F, 2.0F, 3.0F};
+         tab.cell<uint8_t>(key) = 1;
+      }
+   }
+   for (auto _ : state) {
+      tab.query<position, velocity, uint8_t>().for_each(
+          [](position &p, const velocity &v, const uint8_t moves) {
+             if (!moves) { return; }
+             p.x += v.dx;
+             p.y += v.dy;
+             p.z += v.dz;
+          });
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (count / MOVER_RATIO)));
+}
+
+constexpr int64_t MIN_SIZE = 1'000;
+constexpr int64_t MAX_SIZE = 10'000'000;
+
+} // namespace
+
+BENCHMARK(BM_WorldQueryMovers)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+BENCHMARK(BM_FlatTableQueryMovers)->RangeMultiplier(10)->Range(MIN_SIZE, MAX_SIZE);
+
+// NOLINTEND
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "dense_bitset.hpp"
+#include "sparse_set.hpp"
+#include "untyped_vector.hpp"
+
+namespace tr {
+
+/// @brief Three copies of one table row, handed from a single writer thread to a single reader
+/// thread without locks (a triple buffer).
+///
+/// The writer owns the live row and a back copy. publish() brings the back copy up to date and
+/// swaps it with the middle slot in one atomic exchange; the reader's acquire() swaps the middle
+/// slot with its front copy when a newer frame is waiting. Neither side ever waits on the other,
+/// and the front copy stays untouched until the reader acquires again.
+///
+/// Each copy keeps the column mapping it was published with, so readers can map column keys to
+/// dense indices of that frame. Copies remember which chunks of BUFFER_CHUNK_BYTES were written
+/// since they were last published and copy only those; a change of column layout makes the next
+/// publish of each copy a full copy.
+/// @tparam KeyType The table's column_key.
+template<typename KeyType>
+class buffered_row {
+  public:
+   using Mapping = SparseSet<KeyType>;
+
+   static constexpr size_t BUFFER_CHUNK_BYTES = 4096;
+   static constexpr size_t COPIES = 3;
+
+   /// @brief Fills every copy from @p live and @p mapping, so readers see the current state
+   /// before the first publish.
+   buffered_row(const untyped_vector &live, const Mapping &mapping) :
+       mCellsPerChunk(std::max<size_t>(1, BUFFER_CHUNK_BYTES / live.stride())),
+       mCopies {live, live, live} {
+      for (size_t i = 0; i < COPIES; ++i) {
+         mMappings[i] = mapping;
+         mStale[i].resize(chunk_count(live.size()));
+      }
+   }
+
+   /// Called by the writer for every cell written in the live row.
+   void invalidate(size_t cell) {
+      for (dense_bitset &stale : mStale) { stale.set(cell / mCellsPerChunk); }
+   }
+
+   void invalidate(size_t first, size_t count) {
+      if (count == 0) { return; }
+      const size_t firstChunk = first / mCellsPerChunk;
+      const size_t chunks = ((first + count - 1) / mCellsPerChunk) - firstChunk + 1;
+      for (dense_bitset &stale : mStale) { stale.set(firstChunk, chunks); }
+   }
+
+   void invalidate_all() {
+      for (dense_bitset &stale : mStale) { stale.set(0, stale.size()); }
+   }
+
+   /// @brief Called by the writer whenever columns are inserted, erased or reordered, with the
+   /// live row's new @p cells count.
+   ///
+   /// The stale bits of every copy are resized right away so writes before the next publish stay in
+   /// range; their contents no longer matter, as each copy's next publish is a full copy.
+   void relayout(size_t cells) {
+      mRelayout.fill(true);
+      for (dense_bitset &stale : mStale) { stale.resize(chunk_count(cells)); }
+   }
+
+   /// @brief Publishes @p live, laid out by @p mapping, as the newest frame. Writer thread only.
+   void publish(const untyped_vector &live, const Mapping &mapping) {
+      untyped_vector &back = mCopies[mBack];
+      dense_bitset &stale = mStale[mBack];
+      if (mRelayout[mBack]) {
+         back = live;
+         mMappings[mBack] = mapping;
+         stale.resize(chunk_count(live.size()));
+         stale.reset_all();
+         mRelayout[mBack] = false;
+      } else {
+         const std::span<const std::byte> src = live.bytes();
+         const std::span<std::byte> dst = back.bytes();
+         const size_t chunkBytes = mCellsPerChunk * live.stride();
+         stale.for_each_set([&](size_t chunk) {
+            const size_t first = chunk * chunkBytes;
+            std::memcpy(dst.data() + first, src.data() + first,
+                        std::min(chunkBytes, src.size() - first));
+         });
+         stale.reset_all();
+      }
+      mVersions[mBack] = ++mPublished;
+      const uint8_t previous =
+          mMiddle.exchange(static_cast<uint8_t>(mBack | FRESH), std::memory_order_acq_rel);
+      mBack = previous & INDEX_MASK;
+   }
+
+   /// @brief Makes the newest published frame the front copy, if one arrived since the last call.
+   /// Reader thread only.
+   /// @return Index of the front copy.
+   size_t acquire() {
+      if (mMiddle.load(std::memory_order_relaxed) & FRESH) {
+         const uint8_t previous =
+             mMiddle.exchange(static_cast<uint8_t>(mFront), std::memory_order_acq_rel);
+         mFront = previous & INDEX_MASK;
+      }
+      return mFront;
+   }
+
+   const untyped_vector &copy(size_t idx) const { return mCopies[idx]; }
+   const Mapping &mapping(size_t idx) const { return mMappings[idx]; }
+   uint64_t version(size_t idx) const { return mVersions[idx]; }
+
+   /// Number of publish() calls so far. Writer thread only.
+   uint64_t published() const { return mPublished; }
+
+   /// Bytes of heap storage held by the copies, their mappings and stale bits. Writer thread only.
+   size_t memory_usage() const {
+      size_t bytes = 0;
+      for (size_t i = 0; i < COPIES; ++i) {
+         bytes += mCopies[i].memory_usage() + mMappings[i].memory_usage() +
+                  mStale[i].memory_usage();
+      }
+      return bytes;
+   }
+
+  private:
+   static constexpr uint8_t FRESH = 4;
+   static constexpr uint8_t INDEX_MASK = 3;
+
+   size_t chunk_count(size_t cells) const { return (cells + mCellsPerChunk - 1) / mCellsPerChunk; }
+
+   size_t mCellsPerChunk;
+   std::array<untyped_vector, COPIES> mCopies;
+   std::array<Mapping, COPIES> mMappings;
+   std::array<uint64_t, COPIES> mVersions {};
+
+   // Writer-side state.
+   std::array<dense_bitset, COPIES> mStale; ///< Chunks of each copy written since its publish.
+   std::array<bool, COPIES> mRelayout {};   ///< Copies whose column layout is out of date.
+   uint64_t mPublished {0};
+   size_t mBack {0};
+
+   /// Index of the middle copy, plus FRESH while it holds a frame the reader has not taken.
+   std::atomic<uint8_t> mMiddle {1};
+
+   // Reader-side state.
+   size_t mFront {2};
+};
+
+/// @brief One published frame of a buffered row, as seen by its reader.
+///
+/// Valid until the reader's next acquire(), or until the row stops being buffered.
+template<typename T, typename KeyType>
+class published_row {
+  public:
+   using key_type = KeyType;
+   using Mapping = SparseSet<KeyType>;
+
+   published_row(const untyped_vector &cells, const Mapping &mapping, uint64_t version) :
+       mCells(cells.data<T>()), mMapping(&mapping), mVersion(version) {}
+
+   /// Cells in the dense order of this frame's columns.
+   std::span<const T> values() const { return mCells; }
+
+   size_t size() const { return mCells.size(); }
+
+   /// How many frames had been published when this one was, counting itself; 0 before the first
+   /// publish.
+   uint64_t version() const { return mVersion; }
+
+   bool contains(key_type key) const { return mMapping->contains(key); }
+
+   /// @brief Dense index of @p key in this frame.
+   /// @throws std::out_of_range if @p key was not a live column when the frame was published.
+   size_t index_of(key_type key) const { return static_cast<size_t>(mMapping->get(key)); }
+
+   /// @throws std::out_of_range if @p key was not a live column when the frame was published.
+   const T &at(key_type key) const { return mCells[index_of(key)]; }
+
+  private:
+   std::span<const T> mCells;
+   const Mapping *mMapping;
+   uint64_t mVersion;
+};
+
+/// @brief Handle through which the reader thread takes frames of a buffered row.
+///
+/// Only one thread may acquire from a row at a time. Invalid once the row stops being buffered or
+/// the table is destroyed.
+template<typename T, typename KeyType>
+class published_row_reader {
+  public:
+   explicit published_row_reader(buffered_row<KeyType> &row) : mRow(&row) {}
+
+   /// @brief Returns the newest published frame without blocking the writer.
+   published_row<T, KeyType> acquire() {
+      const size_t idx = mRow->acquire();
+      return published_row<T, KeyType>(mRow->copy(idx), mRow->mapping(idx), mRow->version(idx));
+   }
+
+  private:
+   buffered_row<KeyType> *mRow;
+};
+
+} // namespace tr
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "dense_bitset.hpp"
+#include "type_id.hpp"
+
+namespace tr {
+
+/// @brief Chunks of one table row that differ from another table; see table::diff.
+struct row_diff {
+   ty_id row {};               ///< Type id of the row.
+   size_t cells_per_chunk {0}; ///< Chunk c starts at dense index c * cells_per_chunk.
+   std::vector<size_t> chunks; ///< Indices of the differing chunks, ascending.
+};
+
+/// @brief Lazily refreshed hashes of the fixed-size chunks of one row's bytes.
+///
+/// A row is cut into chunks of whole cells spanning about CHUNK_BYTES bytes. Writers report the
+/// cells they touch with invalidate(), which only flips a bit; refresh() rehashes just the stale
+/// chunks. Hashes cover the raw cell bytes, so two rows match exactly when their bytes do, padding
+/// included.
+class row_chunk_hashes {
+  public:
+   static constexpr size_t CHUNK_BYTES = 4096;
+
+   /// @param stride Distance in bytes between consecutive cells of the row.
+   /// @param cell_count Number of cells the row holds; every chunk starts stale.
+   row_chunk_hashes(size_t stride, size_t cell_count) :
+       mStride(stride), mCellsPerChunk(std::max<size_t>(1, CHUNK_BYTES / stride)) {
+      resize(cell_count);
+   }
+
+   size_t cells_per_chunk() const { return mCellsPerChunk; }
+   size_t chunk_bytes() const { return mCellsPerChunk * mStride; }
+   size_t chunk_count() const { return mHashes.size(); }
+   size_t cell_count() const { return mCells; }
+
+   /// Bytes of heap storage held, spare capacity included.
+   size_t memory_usage() const {
+      return (mHashes.capacity() * sizeof(uint64_t)) + mStale.memory_usage();
+   }
+
+   void invalidate(size_t cell) { mStale.set(cell / mCellsPerChunk); }
+
+   void invalidate(size_t first, size_t count) {
+      if (count == 0) { return; }
+      const size_t firstChunk = first / mCellsPerChunk;
+      mStale.set(firstChunk, ((first + count - 1) / mCellsPerChunk) - firstChunk + 1);
+   }
+
+   void invalidate_all() { mStale.set(0, mStale.size()); }
+
+   /// @brief Follows the row growing or shrinking to @p cell_count cells. Added chunks and the
+   /// old and new last chunks, whose extents change, become stale.
+   void resize(size_t cell_count) {
+      if (cell_count == mCells) { return; }
+      if (mCells != 0) { invalidate(mCells - 1); }
+      mCells = cell_count;
+      const size_t chunks = (cell_count + mCellsPerChunk - 1) / mCellsPerChunk;
+      mHashes.resize(chunks);
+      mStale.resize(chunks, true);
+      if (cell_count != 0) { invalidate(cell_count - 1); }
+   }
+
+   /// @brief Follows untyped_vector::swap_and_pop(@p cell) on the row.
+   void swap_and_pop(size_t cell) {
+      invalidate(cell);
+      resize(mCells - 1);
+   }
+
+   /// @brief Rehashes the stale chunks of @p bytes, the row's storage, and returns every hash.
+   std::span<const uint64_t> refresh(std::span<const std::byte> bytes) {
+      mStale.for_each_set([&](size_t chunk) { mHashes[chunk] = hash_chunk(bytes, chunk); });
+      mStale.reset_all();
+      return mHashes;
+   }
+
+   /// Bytes of chunk @p chunk within @p bytes, the row's storage.
+   std::span<const std::byte> chunk_of(std::span<const std::byte> bytes, size_t chunk) const {
+      const size_t first = chunk * chunk_bytes();
+      return bytes.subspan(first, std::min(chunk_bytes(), bytes.size() - first));
+   }
+
+   uint64_t hash_chunk(std::span<const std::byte> bytes, size_t chunk) const {
+      const auto data = chunk_of(bytes, chunk);
+      return hash_bytes(data.data(), data.size(), 0);
+   }
+
+  private:
+   size_t mStride;
+   size_t mCellsPerChunk;
+   size_t mCells {0};
+   std::vector<uint64_t> mHashes;
+   dense_bitset mStale; ///< One bit per chunk whose hash is out of date.
+};
+
+} // namespace tr
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "slot_map.hpp"
+#include "stack_alloc.hpp"
+#include "strong_typedef.hpp"
+#include "table.hpp"
+#include "type_id.hpp"
+
+namespace tr {
+
+/// Handle to a column recorded with command_buffer::create(). It is only meaningful to the buffer
+/// that returned it and is resolved to a real column_key during playback.
+using pending_column = strong_typedef<struct pending_column_tag, size_t>;
+
+/// @brief Records structural table mutations for later, batched playback.
+///
+/// Creates, erases and cell writes are appended to a StackAlloc-backed log instead of touching the
+/// table, so worker threads can record them while other threads iterate. A command_buffer is not
+/// synchronized: give each worker its own and play them all back together at a sync point.
+///
+/// Playback applies, in order: all creates as a single insert_columns, all cell writes sorted by
+/// row and dense index (later writes to the same cell win), then all erases as a single
+/// erase_columns so each row is compacted once. Writes and erases targeting columns that are not
+/// live at playback time, or rows the table does not have, are ignored.
+template<typename ColumnTagT = column_tag, size_t BlockSize = DEFAULT_BLOCK_SIZE>
+class command_buffer {
+  public:
+   using table_type = table<ColumnTagT>;
+   using column_key = typename table_type::column_key;
+
+   command_buffer() { mCheckpoint.emplace(mAlloc); }
+   ~command_buffer() = default;
+   command_buffer(const command_buffer &other) = delete;
+   command_buffer &operator=(const command_buffer &other) = delete;
+   command_buffer(command_buffer &&other) noexcept = delete;
+   command_buffer &operator=(command_buffer &&other) noexcept = delete;
+
+   /// @brief Records the creation of one column.
+   [[nodiscard]] pending_column create() { return pending_column {mCreateCount++}; }
+
+   /// @brief Records the erasure of @p key.
+   void erase(column_key key) {
+      auto *node = new (mAlloc.allocate(sizeof(erase_node), alignof(erase_node))) erase_node {key};
+      append(mErases, node);
+   }
+
+   /// @brief Records a write of @p value into row T of the live column @p key.
+   template<trivially_copyable T>
+   void write(column_key key, const T &value) {
+      append(mWrites, make_write<T>(value, key, 0, false));
+   }
+
+   /// @brief Records a write of @p value into row T of a column recorded with create().
+   template<trivially_copyable T>
+   void write(pending_column column, const T &value) {
+      append(mWrites,
+             make_write<T>(value, column_key {}, static_cast<const size_t &>(column), true));
+   }
+
+   /// @brief Number of columns recorded with create() since the last clear.
+   size_t create_count() const { return mCreateCount; }
+
+   bool empty() const {
+      return mCreateCount == 0 && mWrites.head == nullptr && mErases.head == nullptr;
+   }
+
+   /// @brief Discards every recorded command and rewinds the backing allocator.
+   void clear() {
+      mCreateCount = 0;
+      mWrites = {};
+      mErases = {};
+      mCheckpoint.reset();
+      mCheckpoint.emplace(mAlloc);
+   }
+
+   /// @brief Plays this buffer back into @p tab and clears it.
+   /// @return The output iterator one past the last created key written to @p created.
+   template<std::output_iterator<column_key> OutputIt>
+   OutputIt playback(table_type &tab, OutputIt created) {
+      command_buffer *self = this;
+      return playback(tab, std::span<command_buffer *const>(&self, 1), created);
+   }
+
+   /// @brief Plays back several buffers into @p tab as one batch and clears them.
+   ///
+   /// Created keys are written to @p created in buffer order, then in recording order.
+   /// @return The output iterator one past the last created key written to @p created.
+   template<std::output_iterator<column_key> OutputIt>
+   static OutputIt playback(table_type &tab, std::span<command_buffer *const> buffers,
+                            OutputIt created) {
+      size_t totalCreates = 0;
+      for (const auto *buffer : buffers) { totalCreates += buffer->mCreateCount; }
+      std::vector<column_key> createdKeys;
+      createdKeys.reserve(totalCreates);
+      tab.insert_columns(totalCreates, std::back_inserter(createdKeys));
+
+      struct resolved_write {
+         ty_id row;
+         size_t denseIdx;
+         column_key key;
+         const write_node *node;
+      };
+      std::vector<resolved_write> writes;
+      std::vector<column_key> erases;
+      size_t createBase = 0;
+      for (const auto *buffer : buffers) {
+         for (const write_node *node = buffer->mWrites.head; node; node = node->next) {
+            assert(!node->pending || node->pendingIdx < buffer->mCreateCount);
+            const column_key key =
+                node->pending ? createdKeys[createBase + node->pendingIdx] : node->key;
+            if (!tab.contains_column(key)) { continue; }
+            writes.push_back({node->row, tab.column_index(key), key, node});
+         }
+         for (const erase_node *node = buffer->mErases.head; node; node = node->next) {
+            erases.push_back(node->key);
+         }
+         createBase += buffer->mCreateCount;
+      }
+
+      std::stable_sort(writes.begin(), writes.end(), [](const auto &a, const auto &b) {
+         return a.row != b.row ? a.row < b.row : a.denseIdx < b.denseIdx;
+      });
+      for (const auto &write : writes) { write.node->apply(tab, write.key, write.node->payload); }
+      tab.erase_columns(erases);
+
+      for (auto *buffer : buffers) { buffer->clear(); }
+      return std::copy(createdKeys.begin(), createdKeys.end(), created);
+   }
+
+  private:
+   struct write_node {
+      write_node *next {nullptr};
+      ty_id row {};
+      column_key key {};
+      size_t pendingIdx {0};
+      bool pending {false};
+      void (*apply)(table_type &, column_key, const void *) {nullptr};
+      const void *payload {nullptr};
+   };
+
+   struct erase_node {
+      column_key key {};
+      erase_node *next {nullptr};
+   };
+
+   template<typename Node>
+   struct node_list {
+      Node *head {nullptr};
+      Node *tail {nullptr};
+   };
+
+   template<typename Node>
+   static void append(node_list<Node> &list, Node *node) {
+      if (list.tail) {
+         list.tail->next = node;
+      } else {
+         list.head = node;
+      }
+      list.tail = node;
+   }
+
+   template<trivially_copyable T>
+   write_node *make_write(const T &value, column_key key, size_t pendingIdx, bool pending) {
+      void *payload = mAlloc.allocate(sizeof(T), alignof(T));
+      std::memcpy(payload, std::addressof(value), sizeof(T));
+      auto *node = new (mAlloc.allocate(sizeof(write_node), alignof(write_node))) write_node {};
+      node->row = getTypeID<T>();
+      node->key = key;
+      node->pendingIdx = pendingIdx;
+      node->pending = pending;
+      node->apply = [](table_type &tab, column_key target, const void *src) {
+         if (!tab.template contains_row<T>()) { return; }
+         std::memcpy(std::addressof(tab.template cell<T>(target)), src, sizeof(T));
+      };
+      node->payload = payload;
+      return node;
+   }
+
+   StackAlloc<BlockSize> mAlloc;
+   std::optional<StackAllocCheckpoint<BlockSize>> mCheckpoint;
+   size_t mCreateCount {0};
+   node_list<write_node> mWrites;
+   node_list<erase_node> mErases;
+};
+
+/// @brief Records SlotMap inserts and removals for later, batched playback.
+///
+/// Values are moved into a StackAlloc-backed log until playback. Like command_buffer, it is not
+/// synchronized, so each worker should own one. Playback first performs every removal whose key is
+/// still live, then every insert in recording order, so freed slots are reused by the new values.
+template<typename Key, typename Value, template<typename SVal> class Storage = std::vector,
+         size_t BlockSize = DEFAULT_BLOCK_SIZE>
+class slot_map_command_buffer {
+  public:
+   using map_type = SlotMap<Key, Value, Storage>;
+
+   slot_map_command_buffer() { mCheckpoint.emplace(mAlloc); }
+   ~slot_map_command_buffer() { destroy_inserts(); }
+   slot_map_command_buffer(const slot_map_command_buffer &other) = delete;
+   slot_map_command_buffer &operator=(const slot_map_command_buffer &other) = delete;
+   slot_map_command_buffer(slot_map_command_buffer &&other) noexcept = delete;
+   slot_map_command_buffer &operator=(slot_map_command_buffer &&other) noexcept = delete;
+
+   void insert(Value &&value) { append_insert(std::move(value)); }
+   void insert(const Value &value) { append_insert(value); }
+
+   void remove(Key key) {
+      auto *node = new (mAlloc.allocate(sizeof(remove_node), alignof(remove_node))) remove_node {};
+      node->key = key;
+      if (mRemoveTail) {
+         mRemoveTail->next = node;
+      } else {
+         mRemoveHead = node;
+      }
+      mRemoveTail = node;
+   }
+
+   bool empty() const { return mInsertHead == nullptr && mRemoveHead == nullptr; }
+
+   /// @brief Discards every recorded command and rewinds the backing allocator.
+   void clear() {
+      destroy_inserts();
+      mInsertHead = mInsertTail = nullptr;
+      mRemoveHead = mRemoveTail = nullptr;
+      mCheckpoint.reset();
+      mCheckpoint.emplace(mAlloc);
+   }
+
+   /// @brief Plays the recorded commands back into @p map and clears the buffer.
+   /// @return The output iterator one past the last inserted key written to @p inserted.
+   template<std::output_iterator<Key> OutputIt>
+   OutputIt playback(map_type &map, OutputIt inserted) {
+      for (const remove_node *node = mRemoveHead; node; node = node->next) {
+         if (map.contains(node->key)) { (void)map.remove(node->key); }
+      }
+      for (insert_node *node = mInsertHead; node; node = node->next) {
+         *inserted++ = map.insert(std::move(node->value));
+      }
+      clear();
+      return inserted;
+   }
+
+  private:
+   struct insert_node {
+      insert_node *next {nullptr};
+      Value value;
+   };
+
+   struct remove_node {
+      remove_node *next {nullptr};
+      Key key {};
+   };
+
+   template<typename V>
+   void append_insert(V &&value) {
+      void *mem = mAlloc.allocate(sizeof(insert_node), alignof(insert_node));
+      auto *node = new (mem) insert_node {nullptr, std::forward<V>(value)};
+      if (mInsertTail) {
+         mInsertTail->next = node;
+      } else {
+         mInsertHead = node;
+      }
+      mInsertTail = node;
+   }
+
+   void destroy_inserts() {
+      if constexpr (!std::is_trivially_destructible_v<Value>) {
+         for (insert_node *node = mInsertHead; node;) {
+            insert_node *next = node->next;
+            node->~insert_node();
+            node = next;
+         }
+      }
+   }
+
+   StackAlloc<BlockSize> mAlloc;
+   std::optional<StackAllocCheckpoint<BlockSize>> mCheckpoint;
+   insert_node *mInsertHead {nullptr};
+   insert_node *mInsertTail {nullptr};
+   remove_node *mRemoveHead {nullptr};
+   remove_node *mRemoveTail {nullptr};
+};
+
+} // namespace tr
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "stack_alloc.hpp"
+
+namespace tr {
+
+/// @brief Bump allocator that many threads can allocate from at once, e.g. a shared frame arena.
+///
+/// Allocation is lock-free: a thread claims its bytes with one fetch_add on the current block's
+/// offset, and when the block is full, one thread links in the next block with a CAS while the
+/// others retry on it. Requests that cannot fit in a block get a dedicated large block. As with
+/// StackAlloc, deallocation is a no-op and reset() rewinds every block for reuse, so a steady
+/// frame loop does no heap traffic. Sizes are rounded up to alignof(std::max_align_t), which
+/// keeps every offset aligned without a second atomic step.
+///
+/// @warning reset() and destruction must not race with allocations; call them once every worker
+/// using the arena is done, e.g. at the end of the frame.
+template<size_t BlockSize = DEFAULT_BLOCK_SIZE>
+class ConcurrentStackAlloc : public std::pmr::memory_resource {
+   static constexpr size_t GRANULE = alignof(std::max_align_t);
+
+   static constexpr size_t BLOCK_USABLE_SZ = BlockSize - (sizeof(size_t) * 2);
+
+   struct Block {
+      std::atomic<size_t> offset {0};
+      std::atomic<Block *> next {nullptr};
+      alignas(GRANULE) std::byte buf[BLOCK_USABLE_SZ];
+   };
+
+   /// Header of a dedicated allocation for a request too big for a block. The cells follow it in
+   /// the same allocation, and headers form a lock-free list.
+   struct LargeBlock {
+      LargeBlock *next {nullptr};
+      size_t bytes {0};
+      size_t alignment {0};
+   };
+
+  public:
+   static_assert(sizeof(Block) == BlockSize, "ConcurrentStackAlloc - BlockSize must be a multiple "
+                                             "of alignof(std::max_align_t)");
+
+   ConcurrentStackAlloc() : mHead(new Block), mCurrent(mHead) {}
+   ~ConcurrentStackAlloc() override {
+      freeLargeBlocks();
+      for (Block *block = mHead; block;) { delete std::exchange(block, block->next.load()); }
+   }
+   ConcurrentStackAlloc(const ConcurrentStackAlloc &other) = delete;
+   ConcurrentStackAlloc &operator=(const ConcurrentStackAlloc &other) = delete;
+   ConcurrentStackAlloc(ConcurrentStackAlloc &&other) noexcept = delete;
+   ConcurrentStackAlloc &operator=(ConcurrentStackAlloc &&other) noexcept = delete;
+
+   /// @brief Invalidates every allocation. Blocks are kept and reused; large blocks are freed.
+   /// Must not be called while other threads allocate.
+   void reset() {
+      for (Block *block = mHead; block; block = block->next.load(std::memory_order_relaxed)) {
+         block->offset.store(0, std::memory_order_relaxed);
+      }
+      mCurrent.store(mHead, std::memory_order_release);
+      freeLargeBlocks();
+   }
+
+  protected:
+   void *do_allocate(size_t size, size_t alignment = alignof(std::max_align_t)) override {
+      const size_t extra = alignment > GRANULE ? alignment - GRANULE : 0;
+      const size_t claim = (std::max<size_t>(size, 1) + extra + GRANULE - 1) & ~(GRANULE - 1);
+      if (claim > BLOCK_USABLE_SZ) { return allocateLarge(size, alignment); }
+
+      Block *block = mCurrent.load(std::memory_order_acquire);
+      while (true) {
+         const size_t offset = block->offset.fetch_add(claim, std::memory_order_relaxed);
+         if (offset <= BLOCK_USABLE_SZ - claim) {
+            auto address = reinterpret_cast<uintptr_t>(block->buf + offset);
+            address = (address + alignment - 1) & ~(uintptr_t {alignment} - 1);
+            return reinterpret_cast<void *>(address);
+         }
+         block = advance(block);
+      }
+   }
+
+   void do_deallocate(void * /* p */, std::size_t /* bytes */,
+                      std::size_t /* alignment */) override {
+      // No-op
+   }
+
+   bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+      return this == &other;
+   }
+
+  private:
+   /// Makes the block after @p full current, linking in a new one if there is none yet.
+   Block *advance(Block *full) {
+      Block *next = full->next.load(std::memory_order_acquire);
+      if (!next) {
+         auto *fresh = new Block;
+         if (full->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel)) {
+            next = fresh;
+         } else {
+            delete fresh; // Another thread linked one first; next now holds it.
+         }
+      }
+      // Losing this CAS means another thread already moved on, to next or beyond.
+      Block *expected = full;
+      if (mCurrent.compare_exchange_strong(expected, next, std::memory_order_acq_rel)) {
+         return next;
+      }
+      return expected;
+   }
+
+   static size_t largeHeaderSize(size_t alignment) {
+      return (sizeof(LargeBlock) + alignment - 1) & ~(alignment - 1);
+   }
+
+   void *allocateLarge(size_t size, size_t alignment) {
+      alignment = std::max(alignment, alignof(LargeBlock));
+      const size_t bytes = largeHeaderSize(alignment) + size;
+      void *memory = ::operator new(bytes, std::align_val_t {alignment});
+      auto *large = new (memory) LargeBlock {nullptr, bytes, alignment};
+
+      large->next = mLargeBlocks.load(std::memory_order_relaxed);
+      while (!mLargeBlocks.compare_exchange_weak(large->next, large, std::memory_order_release,
+                                                 std::memory_order_relaxed)) {}
+      return static_cast<std::byte *>(memory) + largeHeaderSize(alignment);
+   }
+
+   void freeLargeBlocks() {
+      LargeBlock *large = mLargeBlocks.exchange(nullptr, std::memory_order_acquire);
+      while (large) {
+         const LargeBlock current = *large;
+         ::operator delete(large, current.bytes, std::align_val_t {current.alignment});
+         large = current.next;
+      }
+   }
+
+   Block *mHead;                  ///< First block; blocks are chained through Block::next.
+   std::atomic<Block *> mCurrent; ///< Block currently allocated from.
+   std::atomic<LargeBlock *> mLargeBlocks {nullptr};
+};
+
+} // namespace tr
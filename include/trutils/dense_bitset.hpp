@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "panic.hpp"
+
+namespace tr {
+
+/// @brief A packed, resizable bitset that can follow the dense order of a SparseSet.
+///
+/// Besides plain bit access it mirrors the dense-array operations table performs on its rows
+/// (swap_and_pop, swap, gather), so one bit can be kept per column. Set bits are scanned a
+/// 64-bit word at a time, so for_each_set costs O(size() / 64 + count()).
+class dense_bitset {
+  public:
+   using word_type = uint64_t;
+   static constexpr size_t word_bits = 64;
+
+   dense_bitset() = default;
+   explicit dense_bitset(size_t size, bool value = false) { resize(size, value); }
+
+   size_t size() const { return mSize; }
+   bool empty() const { return mSize == 0; }
+
+   bool test(size_t idx) const { return (mWords[idx / word_bits] >> (idx % word_bits)) & 1U; }
+   void set(size_t idx) { mWords[idx / word_bits] |= bit(idx); }
+   void reset(size_t idx) { mWords[idx / word_bits] &= ~bit(idx); }
+
+   void assign(size_t idx, bool value) {
+      if (value) {
+         set(idx);
+      } else {
+         reset(idx);
+      }
+   }
+
+   /// @brief Sets the bits [first, first + count).
+   /// @throws std::out_of_range if the range extends past size().
+   void set(size_t first, size_t count) {
+      if (first > mSize || count > mSize - first) {
+         THROW(std::out_of_range, "dense_bitset::set - range out of bounds");
+      }
+      const size_t last = first + count;
+      for (; first < last && first % word_bits != 0; ++first) { set(first); }
+      for (; last - first >= word_bits; first += word_bits) {
+         mWords[first / word_bits] = ~word_type {0};
+      }
+      for (; first < last; ++first) { set(first); }
+   }
+
+   /// Clears every bit, keeping the size.
+   void reset_all() { std::fill(mWords.begin(), mWords.end(), word_type {0}); }
+
+   bool any() const {
+      return std::any_of(mWords.begin(), mWords.end(), [](word_type w) { return w != 0; });
+   }
+
+   size_t count() const {
+      size_t result = 0;
+      for (const word_type w : mWords) { result += static_cast<size_t>(std::popcount(w)); }
+      return result;
+   }
+
+   void push_back(bool value) {
+      if (mSize % word_bits == 0) { mWords.push_back(0); }
+      assign(mSize++, value);
+   }
+
+   /// @brief Resizes to @p size bits; bits added at the back are set to @p value.
+   void resize(size_t size, bool value = false) {
+      const size_t oldSize = mSize;
+      mWords.resize((size + word_bits - 1) / word_bits, 0);
+      mSize = size;
+      if (size > oldSize && value) {
+         set(oldSize, size - oldSize);
+      } else if (size < oldSize) {
+         clear_tail();
+      }
+   }
+
+   void clear() {
+      mWords.clear();
+      mSize = 0;
+   }
+
+   void reserve(size_t size) { mWords.reserve((size + word_bits - 1) / word_bits); }
+   void shrink_to_fit() { mWords.shrink_to_fit(); }
+
+   /// Bytes of heap storage held, spare capacity included.
+   size_t memory_usage() const { return mWords.capacity() * sizeof(word_type); }
+
+   /// @brief Moves the last bit to @p idx and drops it, like untyped_vector::swap_and_pop.
+   /// @throws std::out_of_range if @p idx is out of range.
+   void swap_and_pop(size_t idx) {
+      if (idx >= mSize) { THROW(std::out_of_range, "dense_bitset::swap_and_pop - out of range"); }
+      assign(idx, test(mSize - 1));
+      resize(mSize - 1);
+   }
+
+   /// @throws std::out_of_range if either index is out of range.
+   void swap(size_t a, size_t b) {
+      if (a >= mSize || b >= mSize) {
+         THROW(std::out_of_range, "dense_bitset::swap - out of range");
+      }
+      const bool bitA = test(a);
+      assign(a, test(b));
+      assign(b, bitA);
+   }
+
+   /// @brief Replaces the contents with the bits at @p indices, in that order, like
+   /// untyped_vector::gather.
+   /// @throws std::out_of_range if any index is >= size(); the bitset is left unchanged.
+   void gather(std::span<const size_t> indices) {
+      for (const size_t idx : indices) {
+         if (idx >= mSize) { THROW(std::out_of_range, "dense_bitset::gather - out of range"); }
+      }
+      dense_bitset result(indices.size());
+      for (size_t k = 0; k < indices.size(); ++k) {
+         if (test(indices[k])) { result.set(k); }
+      }
+      *this = std::move(result);
+   }
+
+   /// @brief Calls @p fn with the index of every set bit, in ascending order.
+   template<typename Fn>
+   void for_each_set(Fn &&fn) const {
+      for (size_t w = 0; w < mWords.size(); ++w) {
+         for (word_type bits = mWords[w]; bits != 0; bits &= bits - 1) {
+            fn((w * word_bits) + static_cast<size_t>(std::countr_zero(bits)));
+         }
+      }
+   }
+
+   /// The packed words; bit i is bit (i % 64) of word i / 64, and bits past size() are zero.
+   std::span<const word_type> words() const { return mWords; }
+
+  private:
+   static word_type bit(size_t idx) { return word_type {1} << (idx % word_bits); }
+
+   void clear_tail() {
+      if (mSize % word_bits != 0) { mWords.back() &= (word_type {1} << (mSize % word_bits)) - 1; }
+   }
+
+   std::vector<word_type> mWords;
+   size_t mSize {0};
+};
+
+} // namespace tr
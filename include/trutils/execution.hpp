@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <execution>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tr {
+
+/// @brief Adapts a standard execution policy to the executor form table::for_each_parallel and
+/// table_query::for_each_chunk take.
+///
+/// Lives apart from table.hpp because libstdc++ implements the parallel policies on TBB, and
+/// including <execution> makes every user of the table link it, even in unoptimized builds.
+/// Include this header only where a standard policy is wanted:
+///
+///     t.for_each_parallel<Position>(tr::policy_executor(std::execution::par), 256, fn);
+template<typename Policy>
+   requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+auto policy_executor(Policy &&policy) {
+   return [policy = std::forward<Policy>(policy)](size_t count, auto &&task) {
+      std::vector<size_t> indices(count);
+      std::iota(indices.begin(), indices.end(), size_t {0});
+      std::for_each(policy, indices.begin(), indices.end(), task);
+   };
+}
+
+} // namespace tr
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "panic.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TR_HAS_MMAP 1
+#else
+#define TR_HAS_MMAP 0
+#endif
+
+namespace tr {
+
+/// @brief Owning, private copy-on-write memory mapping of a whole file.
+///
+/// The file is opened read-only and never modified: pages are shared with the page cache until
+/// written, at which point the process gets its own copy. Moving transfers the mapping.
+class mapped_file {
+  public:
+   mapped_file() = default;
+
+   /// @throws std::runtime_error if the file cannot be opened or mapped.
+   explicit mapped_file(const std::filesystem::path &path) {
+#if TR_HAS_MMAP
+      const int fd = ::open(path.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+      if (fd < 0) { THROW(std::runtime_error, "mapped_file - cannot open '{}'", path.string()); }
+
+      struct stat info {};
+      if (::fstat(fd, &info) != 0) {
+         ::close(fd);
+         THROW(std::runtime_error, "mapped_file - cannot stat '{}'", path.string());
+      }
+
+      mSize = static_cast<size_t>(info.st_size);
+      if (mSize != 0) {
+         void *addr = ::mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+         if (addr == MAP_FAILED) {
+            ::close(fd);
+            THROW(std::runtime_error, "mapped_file - cannot map '{}'", path.string());
+         }
+         mData = static_cast<std::byte *>(addr);
+      }
+      ::close(fd);
+#else
+      THROW(std::runtime_error, "mapped_file - memory mapping is not supported on this platform");
+#endif
+   }
+
+   ~mapped_file() { unmap(); }
+   mapped_file(const mapped_file &other) = delete;
+   mapped_file &operator=(const mapped_file &other) = delete;
+
+   mapped_file(mapped_file &&other) noexcept :
+       mData(std::exchange(other.mData, nullptr)), mSize(std::exchange(other.mSize, 0)) {}
+
+   mapped_file &operator=(mapped_file &&other) noexcept {
+      if (this == &other) { return *this; }
+      unmap();
+      mData = std::exchange(other.mData, nullptr);
+      mSize = std::exchange(other.mSize, 0);
+      return *this;
+   }
+
+   /// The mapped bytes. The mapping starts on a page boundary.
+   std::span<std::byte> bytes() const { return {mData, mSize}; }
+
+   size_t size() const { return mSize; }
+
+  private:
+   void unmap() {
+#if TR_HAS_MMAP
+      if (mData) { ::munmap(mData, mSize); }
+#endif
+      mData = nullptr;
+      mSize = 0;
+   }
+
+   std::byte *mData {nullptr};
+   size_t mSize {0};
+};
+
+} // namespace tr
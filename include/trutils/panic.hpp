@@ -3,18 +3,46 @@
 #include <format>
 #include <iostream>
 
-#ifdef __cpp_exceptions
-#define THROW(except_ty, ...) throw except_ty(std::format(__VA_ARGS__));
+// Controls whether the unchecked_* fast-path accessors still validate their arguments. Defaults to
+// on in debug builds and off when NDEBUG is defined; define it to 0 or 1 to override.
+#ifndef TR_DEBUG_CHECKS
+#ifdef NDEBUG
+#define TR_DEBUG_CHECKS 0
+#else
+#define TR_DEBUG_CHECKS 1
+#endif
+#endif
+
+// Marks a function as rarely called and keeps it out of line, so its callers stay small enough to
+// inline.
+#if defined(__GNUC__) || defined(__clang__)
+#define TR_COLD [[gnu::cold, gnu::noinline]]
+#elif defined(_MSC_VER)
+#define TR_COLD __declspec(noinline)
 #else
-#define THROW(except_ty, ...) tr::panic(__VA_ARGS__);
+#define TR_COLD
 #endif
 
+// Formatting and throwing happen in throw_formatted, so a check costs its callers only a compare
+// and a call.
+#define THROW(except_ty, ...) ::tr::throw_formatted<except_ty>(__VA_ARGS__)
+
 namespace tr {
 
 template<typename... Args>
-void panic(Args &&...args) {
+[[noreturn]] void panic(Args &&...args) {
    std::cerr << "PANIC: " << std::format(std::forward<Args>(args)...) << std::endl;
    std::abort();
 }
 
-} // namespace tr
\ No newline at end of file
+/// @brief Throws @p Except with the formatted message, or panics when exceptions are disabled.
+template<typename Except, typename... Args>
+[[noreturn]] TR_COLD void throw_formatted(std::format_string<Args...> fmt, Args &&...args) {
+#ifdef __cpp_exceptions
+   throw Except(std::format(fmt, std::forward<Args>(args)...));
+#else
+   panic(fmt, std::forward<Args>(args)...);
+#endif
+}
+
+} // namespace tr
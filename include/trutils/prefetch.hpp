@@ -0,0 +1,23 @@
+#pragma once
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace tr {
+
+/// @brief Hints the CPU to start loading the cache line holding @p address for a read.
+///
+/// Never faults, so any address may be passed, including one past the end of a range. Compiles
+/// to nothing on compilers without a prefetch intrinsic.
+inline void prefetch(const void *address) {
+#if defined(__GNUC__) || defined(__clang__)
+   __builtin_prefetch(address, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+   _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#else
+   (void)address;
+#endif
+}
+
+} // namespace tr
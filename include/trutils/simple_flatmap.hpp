@@ -1,16 +1,196 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <functional>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "panic.hpp"
+#include "trace.hpp"
+
 namespace tr {
 
+/// Hash for keys that are already well-distributed hashes, such as ty_id. Returns the key as-is.
+struct identity_hash {
+   template<typename K>
+   constexpr std::size_t operator()(const K &key) const noexcept {
+      return static_cast<std::size_t>(key);
+   }
+};
+
+/// @brief simple_flatmap index policy backed by std::unordered_map.
+template<typename Key, typename Hash, typename KeyEqual>
+class unordered_index {
+  public:
+   using size_type = std::size_t;
+
+   size_type *find(const Key &key) {
+      auto it = mMap.find(key);
+      return it == mMap.end() ? nullptr : &it->second;
+   }
+
+   const size_type *find(const Key &key) const {
+      auto it = mMap.find(key);
+      return it == mMap.end() ? nullptr : &it->second;
+   }
+
+   bool contains(const Key &key) const { return mMap.contains(key); }
+
+   std::pair<size_type *, bool> try_emplace(const Key &key, size_type value) {
+      auto [it, inserted] = mMap.try_emplace(key, value);
+      return {&it->second, inserted};
+   }
+
+   bool erase(const Key &key) { return mMap.erase(key) != 0; }
+   void reserve(size_type count) { mMap.reserve(count); }
+   void clear() { mMap.clear(); }
+
+  private:
+   std::unordered_map<Key, size_type, Hash, KeyEqual> mMap;
+};
+
+/// @brief simple_flatmap index policy using Robin Hood open addressing in one flat array.
+///
+/// Lookups probe linearly from the home bucket without chasing node pointers, and stop as soon as
+/// they pass an entry closer to its own home than the probe is. The hash is spread over the table
+/// with a Fibonacci multiply, so pre-hashed keys can use identity_hash without losing quality.
+/// Key must be default-constructible; pointers returned by find are invalidated by any insert or
+/// erase.
+template<typename Key, typename Hash, typename KeyEqual>
+class open_addressing_index {
+  public:
+   using size_type = std::size_t;
+
+   /// Whether lookups cannot throw, which holds unless Hash or KeyEqual may throw.
+   static constexpr bool NOTHROW_LOOKUP =
+       std::is_nothrow_invocable_v<const Hash &, const Key &> &&
+       std::is_nothrow_invocable_v<const KeyEqual &, const Key &, const Key &>;
+
+   size_type *find(const Key &key) noexcept(NOTHROW_LOOKUP) {
+      const size_type idx = find_slot(key);
+      return idx == NPOS ? nullptr : &mSlots[idx].value;
+   }
+
+   const size_type *find(const Key &key) const noexcept(NOTHROW_LOOKUP) {
+      const size_type idx = find_slot(key);
+      return idx == NPOS ? nullptr : &mSlots[idx].value;
+   }
+
+   bool contains(const Key &key) const noexcept(NOTHROW_LOOKUP) { return find(key) != nullptr; }
+
+   std::pair<size_type *, bool> try_emplace(const Key &key, size_type value) {
+      if (size_type *existing = find(key)) { return {existing, false}; }
+      if ((mCount + 1) * MAX_LOAD_DEN > mSlots.size() * MAX_LOAD_NUM) {
+         rehash(std::max<size_type>(mSlots.size() * 2, MIN_CAPACITY));
+      }
+      ++mCount;
+      return {place(slot {key, value, 1}), true};
+   }
+
+   bool erase(const Key &key) {
+      size_type idx = find_slot(key);
+      if (idx == NPOS) { return false; }
+
+      // Backward-shift deletion: pull each displaced successor one bucket closer to home.
+      for (size_type next = (idx + 1) & mask(); mSlots[next].dist > 1;
+           idx = next, next = (next + 1) & mask()) {
+         mSlots[idx] = std::move(mSlots[next]);
+         mSlots[idx].dist -= 1;
+      }
+      mSlots[idx] = slot {};
+      --mCount;
+      return true;
+   }
+
+   /// Bytes of heap storage held by the slot array.
+   size_type memory_usage() const { return mSlots.capacity() * sizeof(slot); }
+
+   void reserve(size_type count) {
+      const size_type needed = (count * MAX_LOAD_DEN + MAX_LOAD_NUM - 1) / MAX_LOAD_NUM;
+      if (needed > mSlots.size()) { rehash(std::bit_ceil(std::max(needed, MIN_CAPACITY))); }
+   }
+
+   void clear() {
+      mSlots.clear();
+      mCount = 0;
+   }
+
+  private:
+   struct slot {
+      Key key {};
+      size_type value {0};
+      uint32_t dist {0}; ///< 0 for an empty slot, otherwise probe distance from home plus one.
+   };
+
+   static constexpr size_type NPOS = static_cast<size_type>(-1);
+   static constexpr size_type MIN_CAPACITY = 8;
+   static constexpr size_type MAX_LOAD_NUM = 7;
+   static constexpr size_type MAX_LOAD_DEN = 8;
+
+   size_type mask() const noexcept { return mSlots.size() - 1; }
+
+   size_type home(const Key &key) const noexcept(NOTHROW_LOOKUP) {
+      constexpr uint64_t fibonacci = 0x9E3779B97F4A7C15ULL;
+      const uint64_t mixed = static_cast<uint64_t>(mHash(key)) * fibonacci;
+      return static_cast<size_type>(mixed >> (64 - std::countr_zero(mSlots.size())));
+   }
+
+   size_type find_slot(const Key &key) const noexcept(NOTHROW_LOOKUP) {
+      if (mCount == 0) { return NPOS; }
+      size_type idx = home(key);
+      for (uint32_t dist = 1;; ++dist) {
+         const slot &s = mSlots[idx];
+         if (s.dist < dist) { return NPOS; }
+         if (s.dist == dist && mEqual(s.key, key)) { return idx; }
+         idx = (idx + 1) & mask();
+      }
+   }
+
+   /// Robin Hood insertion of a key known to be absent; returns the new value's location.
+   size_type *place(slot incoming) {
+      size_type *result = nullptr;
+      size_type idx = home(incoming.key);
+      for (;; idx = (idx + 1) & mask(), ++incoming.dist) {
+         slot &s = mSlots[idx];
+         if (s.dist == 0) {
+            s = std::move(incoming);
+            return result ? result : &s.value;
+         }
+         if (s.dist < incoming.dist) {
+            std::swap(s, incoming);
+            if (!result) { result = &s.value; }
+         }
+      }
+   }
+
+   void rehash(size_type capacity) {
+      TR_TRACE_ZONE("open_addressing_index::rehash");
+      TR_TRACE_COUNTER("open_addressing_index::capacity", capacity);
+      std::vector<slot> old = std::exchange(mSlots, std::vector<slot>(capacity));
+      for (slot &s : old) {
+         if (s.dist != 0) {
+            s.dist = 1;
+            place(std::move(s));
+         }
+      }
+   }
+
+   std::vector<slot> mSlots;
+   size_type mCount {0};
+   [[no_unique_address]] Hash mHash {};
+   [[no_unique_address]] KeyEqual mEqual {};
+};
+
 // Note/Todo: Mutating keys is undefined behavior. In the future we could
 // create a custom iterator that returns const Key references instead.
 template<typename Key, typename T, typename Hash = std::hash<Key>,
-         typename KeyEqual = std::equal_to<Key>>
+         typename KeyEqual = std::equal_to<Key>,
+         template<typename, typename, typename> class Index = unordered_index>
 class simple_flatmap {
   public:
    using key_type = Key;
@@ -19,7 +199,7 @@ class simple_flatmap {
    using size_type = std::size_t;
    using hasher = Hash;
    using key_equal = KeyEqual;
-   using map_type = std::unordered_map<Key, size_type, Hash, KeyEqual>;
+   using map_type = Index<Key, Hash, KeyEqual>;
    using iterator = std::vector<value_type>::iterator;
    using const_iterator = std::vector<value_type>::const_iterator;
 
@@ -39,42 +219,63 @@ class simple_flatmap {
       mIndex.clear();
    }
 
-   bool contains(const Key &key) const { return mIndex.contains(key); }
+   /// Whether find() and contains() cannot throw; true for open_addressing_index with the default
+   /// hashers.
+   static constexpr bool NOTHROW_FIND = noexcept(std::declval<const map_type &>().find(
+       std::declval<const Key &>()));
 
-   mapped_type &at(const Key &key) { return mValues[mIndex.at(key)].second; }
+   bool contains(const Key &key) const noexcept(NOTHROW_FIND) {
+      return mIndex.find(key) != nullptr;
+   }
+
+   /// The value mapped to @p key, or nullptr if there is none.
+   mapped_type *find(const Key &key) noexcept(NOTHROW_FIND) {
+      const size_type *idx = mIndex.find(key);
+      return idx ? &mValues[*idx].second : nullptr;
+   }
+
+   const mapped_type *find(const Key &key) const noexcept(NOTHROW_FIND) {
+      const size_type *idx = mIndex.find(key);
+      return idx ? &mValues[*idx].second : nullptr;
+   }
+
+   /// @throws std::out_of_range if @p key is not in the map.
+   mapped_type &at(const Key &key) { return mValues[index_of(key)].second; }
 
-   const mapped_type &at(const Key &key) const { return mValues[mIndex.at(key)].second; }
+   /// @throws std::out_of_range if @p key is not in the map.
+   const mapped_type &at(const Key &key) const { return mValues[index_of(key)].second; }
 
    mapped_type &operator[](const Key &key) {
-      auto [it, inserted] = mIndex.try_emplace(key, mValues.size());
+      auto [idx, inserted] = mIndex.try_emplace(key, mValues.size());
       if (inserted) { mValues.emplace_back(key, T {}); }
-      return mValues[it->second].second;
+      return mValues[*idx].second;
    }
 
    std::pair<bool, mapped_type &> insert(const Key &key, const mapped_type &value) {
-      auto [it, inserted] = mIndex.try_emplace(key, mValues.size());
-      if (!inserted) { return {false, mValues[it->second].second}; }
+      auto [idx, inserted] = mIndex.try_emplace(key, mValues.size());
+      if (!inserted) { return {false, mValues[*idx].second}; }
 
       mValues.push_back({key, value});
       return {true, mValues.back().second};
    }
 
    std::pair<bool, mapped_type &> insert(const Key &key, mapped_type &&value) {
-      auto [it, inserted] = mIndex.try_emplace(key, mValues.size());
-      if (!inserted) { return {false, mValues[it->second].second}; }
+      auto [idx, inserted] = mIndex.try_emplace(key, mValues.size());
+      if (!inserted) { return {false, mValues[*idx].second}; }
 
       mValues.push_back({key, std::move(value)});
       return {true, mValues.back().second};
    }
 
    bool erase(const Key &key) {
-      if (!mIndex.contains(key)) { return false; }
+      const size_type *found = mIndex.find(key);
+      if (!found) { return false; }
 
-      size_type idx = mIndex[key];
+      size_type idx = *found;
       size_type last = mValues.size() - 1;
       if (idx != last) {
          std::swap(mValues[idx], mValues[last]);
-         mIndex[mValues[idx].first] = idx;
+         *mIndex.find(mValues[idx].first) = idx;
       }
 
       mIndex.erase(key);
@@ -93,6 +294,12 @@ class simple_flatmap {
    const_iterator end() const { return mValues.end(); }
 
   private:
+   size_type index_of(const Key &key) const {
+      const size_type *idx = mIndex.find(key);
+      if (!idx) { THROW(std::out_of_range, "simple_flatmap::at - key not found"); }
+      return *idx;
+   }
+
    std::vector<value_type> mValues;
    map_type mIndex;
 };
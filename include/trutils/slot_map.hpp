@@ -1,18 +1,70 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
 #include <span>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "panic.hpp"
+#include "prefetch.hpp"
+#include "slot_map_storage.hpp"
 #include "sparse_set.hpp"
 
 namespace tr {
 
+/// Keys gather_prefetched resolves per batch; enough to cover memory latency, few enough that the
+/// batch's lines stay in L1 until they are read.
+inline constexpr size_t GATHER_BATCH = 32;
+
+/// @brief Writes storage[mapping.get(key)] to @p out for every key in @p keys, in order.
+///
+/// Random lookups through a SparseSet cost two dependent misses each: the sparse entry, then the
+/// dense value. Keys are handled GATHER_BATCH at a time, prefetching the whole batch's sparse
+/// entries and then its dense values, so the misses of a batch overlap instead of serializing.
+/// @throws std::out_of_range if a key is not in @p mapping; values before its batch are written.
+/// @return The output iterator one past the last written value.
+template<typename KeyType, template<typename> class SparseArray, typename Storage,
+         typename OutputIt>
+OutputIt gather_prefetched(const SparseSet<KeyType, SparseArray> &mapping, const Storage &storage,
+                           std::span<const KeyType> keys, OutputIt out) {
+   std::array<typename KeyType::ID, GATHER_BATCH> indices;
+   for (size_t first = 0; first < keys.size(); first += GATHER_BATCH) {
+      const auto batch = keys.subspan(first, std::min(GATHER_BATCH, keys.size() - first));
+      mapping.get_many(batch, indices);
+      for (size_t i = 0; i < batch.size(); ++i) { prefetch(&storage[indices[i]]); }
+      for (size_t i = 0; i < batch.size(); ++i) { *out++ = storage[indices[i]]; }
+   }
+   return out;
+}
+
+/// @brief Dense value storage addressed through stable, versioned keys.
+///
+/// @tparam Storage Template for the dense value sequence; Storage<Value> must satisfy
+///         slot_map_storage. See slot_map_storage.hpp for the shipped chunked and inline backends;
+///         std::pmr::vector works too, bound to an arena by passing it to the constructor.
 template<typename Key, typename Value, template<typename SVal> class Storage = std::vector>
 class SlotMap {
+   static_assert(slot_map_storage<Storage<Value>>, "SlotMap - Storage<Value> is not valid storage");
+
   public:
+   SlotMap() = default;
+
+   /// @brief Uses @p storage, which must be empty, for the values, e.g. a std::pmr::vector
+   /// constructed with a StackAlloc or pool resource.
+   explicit SlotMap(Storage<Value> storage) : mStorage(std::move(storage)) {
+      assert(mStorage.size() == 0);
+   }
+
    [[nodiscard]] Key insert(Value &&value) {
       auto key = mMapping.insert();
       mStorage.push_back(std::move(value));
@@ -25,29 +77,101 @@ class SlotMap {
       return key;
    }
 
-   bool contains(Key key) const { return mMapping.contains(key); }
+   /// @brief Inserts every element of @p values, writing their keys to @p keys in order.
+   ///
+   /// Values are appended to storage first and their keys are then allocated with a single
+   /// SparseSet::insert_n, instead of growing both once per element.
+   /// @return The output iterator one past the last written key.
+   /// @throws if the maximum size of the map is reached, storage cannot grow, or a value fails to
+   /// construct; the map is left unchanged and no key is written.
+   template<std::ranges::input_range R, std::output_iterator<Key> OutputIt>
+      requires std::constructible_from<Value, std::ranges::range_reference_t<R>>
+   OutputIt insert_range(R &&values, OutputIt keys) {
+      const size_t oldSize = mStorage.size();
+      // insert_n keeps the keys it handed out before failing, so collect them to roll back.
+      std::vector<Key> inserted;
+      try {
+         if constexpr (std::ranges::sized_range<R>) {
+            grow_storage(oldSize + std::ranges::size(values));
+         }
+         for (auto &&value : values) { mStorage.push_back(std::forward<decltype(value)>(value)); }
+         inserted.reserve(mStorage.size() - oldSize);
+         mMapping.insert_n(mStorage.size() - oldSize, std::back_inserter(inserted));
+      } catch (...) {
+         // The new keys hold the dense tail, so erasing them newest first never moves old ones.
+         for (auto it = inserted.rbegin(); it != inserted.rend(); ++it) { mMapping.erase(*it); }
+         while (mStorage.size() != oldSize) { mStorage.pop_back(); }
+         throw;
+      }
+      return std::ranges::copy(inserted, keys).out;
+   }
+
+   /// @brief Removes every live key in @p keys. Unknown or repeated keys are ignored.
+   ///
+   /// Each removal moves the current last value into the hole, and the vacated tail of storage is
+   /// destroyed once at the end, so the resulting layout matches calling remove for each key in
+   /// order.
+   /// @return The number of values removed.
+   size_t remove_batch(std::span<const Key> keys) {
+      size_t end = mStorage.size();
+      for (const Key key : keys) {
+         if (!mMapping.contains(key)) { continue; }
+         const auto storageIdx = static_cast<size_t>(mMapping.get(key));
+         mMapping.erase(key);
+         if (storageIdx != --end) { mStorage[storageIdx] = std::move(mStorage[end]); }
+      }
+
+      const size_t removed = mStorage.size() - end;
+      while (mStorage.size() != end) { mStorage.pop_back(); }
+      return removed;
+   }
+
+   /// @brief Reserves storage for at least @p capacity values without reallocating.
+   void reserve(size_t capacity) {
+      mMapping.reserve(capacity);
+      if constexpr (requires { mStorage.reserve(capacity); }) { mStorage.reserve(capacity); }
+   }
+
+   bool contains(Key key) const noexcept { return mMapping.contains(key); }
 
    /// @throws If the slotmap does not contain an entry associated with key.
-   Value &get(Key key) { return mStorage.at(mMapping.get(key)); }
+   Value &get(Key key) { return mStorage[mMapping.get(key)]; }
 
    /// @throws If the slotmap does not contain an entry associated with key.
-   const Value &get(Key key) const { return mStorage.at(mMapping.get(key)); }
+   const Value &get(Key key) const { return mStorage[mMapping.get(key)]; }
+
+   /// @brief The value associated with @p key, or nullptr if there is none.
+   Value *find(Key key) noexcept {
+      const auto storageIdx = mMapping.try_get(key);
+      return storageIdx ? &mStorage[*storageIdx] : nullptr;
+   }
+
+   const Value *find(Key key) const noexcept {
+      const auto storageIdx = mMapping.try_get(key);
+      return storageIdx ? &mStorage[*storageIdx] : nullptr;
+   }
+
+   /// @brief Writes a copy of get(key) for every key in @p keys to @p out, in order, prefetching
+   /// across the batch; see gather_prefetched. Faster than a get() loop for large, random key sets.
+   /// @throws std::out_of_range if a key is not in the map.
+   template<std::output_iterator<const Value &> OutputIt>
+   OutputIt get_many(std::span<const Key> keys, OutputIt out) const {
+      return gather_prefetched(mMapping, mStorage, keys, out);
+   }
 
    /// @throws If the slotmap does not contain an entry associated with key.
    Value remove(Key key) {
-      if (!mMapping.contains(key)) {
-         THROW(std::runtime_error, "slot_map::remove - key not found");
-      }
-
-      auto storageIdx = mMapping.get(key);
-      mMapping.erase(key);
+      const auto storageIdx = mMapping.try_get(key);
+      if (!storageIdx) { THROW(std::runtime_error, "slot_map::remove - key not found"); }
+      return take(key, *storageIdx);
+   }
 
-      // Swap and pop the data
-      auto oldDataSize = mStorage.size();
-      if (oldDataSize > 1) { std::swap(mStorage[storageIdx], mStorage[oldDataSize - 1]); }
-      auto val = std::move(mStorage[oldDataSize - 1]);
-      mStorage.pop_back();
-      return val;
+   /// @brief Like remove(), but returns std::nullopt for a key the map does not contain.
+   std::optional<Value> try_remove(Key key) noexcept(std::is_nothrow_move_constructible_v<Value> &&
+                                                     std::is_nothrow_move_assignable_v<Value>) {
+      const auto storageIdx = mMapping.try_get(key);
+      if (!storageIdx) { return std::nullopt; }
+      return take(key, *storageIdx);
    }
 
    size_t size() const { return mStorage.size(); }
@@ -62,12 +186,177 @@ class SlotMap {
    Storage<Value>::const_iterator begin() const { return mStorage.begin(); }
    Storage<Value>::const_iterator end() const { return mStorage.end(); }
 
-   std::span<Value> data() { return std::span(mStorage); }
-   std::span<const Value> data() const { return std::span(mStorage); }
+   std::span<Value> data()
+      requires std::ranges::contiguous_range<Storage<Value>>
+   {
+      return std::span(mStorage);
+   }
+   std::span<const Value> data() const
+      requires std::ranges::contiguous_range<Storage<Value>>
+   {
+      return std::span(mStorage);
+   }
 
   private:
+   /// Erases @p key, whose value is at @p storage_idx, moving the last value into the hole.
+   Value take(Key key, size_t storage_idx) {
+      mMapping.erase(key);
+      const size_t lastIdx = mStorage.size() - 1;
+      auto val = std::move(mStorage[storage_idx]);
+      if (storage_idx != lastIdx) { mStorage[storage_idx] = std::move(mStorage[lastIdx]); }
+      mStorage.pop_back();
+      return val;
+   }
+
+   /// Makes room in storage for @p needed values. Contiguous storage relocates when it grows, so
+   /// its capacity at least doubles, keeping repeated batches amortized like push_back; the keys
+   /// grow the same way in SparseSet::insert_n.
+   void grow_storage(size_t needed) {
+      if constexpr (requires { mStorage.capacity(); mStorage.reserve(needed); }) {
+         const size_t capacity = mStorage.capacity();
+         if (needed <= capacity) { return; }
+         if constexpr (std::ranges::contiguous_range<Storage<Value>>) {
+            mStorage.reserve(std::max(needed, 2 * capacity));
+         } else {
+            mStorage.reserve(needed);
+         }
+      }
+   }
+
    SparseSet<Key> mMapping;
    Storage<Value> mStorage {};
 };
 
+/// @brief A SlotMap that keeps a projection of each value, its hot fields, in a second dense array.
+///
+/// Code that reads a few fields of many values, e.g. positions for a broadphase, then iterates or
+/// gathers a small hot_type instead of dragging whole values through the cache. The hot copy is
+/// refreshed by every write, so values are only mutable through update().
+///
+/// @tparam Projection Callable turning a const Value & into the hot fields, e.g. a lambda type.
+template<typename Key, typename Value, typename Projection,
+         template<typename SVal> class Storage = std::vector>
+class SplitSlotMap {
+  public:
+   using hot_type = std::remove_cvref_t<std::invoke_result_t<const Projection &, const Value &>>;
+
+   static_assert(slot_map_storage<Storage<Value>>, "SplitSlotMap - Storage<Value> is not valid "
+                                                   "storage");
+   static_assert(slot_map_storage<Storage<hot_type>>, "SplitSlotMap - Storage<hot_type> is not "
+                                                      "valid storage");
+
+   SplitSlotMap() = default;
+   explicit SplitSlotMap(Projection projection) : mProject(std::move(projection)) {}
+
+   [[nodiscard]] Key insert(Value value) {
+      auto key = mMapping.insert();
+      mHot.push_back(std::invoke(mProject, std::as_const(value)));
+      mCold.push_back(std::move(value));
+      return key;
+   }
+
+   bool contains(Key key) const noexcept { return mMapping.contains(key); }
+
+   /// @throws If the map does not contain an entry associated with key.
+   const Value &get(Key key) const { return mCold[mMapping.get(key)]; }
+
+   /// @throws If the map does not contain an entry associated with key.
+   const hot_type &hot(Key key) const { return mHot[mMapping.get(key)]; }
+
+   /// @brief The value associated with @p key, or nullptr if there is none.
+   const Value *find(Key key) const noexcept {
+      const auto idx = mMapping.try_get(key);
+      return idx ? &mCold[*idx] : nullptr;
+   }
+
+   /// @brief The hot fields of @p key, or nullptr if there is none.
+   const hot_type *find_hot(Key key) const noexcept {
+      const auto idx = mMapping.try_get(key);
+      return idx ? &mHot[*idx] : nullptr;
+   }
+
+   /// @brief Calls @p fn with the value of @p key, then refreshes its hot fields, also when @p fn
+   /// throws.
+   /// @throws If the map does not contain an entry associated with key.
+   template<typename Fn>
+   void update(Key key, Fn &&fn) {
+      const auto idx = mMapping.get(key);
+      Value &value = mCold[idx];
+      try {
+         std::invoke(std::forward<Fn>(fn), value);
+      } catch (...) {
+         mHot[idx] = std::invoke(mProject, std::as_const(value));
+         throw;
+      }
+      mHot[idx] = std::invoke(mProject, std::as_const(value));
+   }
+
+   /// @brief get_many for whole values; see SlotMap::get_many.
+   template<std::output_iterator<const Value &> OutputIt>
+   OutputIt get_many(std::span<const Key> keys, OutputIt out) const {
+      return gather_prefetched(mMapping, mCold, keys, out);
+   }
+
+   /// @brief Writes hot(key) for every key in @p keys to @p out, in order, prefetching across the
+   /// batch. Only the hot array is touched.
+   /// @throws std::out_of_range if a key is not in the map.
+   template<std::output_iterator<const hot_type &> OutputIt>
+   OutputIt get_hot_many(std::span<const Key> keys, OutputIt out) const {
+      return gather_prefetched(mMapping, mHot, keys, out);
+   }
+
+   /// @throws If the map does not contain an entry associated with key.
+   Value remove(Key key) {
+      if (!mMapping.contains(key)) {
+         THROW(std::runtime_error, "split_slot_map::remove - key not found");
+      }
+
+      auto storageIdx = mMapping.get(key);
+      mMapping.erase(key);
+
+      // Move the last value and hot fields into the hole and pop, as SlotMap does
+      const size_t lastIdx = mCold.size() - 1;
+      auto val = std::move(mCold[storageIdx]);
+      if (storageIdx != lastIdx) {
+         mCold[storageIdx] = std::move(mCold[lastIdx]);
+         mHot[storageIdx] = std::move(mHot[lastIdx]);
+      }
+      mCold.pop_back();
+      mHot.pop_back();
+      return val;
+   }
+
+   /// @brief Reserves storage for at least @p capacity values without reallocating.
+   void reserve(size_t capacity) {
+      mMapping.reserve(capacity);
+      if constexpr (requires { mCold.reserve(capacity); }) { mCold.reserve(capacity); }
+      if constexpr (requires { mHot.reserve(capacity); }) { mHot.reserve(capacity); }
+   }
+
+   size_t size() const { return mCold.size(); }
+
+   void clear() {
+      mCold.clear();
+      mHot.clear();
+      mMapping.clear();
+   }
+
+   /// Values in dense order.
+   Storage<Value>::const_iterator begin() const { return mCold.begin(); }
+   Storage<Value>::const_iterator end() const { return mCold.end(); }
+
+   /// Hot fields in dense order; element i belongs to the i-th value.
+   std::span<const hot_type> hot_data() const
+      requires std::ranges::contiguous_range<Storage<hot_type>>
+   {
+      return std::span(mHot);
+   }
+
+  private:
+   SparseSet<Key> mMapping;
+   Storage<Value> mCold {};
+   Storage<hot_type> mHot {};
+   [[no_unique_address]] Projection mProject {};
+};
+
 } // namespace tr
\ No newline at end of file
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "panic.hpp"
+
+namespace tr {
+
+/// @brief Requirements on the value storage of a SlotMap.
+///
+/// SlotMap keeps its values densely packed and only ever appends at the back, removes from the
+/// back, and moves the last value into a hole through operator[]. Any sequence providing those
+/// operations works; std::vector, std::pmr::vector, chunked_vector and inline_vector all do.
+/// reserve() is used when present, and SlotMap::data() is only available for contiguous storage.
+template<typename S>
+concept slot_map_storage = requires(S storage, const S cstorage, typename S::value_type value,
+                                    size_t idx) {
+   typename S::value_type;
+   typename S::iterator;
+   typename S::const_iterator;
+   storage.push_back(std::move(value));
+   storage.pop_back();
+   storage.clear();
+   { storage[idx] } -> std::same_as<typename S::value_type &>;
+   { cstorage[idx] } -> std::same_as<const typename S::value_type &>;
+   { cstorage.size() } -> std::convertible_to<size_t>;
+   { storage.begin() } -> std::same_as<typename S::iterator>;
+   { storage.end() } -> std::same_as<typename S::iterator>;
+   { cstorage.begin() } -> std::same_as<typename S::const_iterator>;
+   { cstorage.end() } -> std::same_as<typename S::const_iterator>;
+};
+
+/// Chunk length giving chunked_vector roughly 16 KiB chunks, rounded down to a power of two.
+template<typename T>
+consteval size_t default_chunk_size() {
+   return std::bit_floor(std::max<size_t>(1, (size_t {16} * 1024) / sizeof(T)));
+}
+
+/// @brief A vector made of fixed-size, separately allocated chunks.
+///
+/// Growing allocates one new chunk and never moves existing elements, so there is no copy stall
+/// when a large SlotMap doubles, and references stay valid until the element is removed. Indexing
+/// costs one extra indirection compared to std::vector. Chunks are kept after pop_back and clear
+/// for reuse; shrink_to_fit releases the unused ones.
+template<typename T, size_t ChunkSize = default_chunk_size<T>()>
+class chunked_vector {
+   static_assert(std::has_single_bit(ChunkSize),
+                 "chunked_vector - ChunkSize must be a power of two");
+
+   template<bool IsConst>
+   class basic_iterator;
+
+  public:
+   using value_type = T;
+   using size_type = size_t;
+   using reference = T &;
+   using const_reference = const T &;
+   using iterator = basic_iterator<false>;
+   using const_iterator = basic_iterator<true>;
+
+   static constexpr size_t chunk_size = ChunkSize;
+
+   chunked_vector() = default;
+   ~chunked_vector() { clear(); }
+
+   chunked_vector(const chunked_vector &other) {
+      reserve(other.mSize);
+      for (const T &value : other) { push_back(value); }
+   }
+
+   chunked_vector(chunked_vector &&other) noexcept :
+       mChunks(std::move(other.mChunks)), mSize(std::exchange(other.mSize, 0)) {}
+
+   chunked_vector &operator=(const chunked_vector &other) {
+      if (this == &other) { return *this; }
+      clear();
+      reserve(other.mSize);
+      for (const T &value : other) { push_back(value); }
+      return *this;
+   }
+
+   chunked_vector &operator=(chunked_vector &&other) noexcept {
+      if (this == &other) { return *this; }
+      clear();
+      mChunks = std::move(other.mChunks);
+      mSize = std::exchange(other.mSize, 0);
+      return *this;
+   }
+
+   size_t size() const { return mSize; }
+   bool empty() const { return mSize == 0; }
+   size_t capacity() const { return mChunks.size() * ChunkSize; }
+
+   T &operator[](size_t idx) { return *slot(idx); }
+   const T &operator[](size_t idx) const { return *slot(idx); }
+
+   /// @throws std::out_of_range if @p idx is out of range.
+   T &at(size_t idx) {
+      check_index(idx);
+      return *slot(idx);
+   }
+
+   /// @throws std::out_of_range if @p idx is out of range.
+   const T &at(size_t idx) const {
+      check_index(idx);
+      return *slot(idx);
+   }
+
+   T &back() { return *slot(mSize - 1); }
+   const T &back() const { return *slot(mSize - 1); }
+
+   void push_back(const T &value) { emplace_back(value); }
+   void push_back(T &&value) { emplace_back(std::move(value)); }
+
+   template<typename... Args>
+   T &emplace_back(Args &&...args) {
+      if (mSize == capacity()) { mChunks.push_back(std::make_unique<chunk>()); }
+      T *ptr = std::construct_at(slot(mSize), std::forward<Args>(args)...);
+      ++mSize;
+      return *ptr;
+   }
+
+   void pop_back() { std::destroy_at(slot(--mSize)); }
+
+   void clear() {
+      if constexpr (!std::is_trivially_destructible_v<T>) {
+         while (mSize != 0) { pop_back(); }
+      }
+      mSize = 0;
+   }
+
+   /// @brief Allocates chunks for at least @p count elements.
+   void reserve(size_t count) {
+      const size_t chunks = (count + ChunkSize - 1) / ChunkSize;
+      mChunks.reserve(chunks);
+      while (mChunks.size() < chunks) { mChunks.push_back(std::make_unique<chunk>()); }
+   }
+
+   /// @brief Frees every chunk past the one holding the last element.
+   void shrink_to_fit() {
+      mChunks.resize((mSize + ChunkSize - 1) / ChunkSize);
+      mChunks.shrink_to_fit();
+   }
+
+   iterator begin() { return {this, 0}; }
+   iterator end() { return {this, mSize}; }
+   const_iterator begin() const { return {this, 0}; }
+   const_iterator end() const { return {this, mSize}; }
+
+  private:
+   struct chunk {
+      alignas(T) std::byte bytes[sizeof(T) * ChunkSize];
+   };
+
+   static constexpr size_t CHUNK_SHIFT = std::countr_zero(ChunkSize);
+
+   T *slot(size_t idx) const {
+      std::byte *base = mChunks[idx >> CHUNK_SHIFT]->bytes;
+      return std::launder(reinterpret_cast<T *>(base) + (idx & (ChunkSize - 1)));
+   }
+
+   void check_index(size_t idx) const {
+      if (idx >= mSize) { THROW(std::out_of_range, "chunked_vector::at - index out of range"); }
+   }
+
+   std::vector<std::unique_ptr<chunk>> mChunks;
+   size_t mSize {0};
+};
+
+template<typename T, size_t ChunkSize>
+template<bool IsConst>
+class chunked_vector<T, ChunkSize>::basic_iterator {
+  public:
+   using owner_type = std::conditional_t<IsConst, const chunked_vector, chunked_vector>;
+   using iterator_concept = std::random_access_iterator_tag;
+   using iterator_category = std::random_access_iterator_tag;
+   using difference_type = std::ptrdiff_t;
+   using value_type = T;
+   using reference = std::conditional_t<IsConst, const T &, T &>;
+   using pointer = std::conditional_t<IsConst, const T *, T *>;
+
+   basic_iterator() = default;
+   basic_iterator(owner_type *owner, size_t idx) : mOwner(owner), mIdx(idx) {}
+
+   /// Mutable iterators convert to const ones.
+   operator basic_iterator<true>() const
+      requires(!IsConst)
+   {
+      return {mOwner, mIdx};
+   }
+
+   reference operator*() const { return (*mOwner)[mIdx]; }
+   pointer operator->() const { return &(*mOwner)[mIdx]; }
+   reference operator[](difference_type n) const { return *(*this + n); }
+
+   basic_iterator &operator++() {
+      ++mIdx;
+      return *this;
+   }
+   basic_iterator operator++(int) {
+      auto copy = *this;
+      ++mIdx;
+      return copy;
+   }
+   basic_iterator &operator--() {
+      --mIdx;
+      return *this;
+   }
+   basic_iterator operator--(int) {
+      auto copy = *this;
+      --mIdx;
+      return copy;
+   }
+   basic_iterator &operator+=(difference_type n) {
+      mIdx = static_cast<size_t>(static_cast<difference_type>(mIdx) + n);
+      return *this;
+   }
+   basic_iterator &operator-=(difference_type n) { return *this += -n; }
+
+   friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+   friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+   friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+   friend difference_type operator-(const basic_iterator &a, const basic_iterator &b) {
+      return static_cast<difference_type>(a.mIdx) - static_cast<difference_type>(b.mIdx);
+   }
+
+   friend bool operator==(const basic_iterator &a, const basic_iterator &b) {
+      return a.mIdx == b.mIdx;
+   }
+   friend auto operator<=>(const basic_iterator &a, const basic_iterator &b) {
+      return a.mIdx <=> b.mIdx;
+   }
+
+  private:
+   owner_type *mOwner {nullptr};
+   size_t mIdx {0};
+};
+
+/// @brief A fixed-capacity vector stored inline, for small maps that must never allocate.
+/// @throws std::length_error from push_back and reserve when Capacity would be exceeded.
+template<typename T, size_t Capacity>
+class inline_vector {
+  public:
+   using value_type = T;
+   using size_type = size_t;
+   using reference = T &;
+   using const_reference = const T &;
+   using iterator = T *;
+   using const_iterator = const T *;
+
+   // User-provided so value-initialization does not zero the whole inline buffer.
+   inline_vector() noexcept {} // NOLINT(modernize-use-equals-default)
+   ~inline_vector() { clear(); }
+
+   inline_vector(const inline_vector &other) {
+      for (const T &value : other) { push_back(value); }
+   }
+
+   inline_vector(inline_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+      for (T &value : other) { push_back(std::move(value)); }
+      other.clear();
+   }
+
+   inline_vector &operator=(const inline_vector &other) {
+      if (this == &other) { return *this; }
+      clear();
+      for (const T &value : other) { push_back(value); }
+      return *this;
+   }
+
+   inline_vector &operator=(inline_vector &&other) noexcept(
+       std::is_nothrow_move_constructible_v<T>) {
+      if (this == &other) { return *this; }
+      clear();
+      for (T &value : other) { push_back(std::move(value)); }
+      other.clear();
+      return *this;
+   }
+
+   size_t size() const { return mSize; }
+   bool empty() const { return mSize == 0; }
+   static constexpr size_t capacity() { return Capacity; }
+
+   T *data() { return std::launder(reinterpret_cast<T *>(mBytes)); }
+   const T *data() const { return std::launder(reinterpret_cast<const T *>(mBytes)); }
+
+   T &operator[](size_t idx) { return data()[idx]; }
+   const T &operator[](size_t idx) const { return data()[idx]; }
+
+   /// @throws std::out_of_range if @p idx is out of range.
+   T &at(size_t idx) {
+      check_index(idx);
+      return data()[idx];
+   }
+
+   /// @throws std::out_of_range if @p idx is out of range.
+   const T &at(size_t idx) const {
+      check_index(idx);
+      return data()[idx];
+   }
+
+   T &back() { return data()[mSize - 1]; }
+   const T &back() const { return data()[mSize - 1]; }
+
+   void push_back(const T &value) { emplace_back(value); }
+   void push_back(T &&value) { emplace_back(std::move(value)); }
+
+   template<typename... Args>
+   T &emplace_back(Args &&...args) {
+      if (mSize == Capacity) { THROW(std::length_error, "inline_vector - capacity exceeded"); }
+      T *ptr = std::construct_at(data() + mSize, std::forward<Args>(args)...);
+      ++mSize;
+      return *ptr;
+   }
+
+   void pop_back() { std::destroy_at(data() + --mSize); }
+
+   void clear() {
+      std::destroy_n(data(), mSize);
+      mSize = 0;
+   }
+
+   void reserve(size_t count) const {
+      if (count > Capacity) { THROW(std::length_error, "inline_vector - capacity exceeded"); }
+   }
+
+   iterator begin() { return data(); }
+   iterator end() { return data() + mSize; }
+   const_iterator begin() const { return data(); }
+   const_iterator end() const { return data() + mSize; }
+
+  private:
+   void check_index(size_t idx) const {
+      if (idx >= mSize) { THROW(std::out_of_range, "inline_vector::at - index out of range"); }
+   }
+
+   alignas(T) std::byte mBytes[sizeof(T) * Capacity];
+   size_t mSize {0};
+};
+
+/// Adapts inline_vector to SlotMap's single-parameter Storage, e.g.
+/// SlotMap<Key, Value, inline_storage<64>::type>.
+template<size_t Capacity>
+struct inline_storage {
+   template<typename T>
+   using type = inline_vector<T, Capacity>;
+};
+
+} // namespace tr
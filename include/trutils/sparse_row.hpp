@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "panic.hpp"
+#include "simple_flatmap.hpp"
+#include "type_id.hpp"
+#include "untyped_vector.hpp"
+
+namespace tr {
+
+/// Row storage policy tag for table::create_row: one cell per column, in column dense order.
+struct dense_storage {};
+
+/// Row storage policy tag for table::create_row: cells only for the columns that have one.
+struct sparse_storage {};
+
+/// @brief Packed cells of one row type for a subset of a table's columns.
+///
+/// Cells are kept densely in insertion order, next to the key of the column each belongs to, and
+/// are found by column id through an open-addressing index. Memory and iteration cost follow the
+/// number of cells present rather than the column count. Removal moves the last cell into the
+/// hole, like SlotMap. Column liveness is the table's concern; a sparse_row only sees ids.
+template<typename ColumnKey>
+class sparse_row {
+  public:
+   using column_key = ColumnKey;
+   using column_id = ColumnKey::ID;
+
+   sparse_row(const ty_info &type_info, std::pmr::memory_resource *resource) :
+       mCells(type_info, resource) {}
+
+   size_t size() const { return mCells.size(); }
+   bool empty() const { return mCells.empty(); }
+
+   const ty_info &type_info() const { return mCells.type_info(); }
+
+   bool contains(column_key key) const { return mIndex.contains(key.getID()); }
+
+   /// The cell of column @p key, or nullptr if it has none or T is not the row's type.
+   template<typename T>
+   T *find(column_key key) noexcept {
+      const size_t *idx = mIndex.find(key.getID());
+      return idx ? mCells.try_at<T>(*idx) : nullptr;
+   }
+
+   template<typename T>
+   const T *find(column_key key) const noexcept {
+      const size_t *idx = mIndex.find(key.getID());
+      return idx ? mCells.try_at<T>(*idx) : nullptr;
+   }
+
+   /// @brief Adds a cell holding @p value for column @p key.
+   /// @throws std::invalid_argument if the column already has a cell.
+   template<typename T>
+   T &insert(column_key key, const T &value) {
+      const auto [idx, inserted] = mIndex.try_emplace(key.getID(), mCells.size());
+      if (!inserted) { THROW(std::invalid_argument, "sparse_row::insert - duplicate cell"); }
+      mCells.push_back<T>(value);
+      mKeys.push_back(key);
+      return mCells.back<T>();
+   }
+
+   /// @brief Removes the cell of column @p key, moving the last cell into its place.
+   bool erase(column_key key) {
+      const size_t *found = mIndex.find(key.getID());
+      if (!found) { return false; }
+
+      const size_t idx = *found;
+      const size_t last = mCells.size() - 1;
+      mIndex.erase(key.getID());
+      mCells.swap_and_pop(idx);
+      if (idx != last) {
+         mKeys[idx] = mKeys[last];
+         *mIndex.find(mKeys[idx].getID()) = idx;
+      }
+      mKeys.pop_back();
+      return true;
+   }
+
+   void clear() {
+      mCells.clear();
+      mKeys.clear();
+      mIndex.clear();
+   }
+
+   /// Releases the spare capacity of the cells and keys; the index keeps its size.
+   void shrink_to_fit() {
+      mCells.shrink_to_fit();
+      mKeys.shrink_to_fit();
+   }
+
+   /// Bytes of heap storage held by cells, keys and index, spare capacity included.
+   size_t memory_usage() const {
+      return mCells.memory_usage() + (mKeys.capacity() * sizeof(column_key)) +
+             mIndex.memory_usage();
+   }
+
+   /// Packed cells; cell i belongs to column keys()[i].
+   template<typename T>
+   std::span<T> cells() {
+      return mCells.data<T>();
+   }
+
+   template<typename T>
+   std::span<const T> cells() const {
+      return mCells.data<T>();
+   }
+
+   std::span<const column_key> keys() const { return mKeys; }
+
+  private:
+   untyped_vector mCells;
+   std::vector<column_key> mKeys;
+   open_addressing_index<column_id, std::hash<column_id>, std::equal_to<column_id>> mIndex;
+};
+
+} // namespace tr
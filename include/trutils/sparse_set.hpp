@@ -1,11 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
 
 #include "panic.hpp"
+#include "prefetch.hpp"
+#include "trace.hpp"
 
 namespace tr {
 
@@ -21,6 +32,48 @@ concept TagType = std::is_empty_v<T>;
 //! @brief The default tag for a Slotmap key, if the user does not provide a custom Key.
 class DefaultTag {};
 
+/// @brief Bit layout of a Key: the widths of its id and version fields.
+///
+/// Both fields are packed into one storage_type, which is uint32_t when they fit in 32 bits and
+/// uint64_t otherwise; SparseSet packs its sparse entries the same way. Narrow ids bound how many
+/// keys can be alive at once, and narrow versions make slots retire (see SparseSet) after fewer
+/// reuses, so e.g. key_layout<24, 8> suits small and stable sets and key_layout<40, 24> huge ones.
+template<unsigned IdBits, unsigned VersionBits>
+struct key_layout {
+   static_assert(IdBits >= 2 && VersionBits >= 1 && IdBits + VersionBits <= 64,
+                 "key_layout - id and version must fit in 64 bits");
+
+   static constexpr unsigned id_bits = IdBits;
+   static constexpr unsigned version_bits = VersionBits;
+
+   using storage_type = std::conditional_t<IdBits + VersionBits <= 32, uint32_t, uint64_t>;
+   using id_type = std::conditional_t<IdBits <= 32, uint32_t, uint64_t>;
+   using version_type = std::conditional_t<VersionBits <= 32, uint32_t, uint64_t>;
+
+   static constexpr id_type ID_MASK = static_cast<id_type>(~uint64_t {0} >> (64 - IdBits));
+   static constexpr version_type VERSION_MASK =
+       static_cast<version_type>(~uint64_t {0} >> (64 - VersionBits));
+
+   static constexpr version_type DISABLED_VERSION = VERSION_MASK;
+   static constexpr id_type INVALID_IDX = ID_MASK;
+   static constexpr id_type FREELIST_END_IDX = ID_MASK - 1;
+   static constexpr id_type SPARSE_MAX_IDX = ID_MASK - 2;
+
+   static constexpr storage_type pack(id_type id, version_type version) {
+      return static_cast<storage_type>(static_cast<storage_type>(id) |
+                                       (static_cast<storage_type>(version) << IdBits));
+   }
+   static constexpr id_type id_of(storage_type bits) {
+      return static_cast<id_type>(bits & ID_MASK);
+   }
+   static constexpr version_type version_of(storage_type bits) {
+      return static_cast<version_type>((bits >> IdBits) & VERSION_MASK);
+   }
+};
+
+/// The layout Key uses unless told otherwise: 32-bit ids and 32-bit versions in a uint64_t.
+using default_key_layout = key_layout<32, 32>;
+
 /*! @class Key
  *  @brief The key type used for uniquely identifying values in a slotmap.
  *
@@ -33,59 +86,529 @@ class DefaultTag {};
  * 
  * @tparam Tag A tag type that provides strong typing for user-defined keys. For example,
  *         Key<struct Foo> defines a new, strongly typed Key that is different from Key<struct Bar>
+ * @tparam Layout A key_layout choosing how many bits the id and version get.
 */
-template<TagType Tag>
+template<TagType Tag, typename Layout = default_key_layout>
 class Key {
   public:
-   using ID = uint32_t;
-   ID getID() const { return id; }
+   using layout = Layout;
+   using ID = Layout::id_type;
+   ID getID() const { return id(); }
 
   private:
-   using ID = uint32_t;
-   using Version = uint32_t;
+   using Version = Layout::version_type;
+   using Storage = Layout::storage_type;
 
-   ID id {INVALID_IDX};
-   Version version {0};
+   static constexpr Version DISABLED_VERSION = Layout::DISABLED_VERSION;
+   static constexpr ID INVALID_IDX = Layout::INVALID_IDX;
+   static constexpr ID FREELIST_END_IDX = Layout::FREELIST_END_IDX;
+   static constexpr ID SPARSE_MAX_IDX = Layout::SPARSE_MAX_IDX;
 
-   static constexpr Version DISABLED_VERSION = std::numeric_limits<Version>::max();
-   static constexpr ID INVALID_IDX = std::numeric_limits<ID>::max();
-   static constexpr ID FREELIST_END_IDX = std::numeric_limits<ID>::max() - 1;
-   static constexpr ID SPARSE_MAX_IDX = std::numeric_limits<ID>::max() - 2;
+   Storage bits {Layout::pack(INVALID_IDX, 0)};
+
+   static Key make(ID id, Version version) {
+      Key key;
+      key.bits = Layout::pack(id, version);
+      return key;
+   }
+   ID id() const { return Layout::id_of(bits); }
+   Version version() const { return Layout::version_of(bits); }
 
    // Various friend declarations to avoid exposing internals of this class to users
-   template<typename KeyType>
+   template<typename KeyType, template<typename> class SparseArray>
    friend class SparseSet;
-   friend std::hash<Key<Tag>>;
+   friend std::hash<Key<Tag, Layout>>;
 
    // Equality op for hashing
-   friend bool operator==(const Key<Tag> &key, const Key<Tag> &other) {
-      return key.id == other.id && key.version == other.version;
+   friend bool operator==(const Key &key, const Key &other) { return key.bits == other.bits; }
+};
+
+/// @brief One sparse array slot: the dense index of a live key (or, for a free slot, the next
+/// freelist index) and the slot's current version, packed with the key's own layout.
+template<typename Layout>
+struct sparse_entry {
+   Layout::storage_type bits;
+
+   static sparse_entry make(Layout::id_type denseIdx, Layout::version_type version) {
+      return sparse_entry {Layout::pack(denseIdx, version)};
+   }
+   Layout::id_type denseIdx() const { return Layout::id_of(bits); }
+   Layout::version_type version() const { return Layout::version_of(bits); }
+   void setDenseIdx(Layout::id_type denseIdx) { bits = Layout::pack(denseIdx, version()); }
+};
+
+/// @brief SparseSet sparse-array policy storing every slot in one flat vector.
+///
+/// Lookups are a single bounds check and load. Memory is proportional to the highest id ever
+/// handed out, because the prefix below a live key must stay allocated.
+template<typename KeyType>
+class flat_sparse_array {
+  public:
+   using layout = KeyType::layout;
+   using entry = sparse_entry<layout>;
+   using ID = layout::id_type;
+   using Version = layout::version_type;
+
+   /// Slot @p idx, or nullptr if it has never been allocated.
+   const entry *find(ID idx) const noexcept {
+      return idx < mEntries.size() ? &mEntries[idx] : nullptr;
+   }
+
+   entry &operator[](ID idx) { return mEntries[idx]; }
+   const entry &operator[](ID idx) const { return mEntries[idx]; }
+
+   /// @brief Takes a free slot, or appends one, and points it at @p denseIdx.
+   /// @throws if the sparse array has reached the maximum possible number of entries
+   [[nodiscard]] ID allocate(ID denseIdx) {
+      if (mFreelistHead != layout::FREELIST_END_IDX) {
+         // Reusing an entry from the freelist: update its dense index
+         // to reflect where the new element will live in the dense array.
+         const ID idx = mFreelistHead;
+         mFreelistHead = mEntries[idx].denseIdx();
+         mEntries[idx].setDenseIdx(denseIdx);
+         return idx;
+      }
+
+      // Nothing in freelist, grow sparse array
+      const auto idx = static_cast<ID>(mEntries.size());
+      if (idx == layout::SPARSE_MAX_IDX) [[unlikely]] {
+         THROW(std::runtime_error, "sparse_set - allocation failed: maximum size reached");
+      }
+      mEntries.push_back(entry::make(denseIdx, mVersionFloor));
+      return idx;
+   }
+
+   /// @brief allocate() for dense indices firstDense, firstDense + 1, ... calling @p fn with each
+   /// new slot. Drains the freelist, then appends the rest as one contiguous block.
+   /// @throws if the maximum size is reached; slots passed to @p fn so far stay allocated.
+   template<typename Fn>
+   void allocate_n(size_t count, ID firstDense, Fn &&fn) {
+      for (; count != 0 && mFreelistHead != layout::FREELIST_END_IDX; --count) {
+         fn(allocate(firstDense++));
+      }
+      if (count == 0) { return; }
+
+      const size_t first = mEntries.size();
+      if (count > layout::SPARSE_MAX_IDX - first) [[unlikely]] {
+         THROW(std::runtime_error, "sparse_set - allocation failed: maximum size reached");
+      }
+      mEntries.resize(first + count);
+      for (size_t i = 0; i < count; ++i) {
+         mEntries[first + i] = entry::make(static_cast<ID>(firstDense + i), mVersionFloor);
+         fn(static_cast<ID>(first + i));
+      }
+   }
+
+   /// @brief Frees slot @p idx, bumping its version. Slots that run out of versions retire.
+   void release(ID idx) {
+      auto &slot = mEntries[idx];
+      slot = entry::make(layout::INVALID_IDX, slot.version() + 1);
+
+      // Do not recycle if we max out this slot's version
+      if (slot.version() != layout::DISABLED_VERSION) { push_free(idx); }
+   }
+
+   void clear() {
+      mEntries.clear();
+      mFreelistHead = layout::FREELIST_END_IDX;
+   }
+
+   void reserve(size_t capacity) { mEntries.reserve(capacity); }
+
+   /// Number of allocated slots.
+   size_t size() const { return mEntries.size(); }
+
+   /// Bytes of heap storage held, spare capacity included.
+   size_t memory_usage() const { return mEntries.capacity() * sizeof(entry); }
+
+   /// @brief Drops trailing free slots and rebuilds the freelist in ascending order.
+   /// @param is_live Whether slot idx belongs to a live key.
+   template<typename IsLive>
+   void shrink_to_fit(IsLive &&is_live) {
+      const auto isFree = [&](size_t idx) {
+         return !is_live(idx) && mEntries[idx].version() != layout::DISABLED_VERSION;
+      };
+
+      size_t newSize = mEntries.size();
+      for (; newSize != 0 && isFree(newSize - 1); --newSize) {
+         mVersionFloor = std::max(mVersionFloor, mEntries[newSize - 1].version());
+      }
+      mEntries.resize(newSize);
+      mEntries.shrink_to_fit();
+
+      mFreelistHead = layout::FREELIST_END_IDX;
+      for (size_t idx = newSize; idx-- != 0;) {
+         if (isFree(idx)) { push_free(static_cast<ID>(idx)); }
+      }
+   }
+
+   std::span<const std::byte> bytes() const { return std::as_bytes(std::span(mEntries)); }
+   ID freelist_head() const { return mFreelistHead; }
+   uint64_t version_floor() const { return mVersionFloor; }
+
+   /// @throws std::runtime_error if the image is malformed.
+   static flat_sparse_array from_bytes(std::span<const std::byte> bytes, ID freelist_head,
+                                       uint64_t version_floor) {
+      if (bytes.size() % sizeof(entry) != 0) {
+         THROW(std::runtime_error, "sparse_set::from_bytes - truncated array image");
+      }
+      flat_sparse_array result;
+      result.mEntries.resize(bytes.size() / sizeof(entry));
+      std::memcpy(result.mEntries.data(), bytes.data(), bytes.size());
+      if (freelist_head != layout::FREELIST_END_IDX && freelist_head >= result.mEntries.size()) {
+         THROW(std::runtime_error, "sparse_set::from_bytes - invalid freelist head");
+      }
+      if (version_floor >= layout::DISABLED_VERSION) {
+         THROW(std::runtime_error, "sparse_set::from_bytes - invalid version floor");
+      }
+      result.mFreelistHead = freelist_head;
+      result.mVersionFloor = static_cast<Version>(version_floor);
+      return result;
+   }
+
+   /// @brief Walks the freelist of an image loaded with from_bytes(), so allocate() can trust it.
+   /// @param is_live Whether slot idx belongs to a live key.
+   /// @throws std::runtime_error if the chain leaves the array, revisits a slot, or passes through
+   /// a live or retired slot.
+   template<typename IsLive>
+   void check_freelist(IsLive &&is_live) const {
+      std::vector<bool> seen(mEntries.size(), false);
+      for (ID idx = mFreelistHead; idx != layout::FREELIST_END_IDX;
+           idx = mEntries[idx].denseIdx()) {
+         if (idx >= mEntries.size() || seen[idx] || is_live(idx) ||
+             mEntries[idx].version() == layout::DISABLED_VERSION) {
+            THROW(std::runtime_error, "sparse_set::from_bytes - corrupt freelist");
+         }
+         seen[idx] = true;
+      }
+   }
+
+  private:
+   void push_free(ID idx) {
+      mEntries[idx].setDenseIdx(mFreelistHead);
+      mFreelistHead = idx;
+   }
+
+   std::vector<entry> mEntries;
+   ID mFreelistHead {layout::FREELIST_END_IDX};
+   Version mVersionFloor {0}; ///< Version newly appended slots start at; see shrink_to_fit.
+};
+
+/// @brief SparseSet sparse-array policy storing slots in fixed pages that come and go on demand.
+///
+/// A page of PageSize slots is allocated the first time one of its ids is handed out, and freed
+/// again when its last live key is erased, so memory follows the ranges of live keys rather than
+/// the highest id. One fully empty page is kept as a spare so a key flickering in and out does
+/// not allocate every time. Growth appends a page and never copies slots, and lookups cost one
+/// extra indirection over flat_sparse_array. New keys are taken from the most recently freed
+/// page first.
+template<typename KeyType, size_t PageSize = 4096>
+class paged_sparse_array {
+   static_assert(std::has_single_bit(PageSize),
+                 "paged_sparse_array - PageSize must be a power of two");
+
+  public:
+   using layout = KeyType::layout;
+   using entry = sparse_entry<layout>;
+   using ID = layout::id_type;
+   using Version = layout::version_type;
+
+   static constexpr size_t page_size = PageSize;
+
+   paged_sparse_array() = default;
+   ~paged_sparse_array() = default;
+   paged_sparse_array(paged_sparse_array &&other) noexcept = default;
+   paged_sparse_array &operator=(paged_sparse_array &&other) noexcept = default;
+
+   paged_sparse_array(const paged_sparse_array &other) :
+       mPages(other.mPages.size()),
+       mFreePages(other.mFreePages),
+       mEmptyPages(other.mEmptyPages),
+       mVersionFloor(other.mVersionFloor) {
+      for (size_t i = 0; i < mPages.size(); ++i) {
+         const page &src = other.mPages[i];
+         mPages[i] = page {nullptr, src.freeHead, src.live, src.floor, src.queued};
+         if (src.entries) {
+            mPages[i].entries = std::make_unique_for_overwrite<entry[]>(PageSize);
+            std::copy_n(src.entries.get(), PageSize, mPages[i].entries.get());
+         }
+      }
+   }
+
+   paged_sparse_array &operator=(const paged_sparse_array &other) {
+      if (this != &other) { *this = paged_sparse_array(other); }
+      return *this;
+   }
+
+   /// Slot @p idx, or nullptr if its page is not allocated.
+   const entry *find(ID idx) const noexcept {
+      const size_t pageIdx = idx >> PAGE_SHIFT;
+      if (pageIdx >= mPages.size() || !mPages[pageIdx].entries) { return nullptr; }
+      return &mPages[pageIdx].entries[idx & (PageSize - 1)];
+   }
+
+   entry &operator[](ID idx) { return mPages[idx >> PAGE_SHIFT].entries[idx & (PageSize - 1)]; }
+   const entry &operator[](ID idx) const {
+      return mPages[idx >> PAGE_SHIFT].entries[idx & (PageSize - 1)];
+   }
+
+   /// @brief Takes a free slot, allocating a page if needed, and points it at @p denseIdx.
+   /// @throws if the maximum number of slots has been reached
+   [[nodiscard]] ID allocate(ID denseIdx) {
+      const size_t pageIdx = page_with_free_slot();
+      page &pg = mPages[pageIdx];
+      if (!pg.entries) { materialize(pageIdx); }
+      if (pg.live++ == 0) { --mEmptyPages; }
+
+      const ID local = pg.freeHead;
+      pg.freeHead = pg.entries[local].denseIdx();
+      pg.entries[local].setDenseIdx(denseIdx);
+      return static_cast<ID>((pageIdx << PAGE_SHIFT) + local);
+   }
+
+   /// @brief allocate() for dense indices firstDense, firstDense + 1, ... calling @p fn with each.
+   /// @throws if the maximum size is reached; slots passed to @p fn so far stay allocated.
+   template<typename Fn>
+   void allocate_n(size_t count, ID firstDense, Fn &&fn) {
+      for (size_t i = 0; i < count; ++i) { fn(allocate(static_cast<ID>(firstDense + i))); }
+   }
+
+   /// @brief Frees slot @p idx, bumping its version, and frees its page once nothing in it is live.
+   void release(ID idx) {
+      const size_t pageIdx = idx >> PAGE_SHIFT;
+      page &pg = mPages[pageIdx];
+      const auto local = static_cast<ID>(idx & (PageSize - 1));
+      auto &slot = pg.entries[local];
+      slot = entry::make(layout::INVALID_IDX, slot.version() + 1);
+
+      // Do not recycle if we max out this slot's version
+      if (slot.version() != layout::DISABLED_VERSION) {
+         slot.setDenseIdx(pg.freeHead);
+         pg.freeHead = local;
+         queue(pageIdx);
+      }
+
+      if (--pg.live == 0) {
+         if (mEmptyPages == 0) {
+            ++mEmptyPages; // Keep this one as the spare.
+         } else {
+            drop(pageIdx);
+         }
+      }
    }
+
+   void clear() {
+      mPages.clear();
+      mFreePages.clear();
+      mEmptyPages = 0;
+   }
+
+   void reserve(size_t capacity) { mPages.reserve((capacity + PageSize - 1) / PageSize); }
+
+   /// Number of slots in allocated pages.
+   size_t size() const {
+      return PageSize * static_cast<size_t>(std::ranges::count_if(
+                            mPages, [](const page &pg) { return pg.entries != nullptr; }));
+   }
+
+   /// Bytes of heap storage held by pages and page records, spare capacity included.
+   size_t memory_usage() const {
+      return (size() * sizeof(entry)) + (mPages.capacity() * sizeof(page)) +
+             (mFreePages.capacity() * sizeof(size_t));
+   }
+
+   /// @brief Frees every empty page, trims trailing page records and rebuilds every freelist in
+   /// ascending order.
+   /// @param is_live Whether slot idx belongs to a live key.
+   template<typename IsLive>
+   void shrink_to_fit(IsLive &&is_live) {
+      for (size_t pageIdx = 0; pageIdx < mPages.size(); ++pageIdx) {
+         page &pg = mPages[pageIdx];
+         if (!pg.entries) { continue; }
+         if (pg.live == 0) {
+            drop(pageIdx);
+            continue;
+         }
+         pg.freeHead = layout::FREELIST_END_IDX;
+         for (size_t local = PageSize; local-- != 0;) {
+            entry &slot = pg.entries[local];
+            if (is_live((pageIdx << PAGE_SHIFT) + local) ||
+                slot.version() == layout::DISABLED_VERSION) {
+               continue;
+            }
+            slot.setDenseIdx(pg.freeHead);
+            pg.freeHead = static_cast<ID>(local);
+         }
+      }
+      mEmptyPages = 0;
+
+      // Retired pages stay, otherwise every page appended after them would inherit their floor.
+      while (!mPages.empty() && !mPages.back().entries &&
+             mPages.back().floor != layout::DISABLED_VERSION) {
+         mVersionFloor = std::max(mVersionFloor, mPages.back().floor);
+         mPages.pop_back();
+      }
+      mPages.shrink_to_fit();
+
+      // Lowest pages end up on top of the stack.
+      mFreePages.clear();
+      for (auto &pg : mPages) { pg.queued = false; }
+      for (size_t pageIdx = mPages.size(); pageIdx-- != 0;) { queue(pageIdx); }
+   }
+
+  private:
+   struct page {
+      std::unique_ptr<entry[]> entries;
+      ID freeHead {layout::FREELIST_END_IDX}; ///< Local index of the first free slot.
+      uint32_t live {0};
+      Version floor {0}; ///< Version slots start at when the page is allocated again.
+      bool queued {false}; ///< Whether the page is on mFreePages.
+   };
+
+   static constexpr size_t PAGE_SHIFT = std::countr_zero(PageSize);
+
+   bool has_free_slot(const page &pg) const {
+      return pg.entries ? pg.freeHead != layout::FREELIST_END_IDX
+                        : pg.floor != layout::DISABLED_VERSION;
+   }
+
+   void queue(size_t pageIdx) {
+      page &pg = mPages[pageIdx];
+      if (pg.queued || !has_free_slot(pg)) { return; }
+      pg.queued = true;
+      mFreePages.push_back(pageIdx);
+   }
+
+   size_t page_with_free_slot() {
+      while (!mFreePages.empty()) {
+         page &pg = mPages[mFreePages.back()];
+         if (has_free_slot(pg)) { return mFreePages.back(); }
+         pg.queued = false;
+         mFreePages.pop_back();
+      }
+
+      const size_t pageIdx = mPages.size();
+      if ((pageIdx << PAGE_SHIFT) >= layout::SPARSE_MAX_IDX) [[unlikely]] {
+         THROW(std::runtime_error, "sparse_set - allocation failed: maximum size reached");
+      }
+      mPages.push_back(page {nullptr, layout::FREELIST_END_IDX, 0, mVersionFloor, false});
+      queue(pageIdx);
+      return pageIdx;
+   }
+
+   /// Allocates the slots of a page that has none, all free at the page's version floor.
+   void materialize(size_t pageIdx) {
+      page &pg = mPages[pageIdx];
+      pg.entries = std::make_unique_for_overwrite<entry[]>(PageSize);
+      const size_t base = pageIdx << PAGE_SHIFT;
+      const size_t usable = std::min(PageSize, static_cast<size_t>(layout::SPARSE_MAX_IDX) - base);
+      pg.freeHead = layout::FREELIST_END_IDX;
+      for (size_t local = PageSize; local-- != 0;) {
+         // Slots past the id limit are created retired so they are never handed out.
+         const Version version = local < usable ? pg.floor : layout::DISABLED_VERSION;
+         pg.entries[local] = entry::make(pg.freeHead, version);
+         if (local < usable) { pg.freeHead = static_cast<ID>(local); }
+      }
+      ++mEmptyPages;
+   }
+
+   /// Frees a page with no live slots, remembering its highest version so stale keys into it never
+   /// match slots re-created later. A page holding retired slots ends up retired as a whole.
+   void drop(size_t pageIdx) {
+      page &pg = mPages[pageIdx];
+      Version floor = pg.floor;
+      for (size_t local = 0; local < PageSize; ++local) {
+         floor = std::max(floor, pg.entries[local].version());
+      }
+      pg.entries.reset();
+      pg.freeHead = layout::FREELIST_END_IDX;
+      pg.floor = floor;
+      queue(pageIdx);
+   }
+
+   std::vector<page> mPages;
+   std::vector<size_t> mFreePages; ///< Stack of pages that may have a free slot.
+   size_t mEmptyPages {0};         ///< Allocated pages without live slots.
+   Version mVersionFloor {0};      ///< Version appended pages start at; see shrink_to_fit.
 };
 
-template<typename KeyType = Key<DefaultTag>>
+/// @brief A sparse set handing out versioned keys that map to a dense, contiguous index range.
+///
+/// @tparam SparseArray Policy storing the sparse slots: flat_sparse_array (the default) or
+///         paged_sparse_array for huge or fragmented key spaces.
+template<typename KeyType = Key<DefaultTag>,
+         template<typename> class SparseArray = flat_sparse_array>
 class SparseSet {
    static_assert(tr::is_specialization_of<KeyType, Key>,
                  "KeyType must be a specialization of class Key");
 
   public:
+   using sparse_array = SparseArray<KeyType>;
+
    /// @throws if the maximum size of the set has been reached.
    [[nodiscard]] KeyType insert() {
       auto denseIdx = mDense.size();
-      auto sparseIdx = allocateSparseEntry(static_cast<KeyType::ID>(denseIdx));
-      mDense.push_back(sparseIdx);
+      auto sparseIdx = mSparse.allocate(static_cast<KeyType::ID>(denseIdx));
+      push_dense(sparseIdx);
 
-      KeyType key;
-      key.id = sparseIdx;
-      key.version = mSparse[sparseIdx].version;
-      return key;
+      return make_key(sparseIdx);
+   }
+
+   /// @brief Inserts @p count keys, writing them to @p keys in dense order.
+   ///
+   /// Grows the dense array once, drains the freelist, then appends the remaining sparse entries as
+   /// one contiguous block. Equivalent to calling insert() @p count times.
+   /// @return The output iterator one past the last written key.
+   /// @throws if the maximum size of the set is reached; the keys written so far stay inserted.
+   template<std::output_iterator<KeyType> OutputIt>
+   OutputIt insert_n(size_t count, OutputIt keys) {
+      grow_dense(mDense.size() + count);
+      const auto firstDense = static_cast<KeyType::ID>(mDense.size());
+      mSparse.allocate_n(count, firstDense, [&](KeyType::ID sparseIdx) {
+         mDense.push_back(sparseIdx);
+         *keys++ = make_key(sparseIdx);
+      });
+      return keys;
    }
 
    /// @throws if the set does not contain the given key.
    KeyType::ID get(KeyType key) const {
-      if (!contains(key)) { THROW(std::out_of_range, "sparse_set::get - key not found"); }
+      if (const auto denseIdx = try_get(key)) { return *denseIdx; }
+      THROW(std::out_of_range, "sparse_set::get - key not found");
+   }
 
-      return mSparse[key.id].denseIdx;
+   /// @brief Dense index of @p key, or std::nullopt if the set does not contain it.
+   std::optional<typename KeyType::ID> try_get(KeyType key) const noexcept {
+      const auto *entry = mSparse.find(key.id());
+      if (entry == nullptr || entry->version() != key.version()) { return std::nullopt; }
+      return entry->denseIdx();
+   }
+
+   /// @brief Like get(), but the key is only validated when TR_DEBUG_CHECKS is enabled.
+   KeyType::ID unchecked_get(KeyType key) const {
+#if TR_DEBUG_CHECKS
+      return get(key);
+#else
+      return mSparse[key.id()].denseIdx();
+#endif
+   }
+
+   /// @brief Hints the CPU to start loading the sparse entry of @p key, e.g. a batch ahead of
+   /// calls to get(). Unknown keys are ignored.
+   void prefetch(KeyType key) const {
+      if (const auto *entry = mSparse.find(key.id())) { tr::prefetch(entry); }
+   }
+
+   /// @brief Writes get(keys[i]) to out[i] for every key, prefetching all sparse entries first so
+   /// their misses overlap instead of being paid one after another.
+   /// @throws std::invalid_argument if @p out is shorter than @p keys.
+   /// @throws std::out_of_range if a key is not in the set; earlier indices are already written.
+   void get_many(std::span<const KeyType> keys, std::span<typename KeyType::ID> out) const {
+      if (out.size() < keys.size()) {
+         THROW(std::invalid_argument, "sparse_set::get_many - output span too short");
+      }
+      for (const KeyType key : keys) { prefetch(key); }
+      for (size_t i = 0; i < keys.size(); ++i) { out[i] = get(keys[i]); }
    }
 
    bool erase(const KeyType &key) {
@@ -93,7 +616,7 @@ class SparseSet {
       auto sparseIdxToUpdate = mDense.back();
 
       // Swap and pop from dense array
-      auto denseIdx = mSparse[key.id].denseIdx;
+      auto denseIdx = mSparse[key.id()].denseIdx();
       if (denseIdx != mDense.size() - 1) {
          // If we aren't the last/only element, swap and pop
          auto oldDenseSize = mDense.size();
@@ -101,26 +624,40 @@ class SparseSet {
          mDense.pop_back();
 
          // Update bookkeeping, but only if we actually swapped an element
-         mSparse[sparseIdxToUpdate].denseIdx = denseIdx;
+         mSparse[sparseIdxToUpdate].setDenseIdx(denseIdx);
       } else {
          mDense.pop_back();
       }
 
-      freeSparseEntry(key.id);
+      mSparse.release(key.id());
       return true;
    }
 
-   inline bool contains(const KeyType &key) const {
-      return key.id < mSparse.size() && mSparse[key.id].version == key.version;
+   inline bool contains(const KeyType &key) const noexcept {
+      const auto *entry = mSparse.find(key.id());
+      return entry != nullptr && entry->version() == key.version();
    }
 
    inline void clear() {
       mDense.clear();
       mSparse.clear();
-      mFreelistHead = KeyType::FREELIST_END_IDX;
+   }
+
+   /// @brief Reserves storage for at least @p capacity live keys without reallocating.
+   void reserve(size_t capacity) {
+      mDense.reserve(capacity);
+      mSparse.reserve(capacity);
    }
 
    inline size_t size() const { return mDense.size(); }
+
+   /// @brief Number of keys the set can hold before its dense array reallocates.
+   size_t capacity() const { return mDense.capacity(); }
+
+   /// @brief Bytes of heap storage held by the dense and sparse arrays, spare capacity included.
+   size_t memory_usage() const {
+      return (mDense.capacity() * sizeof(typename KeyType::ID)) + mSparse.memory_usage();
+   }
    inline bool empty() const { return mDense.empty(); }
 
    /// @brief Valid key for the element at dense_idx in dense iteration order.
@@ -129,84 +666,168 @@ class SparseSet {
       if (dense_idx >= mDense.size()) {
          THROW(std::out_of_range, "sparse_set::key_at_dense - index out of range");
       }
-      const auto sparse_idx = mDense[dense_idx];
-      KeyType key {};
-      key.id = sparse_idx;
-      key.version = mSparse[sparse_idx].version;
-      return key;
+      return make_key(mDense[dense_idx]);
    }
 
-  private:
-   /// @throws if the sparse array has reached the maximum possible number of entries
-   [[nodiscard]] KeyType::ID allocateSparseEntry(KeyType::ID denseIdx) {
-      auto idx = freelistPop();
-      if (idx != KeyType::INVALID_IDX) {
-         // Reusing an entry from the freelist: update its dense index
-         // to reflect where the new element will live in the dense array.
-         mSparse[idx].denseIdx = denseIdx;
-         return idx;
+   /// @brief Reorders the dense array so that position k holds the key formerly at @p order[k].
+   ///
+   /// Keys stay valid and get() reflects the new positions.
+   /// @throws std::invalid_argument if @p order is not a permutation of [0, size()); the set is
+   /// left unchanged.
+   void permute_dense(std::span<const size_t> order) {
+      if (order.size() != mDense.size()) {
+         THROW(std::invalid_argument, "sparse_set::permute_dense - not a permutation");
+      }
+      std::vector<bool> seen(order.size(), false);
+      for (const size_t idx : order) {
+         if (idx >= seen.size() || seen[idx]) {
+            THROW(std::invalid_argument, "sparse_set::permute_dense - not a permutation");
+         }
+         seen[idx] = true;
       }
 
-      // Nothing in freelist, grow sparse array
-      idx = static_cast<KeyType::ID>(mSparse.size());
-      if (idx == KeyType::SPARSE_MAX_IDX) [[unlikely]] {
-         THROW(std::runtime_error, "sparse_set - allocation failed: maximum size reached");
+      std::vector<typename KeyType::ID> dense(order.size());
+      for (size_t k = 0; k < order.size(); ++k) {
+         dense[k] = mDense[order[k]];
+         mSparse[dense[k]].setDenseIdx(static_cast<KeyType::ID>(k));
       }
-      mSparse.push_back(SparseEntry {denseIdx, 0});
-      return idx;
+      mDense = std::move(dense);
    }
 
-   void freeSparseEntry(KeyType::ID sparseIdx) {
-      mSparse[sparseIdx].denseIdx = KeyType::INVALID_IDX;
-      mSparse[sparseIdx].version += 1;
+   /// @brief Exchanges the keys at dense positions @p a and @p b.
+   /// @throws std::out_of_range if either position is >= size().
+   void swap_dense(size_t a, size_t b) {
+      if (a >= mDense.size() || b >= mDense.size()) {
+         THROW(std::out_of_range, "sparse_set::swap_dense - index out of range");
+      }
+      std::swap(mDense[a], mDense[b]);
+      mSparse[mDense[a]].setDenseIdx(static_cast<KeyType::ID>(a));
+      mSparse[mDense[b]].setDenseIdx(static_cast<KeyType::ID>(b));
+   }
 
-      // Do not recycle if we max out this slot's version
-      if (mSparse[sparseIdx].version != KeyType::DISABLED_VERSION) { freelistPush(sparseIdx); }
+   /// @brief Releases unused sparse memory and rebuilds the freelist in ascending order.
+   ///
+   /// Afterwards freed slots are reused lowest index first, which keeps new keys close together.
+   /// With flat_sparse_array, trailing free entries are dropped; with paged_sparse_array, every
+   /// page without live keys is freed. Keys that pointed at dropped entries stay invalid: entries
+   /// later re-created in their place start at a version above any dropped one. Slots that
+   /// exhausted their versions are retired and kept, since reusing them could revive stale keys.
+   void shrink_to_fit() {
+      // Each slot is asked about before the rebuild rewrites its link, so the check stays sound.
+      mSparse.shrink_to_fit([&](size_t idx) { return is_live_slot(idx); });
+      mDense.shrink_to_fit();
+   }
+
+   /// @brief Number of allocated sparse entries, live or not.
+   size_t sparse_size() const { return mSparse.size(); }
+
+   /// @brief Byte image of the dense array, for snapshotting. The layout is implementation-defined
+   /// and only meaningful to from_bytes() of the same SparseSet type.
+   std::span<const std::byte> dense_bytes() const { return std::as_bytes(std::span(mDense)); }
+
+   /// @brief Byte image of the sparse array, for snapshotting. See dense_bytes().
+   std::span<const std::byte> sparse_bytes() const
+      requires requires(const sparse_array &arr) { arr.bytes(); }
+   {
+      return mSparse.bytes();
+   }
+
+   /// @brief Head of the sparse freelist, for snapshotting. See dense_bytes().
+   KeyType::ID freelist_head() const
+      requires requires(const sparse_array &arr) { arr.freelist_head(); }
+   {
+      return mSparse.freelist_head();
    }
 
-   [[nodiscard]] KeyType::ID freelistPop() {
-      auto oldHead = mFreelistHead;
-      if (oldHead == KeyType::FREELIST_END_IDX) { return KeyType::INVALID_IDX; }
-      mFreelistHead = freelistNext(oldHead);
-      return oldHead;
+   /// @brief Version newly appended sparse entries start at, for snapshotting. See shrink_to_fit().
+   uint64_t version_floor() const
+      requires requires(const sparse_array &arr) { arr.version_floor(); }
+   {
+      return mSparse.version_floor();
    }
 
-   KeyType::ID freelistNext(KeyType::ID freelistIdx) {
-      auto result = KeyType::FREELIST_END_IDX;
-      if (freelistIdx != KeyType::FREELIST_END_IDX) { result = mSparse[freelistIdx].denseIdx; }
+   /// @brief Rebuilds a set from images taken with dense_bytes(), sparse_bytes(), freelist_head()
+   /// and version_floor(). Keys issued by the original set stay valid in the rebuilt one.
+   /// @throws std::runtime_error if the images are not a consistent set.
+   static SparseSet from_bytes(std::span<const std::byte> dense, std::span<const std::byte> sparse,
+                               KeyType::ID freelist_head, uint64_t version_floor = 0) {
+      if (dense.size() % sizeof(typename KeyType::ID) != 0) {
+         THROW(std::runtime_error, "sparse_set::from_bytes - truncated array image");
+      }
 
-      return result;
+      SparseSet set;
+      set.mSparse = sparse_array::from_bytes(sparse, freelist_head, version_floor);
+      set.mDense.resize(dense.size() / sizeof(typename KeyType::ID));
+      std::memcpy(set.mDense.data(), dense.data(), dense.size());
+
+      for (size_t i = 0; i < set.mDense.size(); ++i) {
+         const auto *entry = set.mSparse.find(set.mDense[i]);
+         if (entry == nullptr || entry->denseIdx() != i) {
+            THROW(std::runtime_error, "sparse_set::from_bytes - inconsistent array images");
+         }
+      }
+      set.mSparse.check_freelist([&](size_t idx) { return set.is_live_slot(idx); });
+      return set;
    }
 
-   void freelistPush(KeyType::ID sparseIdx) {
-      auto oldHead = mFreelistHead;
-      mFreelistHead = sparseIdx;
-      mSparse[sparseIdx].denseIdx = oldHead;
+  private:
+   /// Whether sparse slot @p idx belongs to a live key. Free slots keep their freelist link in the
+   /// dense index field, so the dense array must point back at the slot as well.
+   bool is_live_slot(size_t idx) const {
+      const auto *entry = mSparse.find(static_cast<typename KeyType::ID>(idx));
+      return entry != nullptr && entry->denseIdx() < mDense.size() &&
+             mDense[entry->denseIdx()] == idx;
    }
 
-   KeyType::ID mFreelistHead {KeyType::FREELIST_END_IDX};
-   std::vector<typename KeyType::ID> mDense {};
+   KeyType make_key(KeyType::ID sparseIdx) const {
+      return KeyType::make(sparseIdx, mSparse[sparseIdx].version());
+   }
 
-   struct SparseEntry {
-      union {
-         KeyType::ID denseIdx;
-         KeyType::ID freelistNext;
-      };
-      KeyType::Version version;
-   };
+   /// Appends to the dense array, tracing the reallocation the push_back is about to do, if any.
+   /// The vector's own growth policy is kept, so traced builds allocate as untraced ones do.
+   void push_dense(typename KeyType::ID sparseIdx) {
+#if TR_TRACE
+      if (mDense.size() == mDense.capacity()) {
+         TR_TRACE_ZONE("SparseSet::grow");
+         mDense.push_back(sparseIdx);
+         TR_TRACE_COUNTER("SparseSet::capacity", mDense.capacity());
+         return;
+      }
+#endif
+      mDense.push_back(sparseIdx);
+   }
 
-   std::vector<SparseEntry> mSparse {};
+   /// Makes room for @p needed dense entries, at least doubling the capacity when it reallocates
+   /// so that repeated batches stay amortized like push_back.
+   void grow_dense(size_t needed) {
+      if (needed > mDense.capacity()) { reserve_dense(std::max(needed, 2 * mDense.capacity())); }
+   }
+
+   /// mDense.reserve(capacity), traced when it reallocates.
+   void reserve_dense(size_t capacity) {
+#if TR_TRACE
+      if (capacity > mDense.capacity()) {
+         TR_TRACE_ZONE("SparseSet::grow");
+         mDense.reserve(capacity);
+         TR_TRACE_COUNTER("SparseSet::capacity", mDense.capacity());
+         return;
+      }
+#endif
+      mDense.reserve(capacity);
+   }
+
+   std::vector<typename KeyType::ID> mDense {};
+   sparse_array mSparse {};
 };
 
 } // namespace tr
 
 // NOLINTBEGIN
 namespace std {
-template<typename T>
-struct hash<tr::Key<T>> {
-   std::size_t operator()(const tr::Key<T> &key) const noexcept {
-      // Note/Todo: Will not work if we widen the types
-      return std::hash<uint64_t> {}((uint64_t)key.id | ((uint64_t)key.version) << 32);
+template<typename T, typename Layout>
+struct hash<tr::Key<T, Layout>> {
+   std::size_t operator()(const tr::Key<T, Layout> &key) const noexcept {
+      return std::hash<uint64_t> {}(static_cast<uint64_t>(key.bits));
    }
 };
 // NOLINTEND
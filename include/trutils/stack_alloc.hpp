@@ -3,15 +3,54 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <memory>
 #include <memory_resource>
+#include <new>
 #include <span>
+#include <vector>
+
+#include "trace.hpp"
+
+// Controls whether StackAlloc keeps allocation statistics. Off by default; when 0, stats() always
+// returns zeros and the bookkeeping is compiled out. Must have the same value in every translation
+// unit of a program.
+#ifndef TR_STACK_ALLOC_STATS
+#define TR_STACK_ALLOC_STATS 0
+#endif
 
 namespace tr {
 
 constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
 
+/// @brief Usage counters of a StackAlloc, see StackAlloc::stats().
+///
+/// The in-use figures describe the live allocations and go down again when a checkpoint scope
+/// ends or reset() is called; the totals only ever grow.
+struct stack_alloc_stats {
+   size_t allocations {0};      ///< Total calls to allocate.
+   size_t bytesAllocated {0};   ///< Total bytes requested.
+   size_t bytesInUse {0};       ///< Bytes requested by live allocations.
+   size_t paddingBytes {0};     ///< Bytes of live blocks skipped to align allocations.
+   size_t blockTailBytes {0};   ///< Bytes left unused at the end of live blocks that filled up.
+   size_t highWaterMark {0};    ///< Highest bytesInUse + paddingBytes + blockTailBytes seen.
+   size_t blockCount {0};       ///< Blocks owned, including spare ones kept for reuse.
+   size_t largeBlockCount {0};  ///< Live large blocks.
+   size_t frameAllocations {0}; ///< Calls to allocate since the last reset().
+   size_t frames {0};           ///< Calls to reset().
+};
+
+/// Called by StackAlloc::reset() with the statistics of the frame that is ending.
+using stack_alloc_stats_hook = void (*)(const stack_alloc_stats &stats, void *user);
+
+/// @brief Bump allocator handing out memory from a list of fixed-size blocks.
+///
+/// Deallocation is a no-op; memory is reclaimed all at once by reset() or by leaving a
+/// StackAllocCheckpoint scope. Both rewind the blocks and keep them for reuse, so steady-state
+/// scratch usage, e.g. once per frame, allocates nothing from the heap. Requests that cannot fit
+/// in a block get a dedicated large block, which is freed again on rewind.
 template<size_t BlockSize = DEFAULT_BLOCK_SIZE>
 class StackAlloc : public std::pmr::memory_resource {
   public:
@@ -19,7 +58,50 @@ class StackAlloc : public std::pmr::memory_resource {
       mBlocks.emplace_back();
       assert(mBlocks.back().top == &mBlocks.back().buf[0]);
    }
-   void reset() { mBlocks.clear(); }
+   ~StackAlloc() override { freeLargeBlocks(0); }
+   StackAlloc(const StackAlloc &other) = delete;
+   StackAlloc &operator=(const StackAlloc &other) = delete;
+   StackAlloc(StackAlloc &&other) noexcept = delete;
+   StackAlloc &operator=(StackAlloc &&other) noexcept = delete;
+
+   /// @brief Invalidates every allocation. Blocks are kept and reused; large blocks are freed.
+   ///
+   /// Each call ends a frame: the stats hook, if any, sees the frame's statistics first.
+   void reset() {
+#if TR_STACK_ALLOC_STATS
+      if (mStatsHook) { mStatsHook(stats(), mStatsUser); }
+      mStats.frameAllocations = 0;
+      ++mStats.frames;
+      mStats.bytesInUse = mStats.paddingBytes = mStats.blockTailBytes = 0;
+      mScopeHighWater = 0;
+#endif
+      mActive = 0;
+      mBlocks.front().rewind();
+      freeLargeBlocks(0);
+   }
+
+   /// @brief Allocation statistics, or all zeros unless TR_STACK_ALLOC_STATS is enabled.
+   stack_alloc_stats stats() const {
+#if TR_STACK_ALLOC_STATS
+      stack_alloc_stats result = mStats;
+      result.blockCount = mBlocks.size();
+      result.largeBlockCount = mLargeBlocks.size();
+      return result;
+#else
+      return {};
+#endif
+   }
+
+   /// @brief Installs @p hook to be called at every reset(), e.g. to forward the statistics to a
+   /// tracing backend. Pass nullptr to remove it. Does nothing unless TR_STACK_ALLOC_STATS is
+   /// enabled.
+   void set_stats_hook([[maybe_unused]] stack_alloc_stats_hook hook,
+                       [[maybe_unused]] void *user = nullptr) {
+#if TR_STACK_ALLOC_STATS
+      mStatsHook = hook;
+      mStatsUser = user;
+#endif
+   }
 
    template<typename T>
    std::span<T> allocArr(size_t nElem) {
@@ -37,17 +119,44 @@ class StackAlloc : public std::pmr::memory_resource {
 
   protected:
    void *do_allocate(size_t size, size_t alignment = alignof(std::max_align_t)) override {
-      assert(size < Block::BLOCK_USABLE_SZ);
-      auto &block = mBlocks.back();
-      if (!std::align(alignment, size, block.top, block.remainder)) {
-         mBlocks.emplace_back();
-         return do_allocate(size, alignment);
+#if TR_STACK_ALLOC_STATS
+      ++mStats.allocations;
+      ++mStats.frameAllocations;
+      mStats.bytesAllocated += size;
+      mStats.bytesInUse += size;
+#endif
+      auto *block = &mBlocks[mActive];
+      [[maybe_unused]] size_t before = block->remainder;
+      if (!std::align(alignment, size, block->top, block->remainder)) {
+         // Worst-case padding included, so the retry in a fresh block cannot fail.
+         if (size > Block::BLOCK_USABLE_SZ - std::min(alignment, Block::BLOCK_USABLE_SZ)) {
+            void *ptr = allocateLarge(size, alignment);
+            recordUsage();
+            return ptr;
+         }
+#if TR_STACK_ALLOC_STATS
+         mStats.blockTailBytes += block->remainder;
+#endif
+         TR_TRACE_ZONE("StackAlloc::spill");
+         if (++mActive == mBlocks.size()) {
+            mBlocks.emplace_back();
+            TR_TRACE_COUNTER("StackAlloc::blocks", mBlocks.size());
+         } else {
+            mBlocks[mActive].rewind();
+         }
+         block = &mBlocks[mActive];
+         before = block->remainder;
+         std::align(alignment, size, block->top, block->remainder);
       }
 
-      void *ptr = block.top;
+      void *ptr = block->top;
 
-      block.top = ((uint8_t *)block.top) + size;
-      block.remainder -= size;
+#if TR_STACK_ALLOC_STATS
+      mStats.paddingBytes += before - block->remainder;
+#endif
+      block->top = ((uint8_t *)block->top) + size;
+      block->remainder -= size;
+      recordUsage();
 
       return ptr;
    }
@@ -62,36 +171,112 @@ class StackAlloc : public std::pmr::memory_resource {
    }
 
    struct Block {
-      static const size_t BLOCK_USABLE_SZ = BlockSize - (sizeof(size_t) * 2);
+      static constexpr size_t BLOCK_USABLE_SZ = BlockSize - (sizeof(size_t) * 2);
 
       std::array<uint8_t, BLOCK_USABLE_SZ> buf;
       void *top {(void *)buf.data()};
       size_t remainder {buf.size()};
+
+      void rewind() {
+         top = (void *)buf.data();
+         remainder = buf.size();
+      }
+   };
+
+   /// Dedicated allocation for a request too big for a block.
+   struct LargeBlock {
+      void *ptr {nullptr};
+      size_t size {0};
+      size_t alignment {0};
    };
 
    template<size_t BS>
    friend class StackAllocCheckpoint;
 
   private:
+   void recordUsage() {
+#if TR_STACK_ALLOC_STATS
+      const size_t footprint = mStats.bytesInUse + mStats.paddingBytes + mStats.blockTailBytes;
+      mStats.highWaterMark = std::max(mStats.highWaterMark, footprint);
+      mScopeHighWater = std::max(mScopeHighWater, footprint);
+#endif
+   }
+
+   void *allocateLarge(size_t size, size_t alignment) {
+      TR_TRACE_ZONE("StackAlloc::allocate_large");
+      mLargeBlocks.reserve(mLargeBlocks.size() + 1);
+      void *ptr = ::operator new(size, std::align_val_t {alignment});
+      mLargeBlocks.push_back(LargeBlock {ptr, size, alignment});
+      return ptr;
+   }
+
+   void freeLargeBlocks(size_t keep) {
+      while (mLargeBlocks.size() > keep) {
+         const LargeBlock &large = mLargeBlocks.back();
+         ::operator delete(large.ptr, large.size, std::align_val_t {large.alignment});
+         mLargeBlocks.pop_back();
+      }
+   }
+
    /// std::deque ensures stability when growing the block list. For most deque implementations,
    /// this will likely degenerate to a linked list, but that's fine considering the size of the blocks.
    std::deque<Block> mBlocks;
+   /// Block currently allocated from; the blocks after it are spare and rewound on first use.
+   size_t mActive {0};
+   std::vector<LargeBlock> mLargeBlocks;
+#if TR_STACK_ALLOC_STATS
+   stack_alloc_stats mStats;
+   size_t mScopeHighWater {0}; ///< High-water mark of the innermost checkpoint scope.
+   stack_alloc_stats_hook mStatsHook {nullptr};
+   void *mStatsUser {nullptr};
+#endif
 };
 
+/// @brief Rewinds a StackAlloc to its state at construction when the scope ends.
+///
+/// Blocks filled inside the scope are kept for reuse and large blocks allocated inside it are
+/// freed. Checkpoints must be destroyed in reverse order of construction.
 template<size_t BlockSize = DEFAULT_BLOCK_SIZE>
 class StackAllocCheckpoint {
   public:
-   explicit StackAllocCheckpoint(StackAlloc<BlockSize> &allocator) : mAllocator(allocator) {
-      const size_t blockCount = allocator.mBlocks.size();
-      auto &block = allocator.mBlocks.back();
-      data = CheckpointData {blockCount, block.top, block.remainder};
+   explicit StackAllocCheckpoint(StackAlloc<BlockSize> &allocator) :
+       mAllocator(allocator),
+       data {allocator.mActive, allocator.mBlocks[allocator.mActive].top,
+             allocator.mBlocks[allocator.mActive].remainder, allocator.mLargeBlocks.size()} {
+#if TR_STACK_ALLOC_STATS
+      const auto &stats = allocator.mStats;
+      mUsage = {stats.bytesInUse, stats.paddingBytes, stats.blockTailBytes,
+                allocator.mScopeHighWater};
+      allocator.mScopeHighWater = footprint();
+#endif
    }
    ~StackAllocCheckpoint() {
-      assert(mAllocator.mBlocks.size() >= data.blockCount);
-      mAllocator.mBlocks.resize(data.blockCount);
-      auto &block = mAllocator.mBlocks.back();
+      assert(mAllocator.mActive >= data.activeBlock);
+      mAllocator.mActive = data.activeBlock;
+      auto &block = mAllocator.mBlocks[data.activeBlock];
       block.top = data.top;
       block.remainder = data.remainder;
+      mAllocator.freeLargeBlocks(data.largeBlockCount);
+#if TR_STACK_ALLOC_STATS
+      auto &stats = mAllocator.mStats;
+      stats.bytesInUse = mUsage.bytesInUse;
+      stats.paddingBytes = mUsage.paddingBytes;
+      stats.blockTailBytes = mUsage.blockTailBytes;
+      // The enclosing scope's peak includes this one's.
+      mAllocator.mScopeHighWater = std::max(mAllocator.mScopeHighWater, mUsage.outerHighWater);
+#endif
+   }
+
+   /// @brief Peak allocator footprint reached inside this scope so far, relative to the footprint
+   /// when the scope began, counting padding and block tails. Zero unless TR_STACK_ALLOC_STATS
+   /// is enabled.
+   size_t peak_bytes() const {
+#if TR_STACK_ALLOC_STATS
+      const size_t start = mUsage.bytesInUse + mUsage.paddingBytes + mUsage.blockTailBytes;
+      return mAllocator.mScopeHighWater - start;
+#else
+      return 0;
+#endif
    }
    StackAllocCheckpoint(const StackAllocCheckpoint &other) = delete;
    StackAllocCheckpoint &operator=(const StackAllocCheckpoint &other) = delete;
@@ -101,11 +286,39 @@ class StackAllocCheckpoint {
   private:
    StackAlloc<BlockSize> &mAllocator;
    struct CheckpointData {
-      size_t blockCount {0};
+      size_t activeBlock {0};
       void *top {nullptr};
       size_t remainder {0};
+      size_t largeBlockCount {0};
    };
    CheckpointData data;
+#if TR_STACK_ALLOC_STATS
+   struct ScopeUsage {
+      size_t bytesInUse {0};
+      size_t paddingBytes {0};
+      size_t blockTailBytes {0};
+      size_t outerHighWater {0};
+   };
+   ScopeUsage mUsage;
+
+   size_t footprint() const {
+      const auto &stats = mAllocator.mStats;
+      return stats.bytesInUse + stats.paddingBytes + stats.blockTailBytes;
+   }
+#endif
 };
 
-} // namespace tr
\ No newline at end of file
+/// @brief The calling thread's scratch arena, created on first use.
+///
+/// Each thread gets its own StackAlloc, so workers can allocate scratch memory without any
+/// contention. Pair it with a checkpoint to release everything at the end of a task:
+///
+///     StackAllocCheckpoint scope(tr::scratch());
+///     std::pmr::vector<int> tmp(&tr::scratch());
+template<size_t BlockSize = DEFAULT_BLOCK_SIZE>
+StackAlloc<BlockSize> &scratch() {
+   thread_local StackAlloc<BlockSize> arena;
+   return arena;
+}
+
+} // namespace tr
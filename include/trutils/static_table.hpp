@@ -0,0 +1,233 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "sparse_set.hpp"
+#include "table.hpp"
+#include "type_id.hpp"
+#include "untyped_vector.hpp"
+
+namespace tr {
+
+/// @brief A table whose set of row types is fixed at compile time.
+///
+/// Each row type is mapped to a fixed slot in a std::array at compile time, so cell, get_row and
+/// query_column resolve their row with a constant offset instead of a ty_id lookup, and skip the
+/// runtime element type check (see TR_DEBUG_CHECKS) since the slot already fixes it. Rows cannot be
+/// created or erased. Otherwise it mirrors table: it hands out the same row_view type, and its
+/// iteration goes through the same basic_table_columns_iter and basic_table_query templates, so
+/// code can move between the two incrementally.
+template<typename ColumnTagT, typename... Rows>
+class static_table {
+  public:
+   using column_key = Key<ColumnTagT>;
+   using column_mapping = SparseSet<column_key>;
+   template<typename Cell>
+   using row_view = typename table<ColumnTagT>::template row_view<Cell>;
+
+   static_table() : mRows {untyped_vector(getTypeInfo<Rows>())...} {
+      static_assert(has_unique_rows(), "static_table - duplicate row type");
+   }
+
+   template<typename T>
+   static constexpr bool contains_row() {
+      return ((getTypeID<T>() == getTypeID<Rows>()) || ...);
+   }
+
+   static constexpr size_t row_count() { return sizeof...(Rows); }
+
+   /// Dense, unordered row storage — use row_view for key lookups.
+   template<typename T>
+   std::span<T> get_row() {
+      return row<T>().template unchecked_data<T>();
+   }
+
+   template<typename T>
+   std::span<const T> get_row() const {
+      return row<T>().template unchecked_data<T>();
+   }
+
+   template<typename T>
+   row_view<T> get_row_view() {
+      return row_view<T>(mColumnMapping, row<T>());
+   }
+
+   /// @brief Adds a column; extends every row by one default-initialized cell.
+   [[nodiscard]] column_key insert_column() {
+      column_key key = mColumnMapping.insert();
+      for (auto &row : mRows) { row.push_back_default(); }
+      return key;
+   }
+
+   /// @brief Adds @p count columns, writing their keys to @p keys. See table::insert_columns.
+   template<std::output_iterator<column_key> OutputIt>
+   OutputIt insert_columns(size_t count, OutputIt keys) {
+      keys = mColumnMapping.insert_n(count, keys);
+      for (auto &row : mRows) { row.push_back_default(count); }
+      return keys;
+   }
+
+   bool erase_column(column_key key) {
+      if (!mColumnMapping.contains(key)) { return false; }
+
+      const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
+      for (auto &row : mRows) { row.swap_and_pop(colIdx); }
+      mColumnMapping.erase(key);
+      return true;
+   }
+
+   /// @brief Erases every live column in @p keys. See table::erase_columns.
+   size_t erase_columns(std::span<const column_key> keys) {
+      std::vector<size_t> denseIndices;
+      denseIndices.reserve(keys.size());
+      for (const column_key key : keys) {
+         if (!mColumnMapping.contains(key)) { continue; }
+         denseIndices.push_back(static_cast<size_t>(mColumnMapping.get(key)));
+         mColumnMapping.erase(key);
+      }
+
+      for (auto &row : mRows) { row.swap_and_pop(denseIndices); }
+      return denseIndices.size();
+   }
+
+   /// @throws std::out_of_range if key is not a live column.
+   template<typename T>
+   T &cell(column_key key) {
+      return row<T>().template unchecked_at<T>(column_index(key));
+   }
+
+   template<typename T>
+   const T &cell(column_key key) const {
+      return row<T>().template unchecked_at<T>(column_index(key));
+   }
+
+   /// @brief cell() that skips validating @p key and the stored type unless TR_DEBUG_CHECKS is on.
+   template<typename T>
+   T &unchecked_cell(column_key key) {
+      const auto colIdx = static_cast<size_t>(mColumnMapping.unchecked_get(key));
+      return row<T>().template unchecked_at<T>(colIdx);
+   }
+
+   template<typename T>
+   const T &unchecked_cell(column_key key) const {
+      const auto colIdx = static_cast<size_t>(mColumnMapping.unchecked_get(key));
+      return row<T>().template unchecked_at<T>(colIdx);
+   }
+
+   /// @throws std::out_of_range if the column key is invalid.
+   template<typename... RowTs>
+   std::tuple<RowTs &...> query_column(column_key key) {
+      [[maybe_unused]] const size_t colIdx = column_index(key);
+      return std::tuple<RowTs &...> {row<RowTs>().template unchecked_at<RowTs>(colIdx)...};
+   }
+
+   template<typename... RowTs>
+   std::tuple<const RowTs &...> query_column(column_key key) const {
+      [[maybe_unused]] const size_t colIdx = column_index(key);
+      return std::tuple<const RowTs &...> {row<RowTs>().template unchecked_at<RowTs>(colIdx)...};
+   }
+
+   bool contains_column(column_key key) const { return mColumnMapping.contains(key); }
+
+   /// @throws std::out_of_range if @p key is not a live column.
+   size_t column_index(column_key key) const {
+      return static_cast<size_t>(mColumnMapping.get(key));
+   }
+
+   size_t column_count() const { return mColumnMapping.size(); }
+
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_columns_iter<static_table, false, RowTs...> columns_begin() {
+      return {this, 0};
+   }
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_columns_iter<static_table, false, RowTs...> columns_end() {
+      return {this, column_count()};
+   }
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_columns_iter<static_table, true, RowTs...> columns_begin() const {
+      return {this, 0};
+   }
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_columns_iter<static_table, true, RowTs...> columns_end() const {
+      return {this, column_count()};
+   }
+
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_query<static_table, false, RowTs...> query() {
+      return basic_table_query<static_table, false, RowTs...>(*this);
+   }
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_query<static_table, true, RowTs...> query() const {
+      return basic_table_query<static_table, true, RowTs...>(*this);
+   }
+
+   /// @brief Runs @p fn once per chunk of rows RowTs... on @p executor.
+   /// See table::for_each_parallel for the executor and no-structural-mutation contract.
+   template<typename... RowTs, typename Executor, typename Fn>
+   void for_each_parallel(Executor &&executor, size_t chunk_size, Fn &&fn) {
+      query<RowTs...>().for_each_chunk(std::forward<Executor>(executor), chunk_size,
+                                       std::forward<Fn>(fn));
+   }
+
+   template<typename... RowTs, typename Executor, typename Fn>
+   void for_each_parallel(Executor &&executor, size_t chunk_size, Fn &&fn) const {
+      query<RowTs...>().for_each_chunk(std::forward<Executor>(executor), chunk_size,
+                                       std::forward<Fn>(fn));
+   }
+
+  private:
+   template<typename TT, bool IsConst, typename... RowTs>
+   friend class basic_table_columns_iter;
+   template<typename TT, bool IsConst, typename... RowTs>
+   friend class basic_table_query;
+
+   /// Cells of rows RowTs at dense index @p colIdx, for basic_table_columns_iter.
+   template<typename... RowTs, typename Self>
+   static auto unmarked_cells(Self &self, column_key, size_t colIdx) {
+      return std::tuple<std::conditional_t<std::is_const_v<Self>, const RowTs &, RowTs &>...> {
+          self.template row<RowTs>().template unchecked_at<RowTs>(colIdx)...};
+   }
+
+   static consteval bool has_unique_rows() {
+      constexpr std::array<ty_id, sizeof...(Rows)> ids {getTypeID<Rows>()...};
+      for (size_t i = 0; i < ids.size(); ++i) {
+         for (size_t j = i + 1; j < ids.size(); ++j) {
+            if (ids[i] == ids[j]) { return false; }
+         }
+      }
+      return true;
+   }
+
+   /// Compile-time slot of row T in mRows.
+   template<typename T>
+   static consteval size_t slot_of() {
+      static_assert(contains_row<T>(), "static_table - row type is not part of the schema");
+      constexpr std::array<ty_id, sizeof...(Rows)> ids {getTypeID<Rows>()...};
+      size_t slot = 0;
+      while (ids[slot] != getTypeID<T>()) { ++slot; }
+      return slot;
+   }
+
+   template<typename T>
+   untyped_vector &row() {
+      return std::get<slot_of<T>()>(mRows);
+   }
+
+   template<typename T>
+   const untyped_vector &row() const {
+      return std::get<slot_of<T>()>(mRows);
+   }
+
+   std::array<untyped_vector, sizeof...(Rows)> mRows;
+   column_mapping mColumnMapping;
+};
+
+} // namespace tr
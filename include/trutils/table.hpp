@@ -1,15 +1,36 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iterator>
+#include <memory>
+#include <numeric>
+#include <ostream>
 #include <span>
 #include <stdexcept>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "buffered_row.hpp"
+#include "chunk_hash.hpp"
+#include "dense_bitset.hpp"
 #include "simple_flatmap.hpp"
+#include "prefetch.hpp"
+#include "sparse_row.hpp"
 #include "sparse_set.hpp"
+#include "table_snapshot.hpp"
+#include "trace.hpp"
 #include "type_id.hpp"
 #include "untyped_vector.hpp"
 
@@ -19,8 +40,29 @@ struct column_tag {};
 template<typename ColumnTagT = column_tag>
 class table;
 
+template<typename TableT, bool IsConst, typename... RowTs>
+class basic_table_columns_iter;
+
+template<typename ColumnTagT, bool IsConst, typename... RowTs>
+using table_columns_iter = basic_table_columns_iter<table<ColumnTagT>, IsConst, RowTs...>;
+
+template<typename TableT, bool IsConst, typename... RowTs>
+class basic_table_query;
+
+template<typename ColumnTagT, bool IsConst, typename... RowTs>
+using table_query = basic_table_query<table<ColumnTagT>, IsConst, RowTs...>;
+
+template<typename TableT, bool IsConst>
+class basic_table_join;
+
+template<typename ColumnTagT, bool IsConst>
+using table_join = basic_table_join<table<ColumnTagT>, IsConst>;
+
+template<typename TableT, bool IsConst, typename... RowTs>
+class basic_table_join_query;
+
 template<typename ColumnTagT, bool IsConst, typename... RowTs>
-class table_columns_iter;
+using table_join_query = basic_table_join_query<table<ColumnTagT>, IsConst, RowTs...>;
 
 template<typename ColumnTagT>
 class table {
@@ -30,7 +72,8 @@ class table {
 
    /// Non-owning view of one row in a table.
    /// Invalid if this row type is erased or the table is destroyed; column insert/erase and other
-   /// rows do not invalidate the view.
+   /// rows do not invalidate the view. Mutable at() reports the write to dirty tracking, hash
+   /// tracking and row buffering when the row uses them; values() does not.
    template<typename Cell>
    class row_view {
      public:
@@ -45,7 +88,9 @@ class table {
       row_view &operator=(const row_view &) = default;
       row_view &operator=(row_view &&) noexcept = default;
 
-      row_view(const column_mapping &columns, untyped_vector &row) : mColumns(columns), mRow(row) {}
+      row_view(const column_mapping &columns, untyped_vector &row, dense_bitset *dirty = nullptr,
+               row_chunk_hashes *hashes = nullptr, buffered_row<column_key> *buffered = nullptr) :
+          mColumns(columns), mRow(row), mDirty(dirty), mHashes(hashes), mBuffered(buffered) {}
 
       bool empty() const { return mRow.size() == 0; }
 
@@ -56,6 +101,9 @@ class table {
       /// @throws std::out_of_range if @p key is not a live column or index is out of range.
       T &at(column_key key) {
          const size_t idx = index_of(key);
+         if (mDirty) { mDirty->set(idx); }
+         if (mHashes) { mHashes->invalidate(idx); }
+         if (mBuffered) { mBuffered->invalidate(idx); }
          return mRow.data<T>()[idx];
       }
 
@@ -73,28 +121,123 @@ class table {
 
       const column_mapping &mColumns;
       untyped_vector &mRow;
+      dense_bitset *mDirty;
+      row_chunk_hashes *mHashes;
+      buffered_row<column_key> *mBuffered;
    };
 
+   /// Reader-thread handle on a buffered row; see buffer_row.
    template<typename T>
-   row_view<T> create_row() {
+   using row_reader = published_row_reader<T, column_key>;
+
+   /// @brief Adds a row of type T with one default-initialized cell per column.
+   /// @param resource Memory resource the row's storage is allocated from.
+   /// @throws std::invalid_argument if the table already has a row of type T.
+   template<typename T, std::same_as<dense_storage> Storage = dense_storage>
+   row_view<T> create_row(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+      TR_TRACE_ZONE("table::create_row");
       if (contains_row<T>()) {
          THROW(std::invalid_argument, "table::create_row - duplicate row type");
       }
       auto typeInfo = getTypeInfo<T>();
-      auto vector = untyped_vector(typeInfo);
+      auto vector = untyped_vector(typeInfo, resource);
+      vector.reserve(std::max(mReservedColumns, mColumnMapping.size()));
       vector.resize<T>(mColumnMapping.size());
       mRows.insert(typeInfo.id, std::move(vector));
       return get_row_view<T>();
    }
 
+   /// @brief Adds a sparse row of type T, which holds cells only for columns given one through
+   /// add_cell(). Inserting columns leaves sparse rows untouched.
+   ///
+   /// cell(), unchecked_cell(), query_column(), has_cell() and for_each_with() accept sparse rows;
+   /// get_row(), get_row_view(), query(), sorting, dirty tracking and serialize() do not.
+   /// @param resource Memory resource the row's cells are allocated from.
+   /// @throws std::invalid_argument if the table already has a row of type T.
+   template<typename T, std::same_as<sparse_storage> Storage>
+   void create_row(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+      TR_TRACE_ZONE("table::create_row");
+      if (contains_row<T>()) {
+         THROW(std::invalid_argument, "table::create_row - duplicate row type");
+      }
+      const auto typeInfo = getTypeInfo<T>();
+      mSparseRows.insert(typeInfo.id, sparse_row<column_key>(typeInfo, resource));
+   }
+
+   /// @brief Adds a dense row described by @p type_info, for callers that only know the cell type
+   /// at runtime. Cells take the type's default value representation.
+   /// @throws std::invalid_argument if the table already has a row of that type, or the type has
+   /// no default value representation (see ty_info::default_value_rep).
+   void create_row(const ty_info &type_info,
+                   std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+      TR_TRACE_ZONE("table::create_row");
+      if (mRows.contains(type_info.id) || mSparseRows.contains(type_info.id)) {
+         THROW(std::invalid_argument, "table::create_row - duplicate row type");
+      }
+      if (type_info.default_value_rep == nullptr) {
+         THROW(std::invalid_argument, "table::create_row - '{}' is not trivially copyable",
+               type_info.name);
+      }
+      auto vector = untyped_vector(type_info, resource);
+      vector.reserve(std::max(mReservedColumns, mColumnMapping.size()));
+      vector.push_back_default(mColumnMapping.size());
+      mRows.insert(type_info.id, std::move(vector));
+   }
+
    template<typename T>
    bool contains_row() const {
-      return mRows.contains(getTypeID<T>());
+      return mRows.contains(getTypeID<T>()) || mSparseRows.contains(getTypeID<T>());
+   }
+
+   template<typename T>
+   bool is_sparse_row() const {
+      return mSparseRows.contains(getTypeID<T>());
    }
 
    template<typename T>
    bool erase_row() {
-      return mRows.erase(getTypeID<T>());
+      TR_TRACE_ZONE("table::erase_row");
+      mDirty.erase(getTypeID<T>());
+      mHashes.erase(getTypeID<T>());
+      mBuffers.erase(getTypeID<T>());
+      return mRows.erase(getTypeID<T>()) || mSparseRows.erase(getTypeID<T>());
+   }
+
+   /// @brief Whether row T has a cell for column @p key. Always true for a live column of a dense
+   /// row; false for dead keys and missing rows.
+   template<typename T>
+   bool has_cell(column_key key) const {
+      if (!mColumnMapping.contains(key)) { return false; }
+      if (mRows.contains(getTypeID<T>())) { return true; }
+      const auto *row = mSparseRows.find(getTypeID<T>());
+      return row && row->contains(key);
+   }
+
+   /// @brief Gives column @p key a cell holding @p value in sparse row T.
+   /// @throws std::out_of_range if @p key is not a live column or T is not a sparse row.
+   /// @throws std::invalid_argument if the column already has a cell in row T.
+   template<typename T>
+   T &add_cell(column_key key, const T &value = T {}) {
+      if (!mColumnMapping.contains(key)) {
+         THROW(std::out_of_range, "table::add_cell - column not found");
+      }
+      return sparse_row_at<T>("table::add_cell - not a sparse row").insert(key, value);
+   }
+
+   /// @brief Removes the cell of column @p key from sparse row T.
+   /// @return false if the column had no cell in row T.
+   /// @throws std::out_of_range if T is not a sparse row.
+   template<typename T>
+   bool remove_cell(column_key key) {
+      return sparse_row_at<T>("table::remove_cell - not a sparse row").erase(key);
+   }
+
+   /// @brief Number of cells in row T: column_count() for a dense row.
+   /// @throws std::out_of_range if row T is missing.
+   template<typename T>
+   size_t cell_count() const {
+      if (mRows.contains(getTypeID<T>())) { return column_count(); }
+      return mSparseRows.at(getTypeID<T>()).size();
    }
 
    /// Dense, unordered row storage — use row_view for key lookups.
@@ -110,38 +253,552 @@ class table {
 
    template<typename T>
    row_view<T> get_row_view() {
-      return row_view<T>(mColumnMapping, mRows.at(getTypeID<T>()));
+      const auto *buffered = mBuffers.find(getTypeID<T>());
+      return row_view<T>(mColumnMapping, mRows.at(getTypeID<T>()), mDirty.find(getTypeID<T>()),
+                         mHashes.find(getTypeID<T>()), buffered ? buffered->get() : nullptr);
+   }
+
+   // Runtime access to dense rows by ty_id, for tools that never see T (editors, scripting,
+   // replication). Bulk operations run the row type's ty_kernels; see untyped_vector.
+
+   /// @brief Dense row storage of the type with id @p id, in column dense order.
+   /// @throws std::out_of_range if there is no dense row of that type.
+   const untyped_vector &get_row_untyped(ty_id id) const {
+      const auto *row = mRows.find(id);
+      if (!row) { THROW(std::out_of_range, "table::get_row_untyped - row not found"); }
+      return *row;
+   }
+
+   /// @brief Like get_row_untyped(), but returns nullptr if there is no dense row of that type.
+   const untyped_vector *find_row_untyped(ty_id id) const noexcept { return mRows.find(id); }
+
+   /// @brief Calls @p fn with the storage of every dense row, in no particular order.
+   template<typename Fn>
+   void for_each_row(Fn &&fn) const {
+      for (const auto &entry : mRows) { fn(std::as_const(entry.second)); }
+   }
+
+   /// @brief Sets every cell of row @p id to a copy of the object at @p value.
+   /// @throws std::out_of_range if there is no dense row of that type.
+   /// @throws std::runtime_error if the row type has no kernels.
+   void fill_row(ty_id id, const void *value) {
+      untyped_vector &row = row_untyped(id, "table::fill_row - row not found");
+      row.fill(value);
+      mark_row_dirty(id);
+   }
+
+   /// @brief Overwrites every cell of row @p id with @p values, one cell per column in dense order,
+   /// e.g. a row received from get_row_untyped() of a replica.
+   /// @throws std::out_of_range if there is no dense row of that type.
+   /// @throws std::invalid_argument if @p values does not hold column_count() elements.
+   /// @throws std::runtime_error if @p values stores a different type or it has no kernels.
+   void assign_row(ty_id id, const untyped_vector &values) {
+      untyped_vector &row = row_untyped(id, "table::assign_row - row not found");
+      if (values.size() != row.size()) {
+         THROW(std::invalid_argument, "table::assign_row - expected {} cells, got {}", row.size(),
+               values.size());
+      }
+      row.assign_elements(values);
+      mark_row_dirty(id);
+   }
+
+   /// @brief Hash of every cell of row @p id in dense order; see untyped_vector::hash.
+   /// @throws std::out_of_range if there is no dense row of that type.
+   /// @throws std::runtime_error if the row type has no kernels.
+   uint64_t hash_row(ty_id id, uint64_t seed = 0) const { return get_row_untyped(id).hash(seed); }
+
+   /// @brief Starts tracking which cells of row T change, with one bit per column in dense order.
+   ///
+   /// Tracked cells are marked dirty by mutable cell(), unchecked_cell(), query_column() and
+   /// row_view::at(), and by columns being inserted. Writes through get_row(), query(), join() or
+   /// the column iterators are not seen and must be reported with mark_dirty(). Every cell starts
+   /// clean. Does nothing if row T is already tracked.
+   /// @throws std::out_of_range if row T is missing.
+   template<typename T>
+   void track_dirty() {
+      (void)mRows.at(getTypeID<T>());
+      mDirty.insert(getTypeID<T>(), dense_bitset(mColumnMapping.size()));
+   }
+
+   /// @brief Stops tracking row T and drops its dirty state. Erasing the row does the same.
+   template<typename T>
+   void untrack_dirty() {
+      mDirty.erase(getTypeID<T>());
+   }
+
+   template<typename T>
+   bool is_dirty_tracked() const {
+      return mDirty.contains(getTypeID<T>());
+   }
+
+   /// @brief Reports a write to the cell at @p key in row T to whichever of dirty tracking, hash
+   /// tracking and row buffering the row uses.
+   /// @throws std::out_of_range if @p key is not a live column.
+   template<typename T>
+   void mark_dirty(column_key key) {
+      cells_written(getTypeID<T>(), static_cast<size_t>(mColumnMapping.get(key)), 1);
+   }
+
+   /// @brief Reports writes to the cells at dense indices [first, first + count) in row T, made
+   /// through get_row(), as mark_dirty(column_key) does.
+   /// @throws std::out_of_range if the range extends past column_count().
+   template<typename T>
+   void mark_dirty(size_t first, size_t count) {
+      if (first > column_count() || count > column_count() - first) {
+         THROW(std::out_of_range, "table::mark_dirty - range out of bounds");
+      }
+      cells_written(getTypeID<T>(), first, count);
+   }
+
+   /// @brief Whether the cell at @p key in row T has changed since the last clear_dirty<T>().
+   /// @throws std::out_of_range if @p key is not a live column or row T is not tracked.
+   template<typename T>
+   bool is_dirty(column_key key) const {
+      const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
+      return dirty_bits<T>("table::is_dirty - row is not tracked").test(colIdx);
+   }
+
+   /// @brief Invokes @p fn for every dirty cell of row T, in dense order.
+   ///
+   /// @p fn is called as fn(key, cell) if it accepts a leading column_key, and as fn(cell)
+   /// otherwise. The bitset is scanned a word at a time, so the cost follows the number of dirty
+   /// cells rather than the column count. Dirty bits are left set; see clear_dirty().
+   /// @throws std::out_of_range if row T is not tracked.
+   template<typename T, typename Fn>
+   void for_each_dirty(Fn &&fn) const {
+      const dense_bitset &dirty = dirty_bits<T>("table::for_each_dirty - row is not tracked");
+      const std::span<const T> cells = get_row<T>();
+      dirty.for_each_set([&](size_t idx) {
+         if constexpr (std::is_invocable_v<Fn &, column_key, const T &>) {
+            fn(mColumnMapping.key_at_dense(idx), cells[idx]);
+         } else {
+            fn(cells[idx]);
+         }
+      });
+   }
+
+   /// @brief Marks every cell of row T clean. Does nothing if row T is not tracked.
+   template<typename T>
+   void clear_dirty() {
+      if (dense_bitset *dirty = mDirty.find(getTypeID<T>())) { dirty->reset_all(); }
+   }
+
+   /// @brief Starts keeping hashes of row T's bytes per chunk of row_chunk_hashes::CHUNK_BYTES,
+   /// so row_hash() and diff() only rehash the chunks written since they last ran.
+   ///
+   /// Writes are seen through the same calls as track_dirty(); anything else must be reported
+   /// with mark_dirty(). Every chunk starts stale. Does nothing if row T is already tracked.
+   /// @throws std::out_of_range if row T is missing.
+   template<typename T>
+   void track_hashes() {
+      const untyped_vector &row = mRows.at(getTypeID<T>());
+      mHashes.insert(getTypeID<T>(), row_chunk_hashes(row.stride(), row.size()));
+   }
+
+   /// @brief Stops hash tracking row T. Erasing the row does the same.
+   template<typename T>
+   void untrack_hashes() {
+      mHashes.erase(getTypeID<T>());
+   }
+
+   template<typename T>
+   bool is_hash_tracked() const {
+      return mHashes.contains(getTypeID<T>());
+   }
+
+   /// @brief Hash of every chunk of row T in dense order, rehashing the stale ones first.
+   ///
+   /// The span stays valid until the columns change or the row stops being tracked. Refreshing
+   /// writes to the cache, so this and the other hash readers must not race, even though they are
+   /// const.
+   /// @throws std::out_of_range if row T is not hash-tracked.
+   template<typename T>
+   std::span<const uint64_t> chunk_hashes() const {
+      return refreshed_hashes(getTypeID<T>(), "table::chunk_hashes - row is not hash-tracked");
+   }
+
+   /// @brief Hash of row T's bytes, combined from its chunk hashes. Equal rows give equal hashes,
+   /// but the value differs from hash_row(), which hashes the cells in one pass.
+   /// @throws std::out_of_range if row T is not hash-tracked.
+   template<typename T>
+   uint64_t row_hash() const {
+      const auto hashes =
+          refreshed_hashes(getTypeID<T>(), "table::row_hash - row is not hash-tracked");
+      return hash_bytes(hashes.data(), hashes.size_bytes(), 0);
+   }
+
+   /// @brief Compares every hash-tracked row of this table against the same row of @p other,
+   /// by chunk hash, e.g. to send only the changed chunks of a snapshot.
+   ///
+   /// Rows of @p other are hashed through their own cache when they are hash-tracked, and in full
+   /// otherwise. Chunks past the end of the shorter row and rows @p other lacks count as
+   /// differing; rows only @p other has are ignored. Apply the result with chunk_bytes() and
+   /// write_chunk().
+   /// @return One entry per row with at least one differing chunk.
+   std::vector<row_diff> diff(const table &other) const {
+      std::vector<row_diff> result;
+      for (auto &[id, hashes] : mHashes) {
+         const auto ours = hashes.refresh(mRows.at(id).bytes());
+         row_diff rowDiff {id, hashes.cells_per_chunk(), {}};
+         const untyped_vector *theirRow = other.mRows.find(id);
+         if (!theirRow) {
+            rowDiff.chunks.resize(ours.size());
+            std::iota(rowDiff.chunks.begin(), rowDiff.chunks.end(), size_t {0});
+         } else {
+            row_chunk_hashes *theirCache = other.mHashes.find(id);
+            std::span<const uint64_t> theirs;
+            std::vector<uint64_t> computed;
+            if (theirCache) {
+               theirs = theirCache->refresh(theirRow->bytes());
+            } else {
+               const row_chunk_hashes layout(theirRow->stride(), theirRow->size());
+               computed.resize(layout.chunk_count());
+               for (size_t c = 0; c < computed.size(); ++c) {
+                  computed[c] = layout.hash_chunk(theirRow->bytes(), c);
+               }
+               theirs = computed;
+            }
+            const size_t common = std::min(ours.size(), theirs.size());
+            for (size_t c = 0; c < common; ++c) {
+               if (ours[c] != theirs[c]) { rowDiff.chunks.push_back(c); }
+            }
+            for (size_t c = common; c < std::max(ours.size(), theirs.size()); ++c) {
+               rowDiff.chunks.push_back(c);
+            }
+         }
+         if (!rowDiff.chunks.empty()) { result.push_back(std::move(rowDiff)); }
+      }
+      return result;
+   }
+
+   /// @brief Bytes of chunk @p chunk of hash-tracked row @p id, as reported by diff().
+   /// @throws std::out_of_range if the row is not hash-tracked or @p chunk is past its end.
+   std::span<const std::byte> chunk_bytes(ty_id id, size_t chunk) const {
+      const row_chunk_hashes &hashes = hash_cache(id, "table::chunk_bytes - row is not tracked");
+      if (chunk >= hashes.chunk_count()) {
+         THROW(std::out_of_range, "table::chunk_bytes - chunk {} out of range", chunk);
+      }
+      return hashes.chunk_of(mRows.at(id).bytes(), chunk);
+   }
+
+   /// @brief Overwrites chunk @p chunk of hash-tracked row @p id with @p bytes, typically taken
+   /// from chunk_bytes() of another table with the same columns. The chunk's cells are reported
+   /// as written, as by mark_dirty().
+   /// @throws std::out_of_range if the row is not hash-tracked or @p chunk is past its end.
+   /// @throws std::invalid_argument if @p bytes is not the size of the chunk.
+   void write_chunk(ty_id id, size_t chunk, std::span<const std::byte> bytes) {
+      row_chunk_hashes &hashes = hash_cache(id, "table::write_chunk - row is not tracked");
+      if (chunk >= hashes.chunk_count()) {
+         THROW(std::out_of_range, "table::write_chunk - chunk {} out of range", chunk);
+      }
+      untyped_vector &row = mRows.at(id);
+      const auto target = hashes.chunk_of(row.bytes(), chunk);
+      if (bytes.size() != target.size()) {
+         THROW(std::invalid_argument, "table::write_chunk - expected {} bytes, got {}",
+               target.size(), bytes.size());
+      }
+      std::memcpy(row.bytes().data() + chunk * hashes.chunk_bytes(), bytes.data(), bytes.size());
+      const size_t first = chunk * hashes.cells_per_chunk();
+      cells_written(id, first, std::min(hashes.cells_per_chunk(), row.size() - first));
+   }
+
+   /// @brief Keeps three copies of row T so one reader thread can read published frames while
+   /// the writer keeps modifying the row, without locks; see buffered_row.
+   ///
+   /// The writer thread calls publish<T>() when a frame is complete; the reader thread takes the
+   /// newest frame from reader<T>() with row_reader::acquire(). Every other call on the table
+   /// stays on the writer thread. Writes are seen through the same calls as track_dirty(), and
+   /// only the chunks they touch are copied on publish; inserting, erasing or reordering columns
+   /// makes the next few publishes full copies. Frames carry the column mapping they were
+   /// published with, so keys can still be looked up on the reader side. Does nothing if row T is
+   /// already buffered.
+   /// @throws std::out_of_range if row T is missing.
+   template<typename T>
+   void buffer_row() {
+      static_assert(std::is_trivially_copyable_v<T>, "buffered rows are copied bytewise");
+      const untyped_vector &row = mRows.at(getTypeID<T>());
+      if (mBuffers.contains(getTypeID<T>())) { return; }
+      mBuffers.insert(getTypeID<T>(),
+                      std::make_unique<buffered_row<column_key>>(row, mColumnMapping));
+   }
+
+   /// @brief Stops buffering row T, invalidating its readers. Erasing the row does the same.
+   template<typename T>
+   void unbuffer_row() {
+      mBuffers.erase(getTypeID<T>());
+   }
+
+   template<typename T>
+   bool is_row_buffered() const {
+      return mBuffers.contains(getTypeID<T>());
+   }
+
+   /// @brief Publishes the current contents of row T as the newest frame for its reader.
+   /// @throws std::out_of_range if row T is not buffered.
+   template<typename T>
+   void publish() {
+      buffer_of(getTypeID<T>(), "table::publish - row is not buffered")
+          .publish(mRows.at(getTypeID<T>()), mColumnMapping);
+   }
+
+   /// @brief Handle the reader thread takes frames of row T through. Call it on the writer
+   /// thread and hand it over.
+   /// @throws std::out_of_range if row T is not buffered.
+   template<typename T>
+   row_reader<T> reader() {
+      return row_reader<T>(buffer_of(getTypeID<T>(), "table::reader - row is not buffered"));
    }
 
    /// @brief Adds a column; extends every existing row by one default-initialized cell.
    /// @warning Newly installed column entries for this new column are zero-initialized.
    [[nodiscard]] column_key insert_column() {
+      TR_TRACE_ZONE("table::insert_column");
       column_key key = mColumnMapping.insert();
       for (auto &entry : mRows) { entry.second.push_back_default(); }
+      for (auto &entry : mDirty) { entry.second.push_back(true); }
+      for (auto &entry : mHashes) { entry.second.resize(mColumnMapping.size()); }
+      columns_changed();
+      TR_TRACE_COUNTER("table::columns", mColumnMapping.size());
       return key;
    }
 
    bool erase_column(column_key key) {
+      TR_TRACE_ZONE("table::erase_column");
       if (!mColumnMapping.contains(key)) { return false; }
 
       const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
       for (auto &entry : mRows) { entry.second.swap_and_pop(colIdx); }
+      for (auto &entry : mDirty) { entry.second.swap_and_pop(colIdx); }
+      for (auto &entry : mHashes) { entry.second.swap_and_pop(colIdx); }
+      columns_changed();
+      for (auto &entry : mSparseRows) { entry.second.erase(key); }
       mColumnMapping.erase(key);
+      TR_TRACE_COUNTER("table::columns", mColumnMapping.size());
       return true;
    }
 
+   /// @brief Moves column @p key into @p dst, which gets a new column for it.
+   ///
+   /// Every dense row the two tables share is carried over with one untyped cell copy; rows only
+   /// @p dst has start at their default value, and rows only this table has are dropped, as are
+   /// the column's sparse cells. The column is then erased here as by erase_column.
+   /// @return The key of the column in @p dst.
+   /// @throws std::out_of_range if @p key is not a live column.
+   /// @throws std::invalid_argument if @p dst is this table.
+   [[nodiscard]] column_key move_column(column_key key, table &dst) {
+      TR_TRACE_ZONE("table::move_column");
+      if (&dst == this) { THROW(std::invalid_argument, "table::move_column - same table"); }
+      const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
+
+      const column_key moved = dst.insert_column();
+      const size_t dstIdx = dst.column_count() - 1;
+      for (auto &entry : dst.mRows) {
+         if (const auto *row = mRows.find(entry.first)) {
+            entry.second.copy_from(dstIdx, *row, colIdx);
+         }
+      }
+      erase_column(key);
+      return moved;
+   }
+
+   /// @brief Adds @p count columns, writing their keys to @p keys in dense order.
+   ///
+   /// Every existing row grows once by @p count default-initialized cells, rather than once per
+   /// column as with repeated insert_column calls.
+   /// @return The output iterator one past the last written key.
+   template<std::output_iterator<column_key> OutputIt>
+   OutputIt insert_columns(size_t count, OutputIt keys) {
+      TR_TRACE_ZONE("table::insert_columns");
+      keys = mColumnMapping.insert_n(count, keys);
+      for (auto &entry : mRows) { entry.second.push_back_default(count); }
+      for (auto &entry : mDirty) { entry.second.resize(mColumnMapping.size(), true); }
+      for (auto &entry : mHashes) { entry.second.resize(mColumnMapping.size()); }
+      columns_changed();
+      TR_TRACE_COUNTER("table::columns", mColumnMapping.size());
+      return keys;
+   }
+
+   /// @brief Erases every live column in @p keys. Unknown or repeated keys are ignored.
+   ///
+   /// The resulting layout matches calling erase_column for each key in order, but each row is
+   /// compacted in a single sweep.
+   /// @return The number of columns erased.
+   size_t erase_columns(std::span<const column_key> keys) {
+      TR_TRACE_ZONE("table::erase_columns");
+      std::vector<size_t> denseIndices;
+      denseIndices.reserve(keys.size());
+      for (const column_key key : keys) {
+         if (!mColumnMapping.contains(key)) { continue; }
+         denseIndices.push_back(static_cast<size_t>(mColumnMapping.get(key)));
+         for (auto &entry : mSparseRows) { entry.second.erase(key); }
+         mColumnMapping.erase(key);
+      }
+
+      for (auto &entry : mRows) { entry.second.swap_and_pop(denseIndices); }
+      for (auto &entry : mDirty) {
+         for (const size_t idx : denseIndices) { entry.second.swap_and_pop(idx); }
+      }
+      for (auto &entry : mHashes) {
+         for (const size_t idx : denseIndices) { entry.second.swap_and_pop(idx); }
+      }
+      if (!denseIndices.empty()) { columns_changed(); }
+      TR_TRACE_COUNTER("table::columns", mColumnMapping.size());
+      return denseIndices.size();
+   }
+
+   /// @brief Moves the column at dense index @p order[k] to dense index k, for every k.
+   ///
+   /// Each row and the column mapping are permuted in one pass apiece. Column keys stay valid,
+   /// but row storage is reallocated, so spans from get_row() and queries are invalidated.
+   /// @throws std::invalid_argument if @p order is not a permutation of [0, column_count()); the
+   /// table is left unchanged.
+   void reorder_columns(std::span<const size_t> order) {
+      TR_TRACE_ZONE("table::reorder_columns");
+      mColumnMapping.permute_dense(order);
+      for (auto &entry : mRows) { entry.second.gather(order); }
+      for (auto &entry : mDirty) { entry.second.gather(order); }
+      for (auto &entry : mHashes) { entry.second.invalidate_all(); }
+      columns_changed();
+   }
+
+   /// @brief Sorts the columns by their cell in row T, keeping the order of equal columns.
+   ///
+   /// Only row T is read to compute the order, which is then applied with reorder_columns().
+   /// Walking the columns in dense order afterwards visits them in @p comp order, which restores
+   /// locality after erase_column has shuffled them.
+   /// @throws std::out_of_range if row T is missing.
+   template<typename T, typename Compare = std::less<>>
+   void sort_columns(Compare comp = {}) {
+      const std::span<const T> cells = std::as_const(*this).template get_row<T>();
+      std::vector<size_t> order(cells.size());
+      std::iota(order.begin(), order.end(), size_t {0});
+      std::stable_sort(order.begin(), order.end(),
+                       [&](size_t a, size_t b) { return comp(cells[a], cells[b]); });
+      reorder_columns(order);
+   }
+
+   /// @brief Moves the columns towards the order of sort_columns<T>() with at most @p max_swaps
+   /// column swaps, so the work can be spread over several calls, e.g. one per frame.
+   ///
+   /// Every swap puts at least one column in its final place, so repeated calls finish after at
+   /// most column_count() swaps in total as long as the table is not modified in between. Equal
+   /// columns are ordered by key id here, which keeps the target order the same from call to call.
+   /// The target order is computed once per pass and kept, with the position reached, until the
+   /// pass completes or a column is inserted, erased or reordered; calling with another row or
+   /// comparator type also starts over. A pass only starts if row T is out of order, and the call
+   /// that completes it checks the row again, so cells written meanwhile are picked up by the next
+   /// pass. Only swapped cells are moved; spans from get_row() stay valid.
+   /// @return true if the columns are fully sorted.
+   /// @throws std::out_of_range if row T is missing.
+   template<typename T, typename Compare = std::less<>>
+   bool sort_columns_incremental(size_t max_swaps, Compare comp = {}) {
+      TR_TRACE_ZONE("table::sort_columns_incremental");
+      const std::span<const T> cells = std::as_const(*this).template get_row<T>();
+      auto before = [&](size_t a, size_t b) {
+         if (comp(cells[a], cells[b])) { return true; }
+         if (comp(cells[b], cells[a])) { return false; }
+         return mColumnMapping.key_at_dense(a).getID() < mColumnMapping.key_at_dense(b).getID();
+      };
+      auto sorted = [&] {
+         for (size_t i = 1; i < cells.size(); ++i) {
+            if (before(i, i - 1)) { return false; }
+         }
+         return true;
+      };
+
+      incremental_sort &pass = mIncrementalSort;
+      if (pass.target.empty() || pass.row != getTypeID<T>() ||
+          pass.compare != getTypeID<Compare>()) {
+         if (sorted()) { return true; }
+         std::vector<size_t> order(cells.size());
+         std::iota(order.begin(), order.end(), size_t {0});
+         std::sort(order.begin(), order.end(), before);
+         pass.target.resize(order.size());
+         for (size_t k = 0; k < order.size(); ++k) { pass.target[order[k]] = k; }
+         pass.cursor = 0;
+         pass.row = getTypeID<T>();
+         pass.compare = getTypeID<Compare>();
+      }
+
+      // target[i] is where the column now at i belongs; columns before the cursor are in place.
+      std::vector<size_t> &target = pass.target;
+      bool swapped = false;
+      for (; pass.cursor < target.size(); ++pass.cursor) {
+         const size_t i = pass.cursor;
+         while (target[i] != i) {
+            if (max_swaps == 0) {
+               if (swapped) { relayout_buffers(); }
+               return false;
+            }
+            --max_swaps;
+            swapped = true;
+            const size_t dst = target[i];
+            mColumnMapping.swap_dense(i, dst);
+            for (auto &entry : mRows) { entry.second.swap(i, dst); }
+            for (auto &entry : mDirty) { entry.second.swap(i, dst); }
+            for (auto &entry : mHashes) {
+               entry.second.invalidate(i);
+               entry.second.invalidate(dst);
+            }
+            std::swap(target[i], target[dst]);
+         }
+      }
+      if (swapped) { relayout_buffers(); }
+      target.clear();
+      return sorted();
+   }
+
    /// @brief Mutable access to the cell at key in row T.
-   /// @throws std::out_of_range if key is not a live column or row T is missing.
+   /// @throws std::out_of_range if key is not a live column, row T is missing, or row T is sparse
+   /// and has no cell for key.
    template<typename T>
    T &cell(column_key key) {
       const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
-      return mRows.at(getTypeID<T>()).template at<T>(colIdx);
+      T &result = cell_at<T>(*this, key, colIdx);
+      mark_dirty_at<T>(colIdx);
+      return result;
    }
 
    template<typename T>
    const T &cell(column_key key) const {
       const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
-      return mRows.at(getTypeID<T>()).template at<T>(colIdx);
+      return cell_at<T>(*this, key, colIdx);
+   }
+
+   /// @brief Like cell(), but returns nullptr where cell() would throw: for a dead key, a missing
+   /// row, or a sparse row without a cell for @p key.
+   template<typename T>
+   T *try_cell(column_key key) noexcept {
+      const auto colIdx = mColumnMapping.try_get(key);
+      if (!colIdx) { return nullptr; }
+      T *result = try_cell_at<T>(*this, key, *colIdx);
+      if (result) { mark_dirty_at<T>(*colIdx); }
+      return result;
+   }
+
+   template<typename T>
+   const T *try_cell(column_key key) const noexcept {
+      const auto colIdx = mColumnMapping.try_get(key);
+      return colIdx ? try_cell_at<T>(*this, key, *colIdx) : nullptr;
+   }
+
+   /// @brief cell() that skips validating @p key and the stored type unless TR_DEBUG_CHECKS is on.
+   /// Cells of sparse rows are always looked up with checks.
+   /// @throws std::out_of_range if row T is missing or has no cell for a sparse row.
+   template<typename T>
+   T &unchecked_cell(column_key key) {
+      const auto colIdx = static_cast<size_t>(mColumnMapping.unchecked_get(key));
+      untyped_vector *row = mRows.find(getTypeID<T>());
+      T &result = row ? row->template unchecked_at<T>(colIdx) : cell_at<T>(*this, key, colIdx);
+      mark_dirty_at<T>(colIdx);
+      return result;
+   }
+
+   template<typename T>
+   const T &unchecked_cell(column_key key) const {
+      const auto colIdx = static_cast<size_t>(mColumnMapping.unchecked_get(key));
+      const untyped_vector *row = mRows.find(getTypeID<T>());
+      return row ? row->template unchecked_at<T>(colIdx) : cell_at<T>(*this, key, colIdx);
    }
 
    /// @brief For column key, returns a tuple of references to the requested row cells, in order.
@@ -149,18 +806,87 @@ class table {
    template<typename... RowTs>
    std::tuple<RowTs &...> query_column(column_key key) {
       const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
-      return std::tuple<RowTs &...> {mRows.at(getTypeID<RowTs>()).template at<RowTs>(colIdx)...};
+      std::tuple<RowTs &...> result {cell_at<RowTs>(*this, key, colIdx)...};
+      (mark_dirty_at<RowTs>(colIdx), ...);
+      return result;
    }
 
    template<typename... RowTs>
    std::tuple<const RowTs &...> query_column(column_key key) const {
       const auto colIdx = static_cast<size_t>(mColumnMapping.get(key));
-      return std::tuple<const RowTs &...> {
-          mRows.at(getTypeID<RowTs>()).template at<RowTs>(colIdx)...};
+      return std::tuple<const RowTs &...> {cell_at<RowTs>(*this, key, colIdx)...};
+   }
+
+   bool contains_column(column_key key) const { return mColumnMapping.contains(key); }
+
+   /// @brief Dense index of the column @p key, i.e. its position in every row's storage.
+   /// @throws std::out_of_range if @p key is not a live column.
+   size_t column_index(column_key key) const {
+      return static_cast<size_t>(mColumnMapping.get(key));
    }
 
    size_t column_count() const { return mColumnMapping.size(); }
-   size_t row_count() const { return mRows.size(); }
+   size_t row_count() const { return mRows.size() + mSparseRows.size(); }
+
+   /// @brief Pre-sizes the table for @p count columns, so inserting columns up to that count
+   /// reallocates neither the column mapping, any dense row, nor the dirty bits of tracked rows.
+   ///
+   /// Dense rows created later are reserved for @p count columns too, until shrink_to_fit().
+   /// Never shrinks anything.
+   void reserve_columns(size_t count) {
+      mReservedColumns = std::max(mReservedColumns, count);
+      mColumnMapping.reserve(count);
+      for (auto &entry : mRows) { entry.second.reserve(count); }
+      for (auto &entry : mDirty) { entry.second.reserve(count); }
+   }
+
+   /// @brief Number of columns the table can hold before the column mapping or a dense row has to
+   /// reallocate. Rows loaded by map_readonly have no spare capacity.
+   size_t column_capacity() const {
+      size_t capacity = mColumnMapping.capacity();
+      for (const auto &entry : mRows) { capacity = std::min(capacity, entry.second.capacity()); }
+      return capacity;
+   }
+
+   /// @brief Releases the spare capacity of every row, the column mapping and the dirty bits, and
+   /// drops the reservation reserve_columns() made for future rows.
+   ///
+   /// The column mapping is compacted as by SparseSet::shrink_to_fit(), so freed column keys are
+   /// reused lowest first afterwards. Live keys stay valid; spans from get_row() do not.
+   void shrink_to_fit() {
+      mReservedColumns = 0;
+      mColumnMapping.shrink_to_fit();
+      for (auto &entry : mRows) { entry.second.shrink_to_fit(); }
+      for (auto &entry : mSparseRows) { entry.second.shrink_to_fit(); }
+      for (auto &entry : mDirty) { entry.second.shrink_to_fit(); }
+   }
+
+   /// @brief Bytes of heap storage held by row T, spare capacity included, along with its dirty
+   /// bits, chunk hashes and buffered copies; 0 if the row is missing. Storage borrowed from a
+   /// map_readonly snapshot is not counted.
+   template<typename T>
+   size_t memory_usage() const {
+      const ty_id id = getTypeID<T>();
+      if (const auto *sparse = mSparseRows.find(id)) { return sparse->memory_usage(); }
+      const auto *row = mRows.find(id);
+      if (!row) { return 0; }
+      size_t bytes = row->memory_usage();
+      if (const auto *dirty = mDirty.find(id)) { bytes += dirty->memory_usage(); }
+      if (const auto *hashes = mHashes.find(id)) { bytes += hashes->memory_usage(); }
+      if (const auto *buffered = mBuffers.find(id)) { bytes += (*buffered)->memory_usage(); }
+      return bytes;
+   }
+
+   /// @brief memory_usage<T>() summed over every row, plus the column mapping.
+   size_t memory_usage() const {
+      size_t bytes = mColumnMapping.memory_usage();
+      for (const auto &entry : mRows) { bytes += entry.second.memory_usage(); }
+      for (const auto &entry : mSparseRows) { bytes += entry.second.memory_usage(); }
+      for (const auto &entry : mDirty) { bytes += entry.second.memory_usage(); }
+      for (const auto &entry : mHashes) { bytes += entry.second.memory_usage(); }
+      for (const auto &entry : mBuffers) { bytes += entry.second->memory_usage(); }
+      return bytes;
+   }
 
    template<typename... RowTs>
    [[nodiscard]] table_columns_iter<ColumnTagT, false, RowTs...> columns_begin();
@@ -171,55 +897,492 @@ class table {
    template<typename... RowTs>
    [[nodiscard]] table_columns_iter<ColumnTagT, true, RowTs...> columns_end() const;
 
+   /// @brief Resolves the storage of rows RowTs... once, for iteration by dense index.
+   /// @throws std::out_of_range if a requested row type is not in the table.
+   template<typename... RowTs>
+   [[nodiscard]] table_query<ColumnTagT, false, RowTs...> query();
+   template<typename... RowTs>
+   [[nodiscard]] table_query<ColumnTagT, true, RowTs...> query() const;
+
+   /// @brief Runs @p fn once per chunk of rows RowTs... on @p executor.
+   ///
+   /// The dense column range [0, column_count()) is split into non-overlapping chunks of
+   /// table_query::aligned_chunk_size(chunk_size) columns, and @p fn receives a
+   /// table_query::chunk for each. @p executor is a callable invoked as executor(chunk_count, task)
+   /// that must call task(i) exactly once for every i in [0, chunk_count) and return only once all
+   /// of those calls have completed. Standard execution policies are adapted with
+   /// tr::policy_executor from execution.hpp.
+   ///
+   /// @warning No structural mutation may happen while this call is in flight: insert_column,
+   /// erase_column, create_row and erase_row must not be called from any thread. Chunks never
+   /// share cells, so each invocation of @p fn may write to its own chunk without locking.
+   /// @throws std::out_of_range if a requested row type is not in the table.
+   template<typename... RowTs, typename Executor, typename Fn>
+   void for_each_parallel(Executor &&executor, size_t chunk_size, Fn &&fn) {
+      query<RowTs...>().for_each_chunk(std::forward<Executor>(executor), chunk_size,
+                                       std::forward<Fn>(fn));
+   }
+
+   template<typename... RowTs, typename Executor, typename Fn>
+   void for_each_parallel(Executor &&executor, size_t chunk_size, Fn &&fn) const {
+      query<RowTs...>().for_each_chunk(std::forward<Executor>(executor), chunk_size,
+                                       std::forward<Fn>(fn));
+   }
+
+   /// @brief Invokes @p fn for every column that has a cell in each of rows RowTs..., which may be
+   /// dense or sparse.
+   ///
+   /// Iteration is driven by the sparse row with the fewest cells, so the cost follows how often
+   /// the rarest row is present; every other row is looked up per visited column. With only dense
+   /// rows this is a plain loop in dense order. @p fn is called as fn(key, cells...) if it accepts
+   /// a leading column_key, and as fn(cells...) otherwise. Columns and cells must not be added or
+   /// removed during the call.
+   /// @throws std::out_of_range if a requested row type is not in the table.
+   template<typename... RowTs, typename Fn>
+   void for_each_with(Fn &&fn) {
+      for_each_with_impl<RowTs...>(*this, fn);
+   }
+
+   template<typename... RowTs, typename Fn>
+   void for_each_with(Fn &&fn) const {
+      for_each_with_impl<RowTs...>(*this, fn);
+   }
+
+   /// @brief Writes a binary snapshot of the table to @p out with sequential writes.
+   ///
+   /// The snapshot holds the column mapping, each row's type information and its raw cell bytes;
+   /// see table_snapshot.hpp for the layout. Column keys stay valid across a round trip.
+   /// @throws std::runtime_error if writing fails or the table has sparse rows.
+   void serialize(std::ostream &out) const {
+      if (!mSparseRows.empty()) {
+         THROW(std::runtime_error, "table::serialize - sparse rows cannot be serialized");
+      }
+      table_snapshot_header header;
+      header.freelistHead = mColumnMapping.freelist_head();
+      header.versionFloor = mColumnMapping.version_floor();
+      header.columnTag = getTypeID<ColumnTagT>();
+      header.columnCount = mColumnMapping.size();
+      header.rowCount = mRows.size();
+
+      std::vector<table_snapshot_row> records;
+      records.reserve(mRows.size());
+      uint64_t offset = sizeof(header) + (mRows.size() * sizeof(table_snapshot_row));
+      header.denseOffset = offset;
+      header.denseBytes = mColumnMapping.dense_bytes().size();
+      offset += header.denseBytes;
+      header.sparseOffset = offset;
+      header.sparseBytes = mColumnMapping.sparse_bytes().size();
+      offset += header.sparseBytes;
+      for (const auto &[id, row] : mRows) {
+         const ty_info &info = row.type_info();
+         table_snapshot_row record;
+         record.id = id;
+         record.size = info.size;
+         record.alignment = info.alignment;
+         record.nameOffset = offset;
+         record.nameBytes = info.name.size();
+         offset += record.nameBytes;
+         record.defaultOffset = offset;
+         offset += info.size;
+         records.push_back(record);
+      }
+      for (auto &record : records) {
+         const auto &row = mRows.at(record.id);
+         offset = snapshot_align(offset, TABLE_SNAPSHOT_PAGE_SIZE);
+         record.dataOffset = offset;
+         record.dataBytes = row.bytes().size();
+         offset += record.dataBytes;
+      }
+
+      uint64_t written = 0;
+      const auto write = [&](const void *data, size_t size) {
+         out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+         written += size;
+      };
+      const auto pad_to = [&](uint64_t target) {
+         static constexpr std::array<char, 256> zeros {};
+         while (written < target) { write(zeros.data(), std::min(zeros.size(), target - written)); }
+      };
+
+      write(&header, sizeof(header));
+      write(records.data(), records.size() * sizeof(table_snapshot_row));
+      write(mColumnMapping.dense_bytes().data(), header.denseBytes);
+      write(mColumnMapping.sparse_bytes().data(), header.sparseBytes);
+      for (const auto &record : records) {
+         const ty_info &info = mRows.at(record.id).type_info();
+         write(info.name.data(), info.name.size());
+         if (info.default_value_rep) {
+            write(info.default_value_rep, info.size);
+         } else {
+            pad_to(written + info.size);
+         }
+      }
+      for (const auto &record : records) {
+         pad_to(record.dataOffset);
+         write(mRows.at(record.id).bytes().data(), record.dataBytes);
+      }
+
+      if (!out) { THROW(std::runtime_error, "table::serialize - write failed"); }
+   }
+
+   /// @brief Writes a binary snapshot of the table to the file at @p path, replacing it.
+   /// @throws std::runtime_error if the file cannot be written.
+   void serialize(const std::filesystem::path &path) const {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      if (!out) { THROW(std::runtime_error, "table::serialize - cannot open '{}'", path.string()); }
+      serialize(out);
+      out.close();
+      if (!out) { THROW(std::runtime_error, "table::serialize - write failed"); }
+   }
+
+   /// @brief Opens a snapshot written by serialize() without copying any cells.
+   ///
+   /// The file is mapped privately and every row borrows its cell bytes straight from the mapping,
+   /// so row_views and get_row() point into it. The file itself is never modified: cell writes
+   /// only touch the process' copy-on-write pages, and a row moves into its own allocation the
+   /// first time it grows. The mapping lives as long as the table or any copy of it.
+   /// @throws std::runtime_error if the file cannot be mapped or is not a valid snapshot for this
+   /// column tag.
+   static table map_readonly(const std::filesystem::path &path) {
+      auto file = std::make_shared<const mapped_file>(path);
+      const std::span<std::byte> bytes = file->bytes();
+      const auto section = [&](uint64_t offset, uint64_t size) {
+         if (offset > bytes.size() || size > bytes.size() - offset) {
+            THROW(std::runtime_error, "table::map_readonly - truncated snapshot");
+         }
+         return bytes.subspan(static_cast<size_t>(offset), static_cast<size_t>(size));
+      };
+
+      table_snapshot_header header;
+      std::memcpy(&header, section(0, sizeof(header)).data(), sizeof(header));
+      if (header.magic != TABLE_SNAPSHOT_MAGIC || header.version != TABLE_SNAPSHOT_VERSION ||
+          header.pageSize != TABLE_SNAPSHOT_PAGE_SIZE) {
+         THROW(std::runtime_error, "table::map_readonly - not a supported table snapshot");
+      }
+      if (header.columnTag != getTypeID<ColumnTagT>()) {
+         THROW(std::runtime_error, "table::map_readonly - snapshot has a different column tag");
+      }
+
+      table result;
+      result.mColumnMapping =
+          column_mapping::from_bytes(section(header.denseOffset, header.denseBytes),
+                                     section(header.sparseOffset, header.sparseBytes),
+                                     static_cast<typename column_key::ID>(header.freelistHead),
+                                     header.versionFloor);
+      if (result.mColumnMapping.size() != header.columnCount) {
+         THROW(std::runtime_error, "table::map_readonly - inconsistent column count");
+      }
+
+      const auto records = section(sizeof(header), header.rowCount * sizeof(table_snapshot_row));
+      result.mRows.reserve(static_cast<size_t>(header.rowCount));
+      for (uint64_t i = 0; i < header.rowCount; ++i) {
+         table_snapshot_row record;
+         std::memcpy(&record, records.data() + (i * sizeof(record)), sizeof(record));
+         const bool validLayout = record.size != 0 && std::has_single_bit(record.alignment) &&
+                                  record.alignment <= TABLE_SNAPSHOT_PAGE_SIZE &&
+                                  record.dataOffset % TABLE_SNAPSHOT_PAGE_SIZE == 0;
+         const uint64_t stride = snapshot_align(record.size, record.alignment);
+         if (!validLayout || record.dataBytes != header.columnCount * stride) {
+            THROW(std::runtime_error, "table::map_readonly - corrupt row record");
+         }
+
+         ty_info info;
+         const auto name = section(record.nameOffset, record.nameBytes);
+         info.name = std::string_view(reinterpret_cast<const char *>(name.data()), name.size());
+         info.size = static_cast<size_t>(record.size);
+         info.alignment = static_cast<size_t>(record.alignment);
+         info.id = record.id;
+         info.default_value_rep = section(record.defaultOffset, record.size).data();
+         auto row = untyped_vector::borrow(info, section(record.dataOffset, record.dataBytes));
+         if (!result.mRows.insert(info.id, std::move(row)).first) {
+            THROW(std::runtime_error, "table::map_readonly - duplicate row type");
+         }
+      }
+
+      result.mSnapshot = std::move(file);
+      return result;
+   }
+
   private:
-   template<typename CT, bool IsConst, typename... RowTs>
-   friend class table_columns_iter;
+   /// Buffered rows by row type. Readers point into the buffers, so each lives on the heap; a copy
+   /// of the table starts with no buffered rows, as the buffers belong to one writer.
+   struct buffer_map
+       : simple_flatmap<ty_id, std::unique_ptr<buffered_row<column_key>>, identity_hash,
+                        std::equal_to<ty_id>, open_addressing_index> {
+      buffer_map() = default;
+      ~buffer_map() = default;
+      buffer_map(const buffer_map & /*other*/) {}
+      buffer_map(buffer_map &&) noexcept = default;
+      buffer_map &operator=(const buffer_map &other) {
+         if (this != &other) { this->clear(); }
+         return *this;
+      }
+      buffer_map &operator=(buffer_map &&) noexcept = default;
+   };
+
+   template<typename TT, bool IsConst, typename... RowTs>
+   friend class basic_table_columns_iter;
 
-   simple_flatmap<ty_id, untyped_vector> mRows;
+   /// Dense storage or sparse row that for_each_with reads row T from.
+   template<typename T, typename SparseRow>
+   struct row_source {
+      T *dense {nullptr};
+      SparseRow *sparse {nullptr};
+   };
+
+   /// Cell of row T at @p key, which lives at dense index @p colIdx in a dense row.
+   template<typename T, typename Self>
+   static auto &cell_at(Self &self, column_key key, size_t colIdx) {
+      if (auto *row = self.mRows.find(getTypeID<T>())) { return row->template at<T>(colIdx); }
+      auto &sparse = self.template sparse_row_at<T>("table::cell - row not found");
+      auto *cell = sparse.template find<T>(key);
+      if (!cell) { THROW(std::out_of_range, "table::cell - no cell for this column"); }
+      return *cell;
+   }
+
+   /// The cells query_column() returns, without marking them dirty; the column iterators read
+   /// through this so iterating stays invisible to dirty tracking, as with query().
+   template<typename... RowTs, typename Self>
+   static auto unmarked_cells(Self &self, column_key key, size_t colIdx) {
+      return std::tuple<decltype(cell_at<RowTs>(self, key, colIdx))...> {
+          cell_at<RowTs>(self, key, colIdx)...};
+   }
+
+   /// cell_at() returning nullptr instead of throwing.
+   template<typename T, typename Self>
+   static auto *try_cell_at(Self &self, column_key key, size_t colIdx) noexcept {
+      using pointer = std::conditional_t<std::is_const_v<Self>, const T *, T *>;
+      if (auto *row = self.mRows.find(getTypeID<T>())) {
+         return static_cast<pointer>(row->template try_at<T>(colIdx));
+      }
+      auto *sparse = self.mSparseRows.find(getTypeID<T>());
+      return sparse ? static_cast<pointer>(sparse->template find<T>(key)) : pointer {nullptr};
+   }
+
+   template<typename T>
+   sparse_row<column_key> &sparse_row_at(const char *message) {
+      auto *row = mSparseRows.find(getTypeID<T>());
+      if (!row) { THROW(std::out_of_range, "{}", message); }
+      return *row;
+   }
+
+   template<typename T>
+   const sparse_row<column_key> &sparse_row_at(const char *message) const {
+      const auto *row = mSparseRows.find(getTypeID<T>());
+      if (!row) { THROW(std::out_of_range, "{}", message); }
+      return *row;
+   }
+
+   template<typename... RowTs, typename Self, typename Fn>
+   static void for_each_with_impl(Self &self, Fn &fn) {
+      constexpr bool IsConst = std::is_const_v<Self>;
+      using sparse_type = std::conditional_t<IsConst, const sparse_row<column_key>,
+                                             sparse_row<column_key>>;
+      using sources_type =
+          std::tuple<row_source<std::conditional_t<IsConst, const RowTs, RowTs>, sparse_type>...>;
+
+      sources_type sources;
+      const sparse_type *driver = nullptr;
+      std::apply(
+          [&](auto &...source) {
+             const auto resolve = [&]<typename T>(row_source<T, sparse_type> &src) {
+                using U = std::remove_const_t<T>;
+                if (auto *row = self.mRows.find(getTypeID<U>())) {
+                   src.dense = row->template data<U>().data();
+                   return;
+                }
+                src.sparse =
+                    &self.template sparse_row_at<U>("table::for_each_with - row not found");
+                if (!driver || src.sparse->size() < driver->size()) { driver = src.sparse; }
+             };
+             (resolve(source), ...);
+          },
+          sources);
+
+      const auto invoke = [&](column_key key, auto &...cells) {
+         if constexpr (std::is_invocable_v<Fn &, column_key, decltype(cells)...>) {
+            fn(key, cells...);
+         } else {
+            fn(cells...);
+         }
+      };
+
+      if (!driver) {
+         for (size_t i = 0; i < self.column_count(); ++i) {
+            std::apply(
+                [&](auto &...source) {
+                   if constexpr (std::is_invocable_v<Fn &, column_key,
+                                                     decltype(*source.dense)...>) {
+                      fn(self.mColumnMapping.key_at_dense(i), source.dense[i]...);
+                   } else {
+                      fn(source.dense[i]...);
+                   }
+                },
+                sources);
+         }
+         return;
+      }
+
+      for (const column_key key : driver->keys()) {
+         // Keys held by sparse rows always belong to live columns.
+         const auto colIdx = static_cast<size_t>(self.mColumnMapping.unchecked_get(key));
+         std::apply(
+             [&](auto &...source) {
+                const auto cell_ptr = [&]<typename T>(row_source<T, sparse_type> &src) -> T * {
+                   if (src.dense) { return src.dense + colIdx; }
+                   return src.sparse->template find<std::remove_const_t<T>>(key);
+                };
+                std::apply(
+                    [&](auto *...cells) {
+                       if ((cells && ...)) { invoke(key, *cells...); }
+                    },
+                    std::tuple {cell_ptr(source)...});
+             },
+             sources);
+      }
+   }
+
+   template<typename T>
+   void mark_dirty_at(size_t colIdx) {
+      if (mDirty.empty() && mHashes.empty() && mBuffers.empty()) { return; }
+      cells_written(getTypeID<T>(), colIdx, 1);
+   }
+
+   untyped_vector &row_untyped(ty_id id, const char *message) {
+      auto *row = mRows.find(id);
+      if (!row) { THROW(std::out_of_range, "{}", message); }
+      return *row;
+   }
+
+   /// Reports a write to every cell of row @p id, as mark_dirty does.
+   void mark_row_dirty(ty_id id) {
+      if (auto *dirty = mDirty.find(id)) { dirty->set(0, dirty->size()); }
+      if (auto *hashes = mHashes.find(id)) { hashes->invalidate_all(); }
+      if (auto *buffered = mBuffers.find(id)) { (*buffered)->invalidate_all(); }
+   }
+
+   /// Reports writes to dense cells [first, first + count) of row @p id to its trackers.
+   void cells_written(ty_id id, size_t first, size_t count) {
+      if (auto *dirty = mDirty.find(id)) { dirty->set(first, count); }
+      if (auto *hashes = mHashes.find(id)) { hashes->invalidate(first, count); }
+      if (auto *buffered = mBuffers.find(id)) { (*buffered)->invalidate(first, count); }
+   }
+
+   buffered_row<column_key> &buffer_of(ty_id id, const char *message) {
+      auto *buffered = mBuffers.find(id);
+      if (!buffered) { THROW(std::out_of_range, "{}", message); }
+      return **buffered;
+   }
+
+   /// Makes every buffered row take a full copy with the new column layout on its next publishes.
+   void relayout_buffers() {
+      for (auto &entry : mBuffers) { entry.second->relayout(mRows.at(entry.first).size()); }
+   }
+
+   /// After columns are inserted, erased or reordered: buffered rows relayout, and an unfinished
+   /// sort_columns_incremental pass starts over.
+   void columns_changed() {
+      relayout_buffers();
+      mIncrementalSort.target.clear();
+   }
+
+   row_chunk_hashes &hash_cache(ty_id id, const char *message) const {
+      auto *hashes = mHashes.find(id);
+      if (!hashes) { THROW(std::out_of_range, "{}", message); }
+      return *hashes;
+   }
+
+   std::span<const uint64_t> refreshed_hashes(ty_id id, const char *message) const {
+      return hash_cache(id, message).refresh(mRows.at(id).bytes());
+   }
+
+   template<typename T>
+   const dense_bitset &dirty_bits(const char *message) const {
+      const dense_bitset *dirty = mDirty.find(getTypeID<T>());
+      if (!dirty) { THROW(std::out_of_range, "{}", message); }
+      return *dirty;
+   }
+   template<typename TT, bool IsConst, typename... RowTs>
+   friend class basic_table_query;
+   template<typename TT, bool IsConst, typename... RowTs>
+   friend class basic_table_join_query;
+
+   /// Mapping that rows loaded by map_readonly borrow their storage from, if any.
+   std::shared_ptr<const mapped_file> mSnapshot;
+   // ty_id is already an FNV-1a hash, so rows are indexed by it directly.
+   simple_flatmap<ty_id, untyped_vector, identity_hash, std::equal_to<ty_id>, open_addressing_index>
+       mRows;
+   /// Rows created with sparse_storage.
+   simple_flatmap<ty_id, sparse_row<column_key>, identity_hash, std::equal_to<ty_id>,
+                  open_addressing_index>
+       mSparseRows;
+   /// Dirty bits of the rows being tracked, indexed like the rows. See track_dirty.
+   simple_flatmap<ty_id, dense_bitset, identity_hash, std::equal_to<ty_id>, open_addressing_index>
+       mDirty;
+   /// Chunk hashes of the rows being hash-tracked, refreshed lazily by const readers. See
+   /// track_hashes.
+   mutable simple_flatmap<ty_id, row_chunk_hashes, identity_hash, std::equal_to<ty_id>,
+                          open_addressing_index>
+       mHashes;
+   /// Copies of the rows being buffered for reader threads. See buffer_row.
+   buffer_map mBuffers;
    column_mapping mColumnMapping;
+   /// Columns dense rows are reserved for when created; see reserve_columns.
+   size_t mReservedColumns {0};
+   /// Progress of the current sort_columns_incremental pass; no pass is running while target is
+   /// empty.
+   struct incremental_sort {
+      std::vector<size_t> target;
+      size_t cursor {0};
+      ty_id row {};
+      ty_id compare {};
+   };
+   incremental_sort mIncrementalSort;
 };
 
 /// @brief table_columns_iter — forward iterator over table columns
-/// Template parameters specify the set of rows to iterate over.
+/// Template parameters specify the set of rows to iterate over. basic_table_columns_iter is shared
+/// by every table type exposing unmarked_cells and a column_mapping.
 /// Iterator invalidation occurs only after calls to table::insert_column or table::erase_column.
 /// Reference invalidation occurs only after calls to table::insert_column, table::erase_column, or table::erase_row.
-template<typename ColumnTagT, bool IsConst, typename... RowTs>
-class table_columns_iter {
+template<typename TableT, bool IsConst, typename... RowTs>
+class basic_table_columns_iter {
   public:
-   using table_type = std::conditional_t<IsConst, const table<ColumnTagT>, table<ColumnTagT>>;
+   using table_type = std::conditional_t<IsConst, const TableT, TableT>;
    using cells_type =
        std::conditional_t<IsConst, std::tuple<const RowTs &...>, std::tuple<RowTs &...>>;
 
    using iterator_concept = std::forward_iterator_tag;
    using difference_type = std::ptrdiff_t;
    using value_type =
-       std::pair<typename table<ColumnTagT>::column_key, std::tuple<std::remove_cv_t<RowTs>...>>;
-   using reference = std::pair<typename table<ColumnTagT>::column_key, cells_type>;
+       std::pair<typename TableT::column_key, std::tuple<std::remove_cv_t<RowTs>...>>;
+   using reference = std::pair<typename TableT::column_key, cells_type>;
 
-   table_columns_iter() = delete;
-   table_columns_iter(table_type *tab, size_t dense_idx) : mTable(tab), mDenseIdx(dense_idx) {}
+   basic_table_columns_iter() = delete;
+   basic_table_columns_iter(table_type *tab, size_t dense_idx) :
+       mTable(tab), mDenseIdx(dense_idx) {}
 
    reference operator*() const {
       const auto key = mTable->mColumnMapping.key_at_dense(mDenseIdx);
-      return {key, mTable->template query_column<RowTs...>(key)};
+      return {key, TableT::template unmarked_cells<RowTs...>(*mTable, key, mDenseIdx)};
    }
 
-   table_columns_iter &operator++() {
+   basic_table_columns_iter &operator++() {
       ++mDenseIdx;
       return *this;
    }
 
-   table_columns_iter operator++(int) {
+   basic_table_columns_iter operator++(int) {
       auto copy = *this;
       ++*this;
       return copy;
    }
 
-   friend bool operator==(const table_columns_iter &a, const table_columns_iter &b) {
+   friend bool operator==(const basic_table_columns_iter &a, const basic_table_columns_iter &b) {
       return a.mTable == b.mTable && a.mDenseIdx == b.mDenseIdx;
    }
 
-   friend bool operator!=(const table_columns_iter &a, const table_columns_iter &b) {
+   friend bool operator!=(const basic_table_columns_iter &a, const basic_table_columns_iter &b) {
       return !(a == b);
    }
 
@@ -228,6 +1391,369 @@ class table_columns_iter {
    size_t mDenseIdx {0};
 };
 
+/// @brief table_query — view over rows RowTs... that iterates columns by dense index alone.
+/// Row storage is looked up once when the query is created, so iteration performs no key or type
+/// lookups and reads each row through a raw pointer.
+/// The query is invalidated by table::insert_column, table::erase_column, or erasing a queried row.
+template<typename TableT, bool IsConst, typename... RowTs>
+class basic_table_query {
+  public:
+   using table_type = std::conditional_t<IsConst, const TableT, TableT>;
+   using column_key = typename TableT::column_key;
+   template<typename T>
+   using cell_type = std::conditional_t<IsConst, const T, T>;
+   using reference = std::tuple<column_key, cell_type<RowTs> &...>;
+
+   class iterator {
+     public:
+      using iterator_concept = std::forward_iterator_tag;
+      using difference_type = std::ptrdiff_t;
+      using value_type = std::tuple<column_key, std::remove_cv_t<RowTs>...>;
+      using reference = basic_table_query::reference;
+
+      iterator() = default;
+      iterator(const basic_table_query *query, size_t dense_idx) :
+          mQuery(query), mDenseIdx(dense_idx) {}
+
+      reference operator*() const { return mQuery->at_dense(mDenseIdx); }
+
+      iterator &operator++() {
+         ++mDenseIdx;
+         return *this;
+      }
+
+      iterator operator++(int) {
+         auto copy = *this;
+         ++*this;
+         return copy;
+      }
+
+      friend bool operator==(const iterator &a, const iterator &b) {
+         return a.mQuery == b.mQuery && a.mDenseIdx == b.mDenseIdx;
+      }
+
+     private:
+      const basic_table_query *mQuery {nullptr};
+      size_t mDenseIdx {0};
+   };
+
+   /// Contiguous slice of the queried rows covering dense indices [offset, offset + size).
+   struct chunk {
+      size_t offset {0};
+      size_t size {0};
+      std::tuple<std::span<cell_type<RowTs>>...> rows;
+      const typename TableT::column_mapping *columns {nullptr};
+
+      template<typename T>
+      std::span<cell_type<T>> get() const {
+         return std::get<std::span<cell_type<T>>>(rows);
+      }
+
+      /// @brief Key of the column at index @p i within this chunk.
+      column_key key(size_t i) const { return columns->key_at_dense(offset + i); }
+   };
+
+   explicit basic_table_query(table_type &tab) :
+       mColumns(&tab.mColumnMapping),
+       mSize(tab.column_count()),
+       mRows {tab.template get_row<RowTs>().data()...} {}
+
+   size_t size() const { return mSize; }
+   bool empty() const { return mSize == 0; }
+
+   iterator begin() const { return {this, 0}; }
+   iterator end() const { return {this, mSize}; }
+
+   /// @brief Invokes @p fn for every column in dense order.
+   ///
+   /// @p fn is called as fn(key, cells...) if it accepts a leading column_key, and as fn(cells...)
+   /// otherwise. The latter form skips key reconstruction entirely and leaves a plain indexed loop
+   /// over the row pointers.
+   template<typename Fn>
+   void for_each(Fn &&fn) const {
+      std::apply(
+          [&](auto *...rows) {
+             for (size_t i = 0; i < mSize; ++i) {
+                if constexpr (std::is_invocable_v<Fn &, column_key, cell_type<RowTs> &...>) {
+                   fn(mColumns->key_at_dense(i), rows[i]...);
+                } else {
+                   fn(rows[i]...);
+                }
+             }
+          },
+          mRows);
+   }
+
+   /// @brief Rounds @p chunk_size up so that a chunk spans whole cache lines in every queried row.
+   ///
+   /// Boundaries are measured from the start of each row. Dense rows start on a cache line, both
+   /// when allocated (see untyped_vector) and when mapped from a page-aligned snapshot record, so
+   /// chunks written by different threads never share a line.
+   static constexpr size_t aligned_chunk_size(size_t chunk_size) {
+      size_t granularity = 1;
+      ((granularity =
+            std::lcm(granularity, CACHE_LINE_SIZE / std::gcd(CACHE_LINE_SIZE, sizeof(RowTs)))),
+       ...);
+      const size_t requested = std::max<size_t>(chunk_size, 1);
+      return ((requested + granularity - 1) / granularity) * granularity;
+   }
+
+   size_t chunk_count(size_t chunk_size) const {
+      const size_t aligned = aligned_chunk_size(chunk_size);
+      return (mSize + aligned - 1) / aligned;
+   }
+
+   /// @throws std::out_of_range if @p chunk_idx >= chunk_count(chunk_size).
+   chunk chunk_at(size_t chunk_idx, size_t chunk_size) const {
+      if (chunk_idx >= chunk_count(chunk_size)) {
+         THROW(std::out_of_range, "table_query::chunk_at - index out of range");
+      }
+      return make_chunk(chunk_idx, aligned_chunk_size(chunk_size));
+   }
+
+   /// @brief Invokes @p fn with every chunk on @p executor. See table::for_each_parallel.
+   template<typename Executor, typename Fn>
+   void for_each_chunk(Executor &&executor, size_t chunk_size, Fn &&fn) const {
+      const size_t aligned = aligned_chunk_size(chunk_size);
+      const size_t count = chunk_count(chunk_size);
+      auto task = [&](size_t chunk_idx) { fn(make_chunk(chunk_idx, aligned)); };
+      std::forward<Executor>(executor)(count, task);
+   }
+
+  private:
+   chunk make_chunk(size_t chunk_idx, size_t aligned_size) const {
+      const size_t offset = chunk_idx * aligned_size;
+      const size_t count = std::min(aligned_size, mSize - offset);
+      return std::apply(
+          [&](auto *...rows) {
+             return chunk {offset, count, {std::span(rows + offset, count)...}, mColumns};
+          },
+          mRows);
+   }
+
+   reference at_dense(size_t dense_idx) const {
+      return std::apply(
+          [&](auto *...rows) {
+             return reference {mColumns->key_at_dense(dense_idx), rows[dense_idx]...};
+          },
+          mRows);
+   }
+
+   const typename TableT::column_mapping *mColumns {nullptr};
+   size_t mSize {0};
+   std::tuple<cell_type<RowTs> *...> mRows;
+};
+
+/// Driving columns a join resolves per batch: their sparse lookups into the other table, then the
+/// matched cells, are prefetched together so the misses overlap.
+inline constexpr size_t JOIN_BATCH = 32;
+
+/// @brief table_join_query — view over the columns two tables with a shared column_key space both
+/// hold, reading rows RowTs... from either table.
+///
+/// Each row type is read from the left table if it has a dense row of that type, and from the
+/// right table otherwise, so a type both tables hold comes from the left one. Iteration walks the
+/// dense order of the table with fewer columns and looks each key up in the other one; row storage
+/// is resolved once when the query is created. Writes through a join are not dirty-tracked, as
+/// with query().
+/// The query is invalidated by inserting or erasing columns in either table, or erasing a queried
+/// row.
+template<typename TableT, bool IsConst, typename... RowTs>
+class basic_table_join_query {
+  public:
+   using table_type = std::conditional_t<IsConst, const TableT, TableT>;
+   using column_key = typename TableT::column_key;
+   template<typename T>
+   using cell_type = std::conditional_t<IsConst, const T, T>;
+   using reference = std::tuple<column_key, cell_type<RowTs> &...>;
+
+   class iterator {
+     public:
+      using iterator_concept = std::forward_iterator_tag;
+      using difference_type = std::ptrdiff_t;
+      using value_type = std::tuple<column_key, std::remove_cv_t<RowTs>...>;
+      using reference = basic_table_join_query::reference;
+
+      iterator() = default;
+      iterator(const basic_table_join_query *query, size_t driver_idx) :
+          mQuery(query), mDriverIdx(driver_idx) {
+         seek();
+      }
+
+      reference operator*() const { return mQuery->at(mKey, mDriverIdx, mOtherIdx); }
+
+      iterator &operator++() {
+         ++mDriverIdx;
+         seek();
+         return *this;
+      }
+
+      iterator operator++(int) {
+         auto copy = *this;
+         ++*this;
+         return copy;
+      }
+
+      friend bool operator==(const iterator &a, const iterator &b) {
+         return a.mQuery == b.mQuery && a.mDriverIdx == b.mDriverIdx;
+      }
+
+     private:
+      /// Advances to the first driving column at or after mDriverIdx the other table holds.
+      void seek() {
+         const size_t count = mQuery->mDriver->size();
+         for (; mDriverIdx < count; ++mDriverIdx) {
+            if (mDriverIdx + JOIN_BATCH < count) {
+               mQuery->mOther->prefetch(mQuery->mDriver->key_at_dense(mDriverIdx + JOIN_BATCH));
+            }
+            mKey = mQuery->mDriver->key_at_dense(mDriverIdx);
+            if (const auto otherIdx = mQuery->mOther->try_get(mKey)) {
+               mOtherIdx = static_cast<size_t>(*otherIdx);
+               return;
+            }
+         }
+      }
+
+      const basic_table_join_query *mQuery {nullptr};
+      size_t mDriverIdx {0};
+      size_t mOtherIdx {0};
+      column_key mKey {};
+   };
+
+   /// @throws std::out_of_range if neither table has a dense row of some type in RowTs.
+   basic_table_join_query(table_type &left, table_type &right) :
+       mLeftDrives(left.column_count() <= right.column_count()),
+       mDriver(mLeftDrives ? &left.mColumnMapping : &right.mColumnMapping),
+       mOther(mLeftDrives ? &right.mColumnMapping : &left.mColumnMapping),
+       mRows {resolve<RowTs>(left, right)...} {}
+
+   /// Number of columns in the driving table, an upper bound on the number of matches.
+   size_t driver_size() const { return mDriver->size(); }
+
+   iterator begin() const { return {this, 0}; }
+   iterator end() const { return {this, mDriver->size()}; }
+
+   /// @brief Invokes @p fn for every column both tables hold, in the driving table's dense order.
+   ///
+   /// @p fn is called as fn(key, cells...) if it accepts a leading column_key, and as fn(cells...)
+   /// otherwise. Columns are handled JOIN_BATCH at a time: the batch's sparse entries in the other
+   /// table are prefetched, then the matched cells of rows read from the other table, so a match
+   /// costs about one dependent load instead of two serialized misses.
+   template<typename Fn>
+   void for_each(Fn &&fn) const {
+      struct match {
+         column_key key;
+         size_t driverIdx;
+         size_t otherIdx;
+      };
+      std::array<column_key, JOIN_BATCH> keys;
+      std::array<match, JOIN_BATCH> matches;
+      const size_t count = mDriver->size();
+      for (size_t first = 0; first < count; first += JOIN_BATCH) {
+         const size_t batch = std::min(JOIN_BATCH, count - first);
+         for (size_t i = 0; i < batch; ++i) {
+            keys[i] = mDriver->key_at_dense(first + i);
+            mOther->prefetch(keys[i]);
+         }
+         size_t matched = 0;
+         for (size_t i = 0; i < batch; ++i) {
+            if (const auto otherIdx = mOther->try_get(keys[i])) {
+               matches[matched] = {keys[i], first + i, static_cast<size_t>(*otherIdx)};
+               prefetch_other(matches[matched].otherIdx);
+               ++matched;
+            }
+         }
+         for (size_t m = 0; m < matched; ++m) {
+            const match &hit = matches[m];
+            std::apply(
+                [&](const auto &...rows) {
+                   if constexpr (std::is_invocable_v<Fn &, column_key, cell_type<RowTs> &...>) {
+                      fn(hit.key, rows.cell(hit.driverIdx, hit.otherIdx)...);
+                   } else {
+                      fn(rows.cell(hit.driverIdx, hit.otherIdx)...);
+                   }
+                },
+                mRows);
+         }
+      }
+   }
+
+  private:
+   /// One queried row: its cells, and whether they are indexed by the driving table's dense order.
+   template<typename T>
+   struct joined_row {
+      cell_type<T> *cells;
+      bool drives;
+
+      cell_type<T> &cell(size_t driver_idx, size_t other_idx) const {
+         return cells[drives ? driver_idx : other_idx];
+      }
+   };
+
+   template<typename T>
+   joined_row<T> resolve(table_type &left, table_type &right) const {
+      if (left.find_row_untyped(getTypeID<T>())) {
+         return {left.template get_row<T>().data(), mLeftDrives};
+      }
+      return {right.template get_row<T>().data(), !mLeftDrives};
+   }
+
+   void prefetch_other(size_t other_idx) const {
+      std::apply(
+          [&](const auto &...rows) {
+             ((rows.drives ? void() : prefetch(rows.cells + other_idx)), ...);
+          },
+          mRows);
+   }
+
+   reference at(column_key key, size_t driver_idx, size_t other_idx) const {
+      return std::apply(
+          [&](const auto &...rows) {
+             return reference {key, rows.cell(driver_idx, other_idx)...};
+          },
+          mRows);
+   }
+
+   bool mLeftDrives;
+   const typename TableT::column_mapping *mDriver;
+   const typename TableT::column_mapping *mOther;
+   std::tuple<joined_row<RowTs>...> mRows;
+};
+
+/// @brief Pair of tables sharing one column_key space, e.g. tables kept in step by inserting
+/// and erasing the same columns from a common key source; see join().
+template<typename TableT, bool IsConst>
+class basic_table_join {
+  public:
+   using table_type = std::conditional_t<IsConst, const TableT, TableT>;
+
+   basic_table_join(table_type &left, table_type &right) : mLeft(&left), mRight(&right) {}
+
+   /// @brief Rows RowTs... over the columns both tables hold; see basic_table_join_query.
+   /// @throws std::out_of_range if neither table has a dense row of some type in RowTs.
+   template<typename... RowTs>
+   [[nodiscard]] basic_table_join_query<TableT, IsConst, RowTs...> query() const {
+      return basic_table_join_query<TableT, IsConst, RowTs...>(*mLeft, *mRight);
+   }
+
+  private:
+   table_type *mLeft;
+   table_type *mRight;
+};
+
+/// @brief Joins two tables on their shared column keys, for join(left, right).query<A, B>().
+template<typename ColumnTagT>
+[[nodiscard]] table_join<ColumnTagT, false> join(table<ColumnTagT> &left,
+                                                 table<ColumnTagT> &right) {
+   return {left, right};
+}
+
+template<typename ColumnTagT>
+[[nodiscard]] table_join<ColumnTagT, true> join(const table<ColumnTagT> &left,
+                                                const table<ColumnTagT> &right) {
+   return {left, right};
+}
+
 template<typename ColumnTagT>
 template<typename... RowTs>
 table_columns_iter<ColumnTagT, false, RowTs...> table<ColumnTagT>::columns_begin() {
@@ -252,4 +1778,16 @@ table_columns_iter<ColumnTagT, true, RowTs...> table<ColumnTagT>::columns_end()
    return {this, column_count()};
 }
 
-} // namespace tr
+template<typename ColumnTagT>
+template<typename... RowTs>
+table_query<ColumnTagT, false, RowTs...> table<ColumnTagT>::query() {
+   return table_query<ColumnTagT, false, RowTs...>(*this);
+}
+
+template<typename ColumnTagT>
+template<typename... RowTs>
+table_query<ColumnTagT, true, RowTs...> table<ColumnTagT>::query() const {
+   return table_query<ColumnTagT, true, RowTs...>(*this);
+}
+
+} // namespace tr
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "mapped_file.hpp"
+
+namespace tr {
+
+/// @file
+/// On-disk layout written by table::serialize and read by table::map_readonly.
+///
+/// A snapshot is a table_snapshot_header, followed by one table_snapshot_row per row, then the
+/// column SparseSet images, row type names and default values, and finally each row's raw cell
+/// bytes, every one starting on a TABLE_SNAPSHOT_PAGE_SIZE boundary so it can be used in place
+/// from a mapping. All offsets are from the start of the file. Fields are native-endian and cells
+/// are stored as-is, so a snapshot is only readable by builds with the same row type layouts on
+/// the same architecture.
+
+inline constexpr std::array<char, 8> TABLE_SNAPSHOT_MAGIC {'T', 'R', 'T', 'A', 'B', 'L', 'E', '\0'};
+inline constexpr uint32_t TABLE_SNAPSHOT_VERSION = 2;
+inline constexpr uint64_t TABLE_SNAPSHOT_PAGE_SIZE = 4096;
+
+struct table_snapshot_header {
+   std::array<char, 8> magic {TABLE_SNAPSHOT_MAGIC};
+   uint32_t version {TABLE_SNAPSHOT_VERSION};
+   uint32_t reserved {0};
+   uint64_t pageSize {TABLE_SNAPSHOT_PAGE_SIZE};
+   uint64_t freelistHead {0};
+   uint64_t versionFloor {0}; ///< See SparseSet::version_floor.
+   uint64_t columnTag {0}; ///< ty_id of the table's column tag type.
+   uint64_t columnCount {0};
+   uint64_t rowCount {0};
+   uint64_t denseOffset {0};
+   uint64_t denseBytes {0};
+   uint64_t sparseOffset {0};
+   uint64_t sparseBytes {0};
+};
+
+struct table_snapshot_row {
+   uint64_t id {0};
+   uint64_t size {0};
+   uint64_t alignment {0};
+   uint64_t nameOffset {0};
+   uint64_t nameBytes {0};
+   uint64_t defaultOffset {0}; ///< ty_info::size bytes of the default value representation.
+   uint64_t dataOffset {0};
+   uint64_t dataBytes {0};
+};
+
+/// Rounds @p offset up to a multiple of @p alignment, which must be a power of two.
+constexpr uint64_t snapshot_align(uint64_t offset, uint64_t alignment) {
+   return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace tr
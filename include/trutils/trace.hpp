@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+// Controls whether trutils emits tracing zones and counters from its structural mutations,
+// reallocations and allocator block spills. Off by default; when 0, TR_TRACE_ZONE and
+// TR_TRACE_COUNTER expand to nothing and their arguments are not evaluated. Must have the same
+// value in every translation unit of a program.
+//
+// When 1, events go to TR_TRACE_BACKEND_ZONE(name) and TR_TRACE_BACKEND_COUNTER(name, value) if
+// they are defined before the first trutils header, and to the callbacks installed with
+// tr::set_trace_hooks() otherwise. Names are string literals. For Tracy:
+//
+//    #define TR_TRACE 1
+//    #define TR_TRACE_BACKEND_ZONE(name) ZoneScopedN(name)
+//    #define TR_TRACE_BACKEND_COUNTER(name, value) TracyPlot(name, value)
+//
+// For Perfetto, with a "trutils" category registered through PERFETTO_DEFINE_CATEGORIES:
+//
+//    #define TR_TRACE 1
+//    #define TR_TRACE_BACKEND_ZONE(name) TRACE_EVENT("trutils", name)
+//    #define TR_TRACE_BACKEND_COUNTER(name, value) TRACE_COUNTER("trutils", name, value)
+#ifndef TR_TRACE
+#define TR_TRACE 0
+#endif
+
+namespace tr {
+
+/// @brief Callbacks receiving trace events when TR_TRACE is 1 and no backend macros are defined.
+/// Any of them may be null.
+struct trace_hooks {
+   void (*zone_begin)(const char *name, void *user) = nullptr;
+   void (*zone_end)(const char *name, void *user) = nullptr;
+   void (*counter)(const char *name, int64_t value, void *user) = nullptr;
+   void *user = nullptr;
+};
+
+inline trace_hooks gTraceHooks {};
+
+/// @brief Installs @p hooks for every later event. Not synchronized: install them before other
+/// threads use trutils. Pass trace_hooks {} to remove them.
+inline void set_trace_hooks(const trace_hooks &hooks) {
+   gTraceHooks = hooks;
+}
+
+/// @brief Reports the lifetime of a scope to the installed trace_hooks; see TR_TRACE_ZONE.
+class trace_zone {
+  public:
+   explicit trace_zone(const char *name) : mName(name) {
+      if (gTraceHooks.zone_begin) { gTraceHooks.zone_begin(mName, gTraceHooks.user); }
+   }
+   ~trace_zone() {
+      if (gTraceHooks.zone_end) { gTraceHooks.zone_end(mName, gTraceHooks.user); }
+   }
+   trace_zone(const trace_zone &) = delete;
+   trace_zone &operator=(const trace_zone &) = delete;
+   trace_zone(trace_zone &&) = delete;
+   trace_zone &operator=(trace_zone &&) = delete;
+
+  private:
+   const char *mName;
+};
+
+inline void trace_counter(const char *name, int64_t value) {
+   if (gTraceHooks.counter) { gTraceHooks.counter(name, value, gTraceHooks.user); }
+}
+
+} // namespace tr
+
+#define TR_TRACE_CONCAT_IMPL(a, b) a##b
+#define TR_TRACE_CONCAT(a, b) TR_TRACE_CONCAT_IMPL(a, b)
+
+#if !TR_TRACE
+/// Marks the rest of the enclosing scope as a zone called @p name.
+#define TR_TRACE_ZONE(name) ((void)0)
+/// Reports the current @p value of the counter called @p name.
+#define TR_TRACE_COUNTER(name, value) ((void)0)
+#elif defined(TR_TRACE_BACKEND_ZONE) && defined(TR_TRACE_BACKEND_COUNTER)
+#define TR_TRACE_ZONE(name) TR_TRACE_BACKEND_ZONE(name)
+#define TR_TRACE_COUNTER(name, value) TR_TRACE_BACKEND_COUNTER(name, static_cast<int64_t>(value))
+#else
+#define TR_TRACE_ZONE(name) const ::tr::trace_zone TR_TRACE_CONCAT(trTraceZone, __LINE__)(name)
+#define TR_TRACE_COUNTER(name, value) ::tr::trace_counter(name, static_cast<int64_t>(value))
+#endif
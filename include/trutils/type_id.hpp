@@ -1,8 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <source_location>
 #include <string_view>
+#include <type_traits>
 
 namespace tr {
 
@@ -13,6 +20,29 @@ using ty_id = uint64_t;
 template<typename T>
 inline const constexpr T gDefaultTypeInstance = T {};
 
+/// @brief Bulk operations on contiguous arrays of one type, callable with only its ty_info.
+///
+/// Each kernel works on @p count objects laid out back to back, as in an untyped_vector, and is
+/// instantiated from typed code, so loops vectorize as well as if T were known at the call site.
+struct ty_kernels {
+   /// Copies @p count objects from @p src to @p dst; the ranges must not overlap.
+   void (*copy_n)(void *dst, const void *src, size_t count);
+   /// Sets @p count objects at @p dst to the object at @p value.
+   void (*fill_n)(void *dst, const void *value, size_t count);
+   /// Index of the first object differing between @p a and @p b, or @p count if all are equal.
+   /// Uses operator== when T has one and compares bytes otherwise.
+   size_t (*compare_n)(const void *a, const void *b, size_t count);
+   /// Hash of @p count objects, chained from @p seed. Equal ranges hash equally: std::hash is used
+   /// per object when T's bytes do not determine its value (e.g. floats), raw bytes otherwise.
+   uint64_t (*hash_n)(const void *src, size_t count, uint64_t seed);
+   /// Replaces each object in @p values with its delta against the matching object in @p base:
+   /// the wrapping difference for integers, the bytewise XOR for everything else. Unchanged
+   /// objects encode to all zero bytes.
+   void (*delta_encode_n)(void *values, const void *base, size_t count);
+   /// Inverse of delta_encode_n with the same @p base.
+   void (*delta_decode_n)(void *deltas, const void *base, size_t count);
+};
+
 struct ty_info {
    std::string_view name;
    size_t size {};
@@ -20,6 +50,111 @@ struct ty_info {
    ty_id id {};
    const void *default_value_rep {nullptr}; // Is ONLY valid for trivially copyable types.
                                             // Must be null-checked before use.
+   const ty_kernels *kernels {nullptr};     // Set for trivially copyable types. Must be
+                                            // null-checked before use.
+};
+
+/// Word-at-a-time hash of @p bytes bytes chained from @p seed; the byte path of ty_kernels::hash_n.
+inline uint64_t hash_bytes(const void *data, size_t bytes, uint64_t seed) {
+   constexpr uint64_t mul = 0x9e3779b97f4a7c15ULL;
+   const auto *src = static_cast<const unsigned char *>(data);
+   uint64_t hash = seed ^ (bytes * mul);
+   size_t i = 0;
+   for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+      uint64_t word;
+      std::memcpy(&word, src + i, sizeof(word));
+      hash = (hash ^ word) * mul;
+      hash ^= hash >> 29;
+   }
+   if (i < bytes) {
+      uint64_t word = 0;
+      std::memcpy(&word, src + i, bytes - i);
+      hash = (hash ^ word) * mul;
+      hash ^= hash >> 29;
+   }
+   return hash;
+}
+
+/// @brief The ty_kernels of a trivially copyable T; see gTypeKernels.
+template<typename T>
+struct type_kernels {
+   static void copy_n(void *dst, const void *src, size_t count) {
+      std::memcpy(dst, src, count * sizeof(T));
+   }
+
+   static void fill_n(void *dst, const void *value, size_t count) {
+      T fill;
+      std::memcpy(&fill, value, sizeof(T));
+      std::fill_n(static_cast<T *>(dst), count, fill);
+   }
+
+   static size_t compare_n(const void *a, const void *b, size_t count) {
+      const auto *lhs = static_cast<const T *>(a);
+      const auto *rhs = static_cast<const T *>(b);
+      for (size_t i = 0; i < count; ++i) {
+         if constexpr (std::equality_comparable<T>) {
+            if (!(lhs[i] == rhs[i])) { return i; }
+         } else {
+            if (std::memcmp(lhs + i, rhs + i, sizeof(T)) != 0) { return i; }
+         }
+      }
+      return count;
+   }
+
+   static uint64_t hash_n(const void *src, size_t count, uint64_t seed) {
+      if constexpr (!std::has_unique_object_representations_v<T> &&
+                    requires(const T &value) { std::hash<T> {}(value); }) {
+         const auto *values = static_cast<const T *>(src);
+         for (size_t i = 0; i < count; ++i) {
+            const uint64_t element = std::hash<T> {}(values[i]);
+            seed = hash_bytes(&element, sizeof(element), seed);
+         }
+         return seed;
+      } else {
+         return hash_bytes(src, count * sizeof(T), seed);
+      }
+   }
+
+   static void delta_encode_n(void *values, const void *base, size_t count) {
+      if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+         using U = std::make_unsigned_t<T>;
+         auto *out = static_cast<T *>(values);
+         const auto *from = static_cast<const T *>(base);
+         for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<T>(static_cast<U>(out[i]) - static_cast<U>(from[i]));
+         }
+      } else {
+         xor_bytes(values, base, count * sizeof(T));
+      }
+   }
+
+   static void delta_decode_n(void *deltas, const void *base, size_t count) {
+      if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+         using U = std::make_unsigned_t<T>;
+         auto *out = static_cast<T *>(deltas);
+         const auto *from = static_cast<const T *>(base);
+         for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<T>(static_cast<U>(out[i]) + static_cast<U>(from[i]));
+         }
+      } else {
+         xor_bytes(deltas, base, count * sizeof(T));
+      }
+   }
+
+  private:
+   static void xor_bytes(void *dst, const void *src, size_t bytes) {
+      auto *out = static_cast<unsigned char *>(dst);
+      const auto *in = static_cast<const unsigned char *>(src);
+      for (size_t i = 0; i < bytes; ++i) { out[i] ^= in[i]; }
+   }
+};
+
+// Statically initialized kernel table for T, referenced by the ty_info of trivially copyable types.
+template<typename T>
+inline constexpr ty_kernels gTypeKernels {
+    &type_kernels<T>::copy_n,         &type_kernels<T>::fill_n,
+    &type_kernels<T>::compare_n,      &type_kernels<T>::hash_n,
+    &type_kernels<T>::delta_encode_n, &type_kernels<T>::delta_decode_n,
 };
 
 template<typename T>
@@ -83,6 +218,7 @@ constexpr ty_info getTypeInfo() {
       // Don't see how this could ever fail, but just in case...
       static_assert(sizeof(T) == sizeof(gDefaultTypeInstance<T>));
       info.default_value_rep = std::addressof(gDefaultTypeInstance<T>);
+      info.kernels = &gTypeKernels<T>;
    }
 
    return info;
@@ -1,19 +1,27 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <memory>
+#include <memory_resource>
 #include <span>
 #include <stdexcept>
 #include <utility>
 #include <vector>
 
 #include "panic.hpp"
+#include "trace.hpp"
 #include "type_id.hpp"
 
 namespace tr {
 
+/// Alignment of untyped_vector storage, and the granularity table queries split rows into for
+/// parallel iteration.
+constexpr size_t CACHE_LINE_SIZE = 64;
+
 template<typename T>
 concept trivially_copyable = std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>;
 
@@ -23,76 +31,290 @@ concept trivially_copyable = std::is_trivially_copyable_v<T> && std::is_triviall
 /// for most operations (like reserve, size, clear, etc.). Type-dependent
 /// operations (like at, operator[], push_back) are templated methods that
 /// verify the type at compile-time to prevent type errors.
+///
+/// Storage comes from a std::pmr::memory_resource, so arenas such as StackAlloc can back it, and is
+/// aligned to a cache line, or to ty_info::alignment if that is larger. Capacity grows
+/// geometrically and new storage is never zero-filled; every operation that adds elements writes
+/// them explicitly, except the *_uninitialized ones.
 class untyped_vector {
   public:
    /// @brief Constructor that initializes with a specific type
-   explicit untyped_vector(const ty_info &type_info) :
+   explicit untyped_vector(const ty_info &type_info,
+                           std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
        mTypeInfo(type_info),
-       mAlignedSz((type_info.size + type_info.alignment - 1) & ~(type_info.alignment - 1)) {
+       mAlignedSz((type_info.size + type_info.alignment - 1) & ~(type_info.alignment - 1)),
+       mResource(resource) {
       assert(type_info.alignment > 0);
+      assert(resource != nullptr);
+   }
+
+   /// @brief Creates a vector over external storage that it never frees.
+   ///
+   /// @p storage holds storage.size() / aligned slot size elements and must be aligned to at least
+   /// ty_info::alignment. It must outlive the vector, or its first growth, whichever comes first:
+   /// growing copies the elements into memory from @p resource, after which the vector behaves
+   /// like any other. Used to serve rows straight out of a mapped snapshot.
+   static untyped_vector borrow(const ty_info &type_info, std::span<std::byte> storage,
+                                std::pmr::memory_resource *resource =
+                                    std::pmr::get_default_resource()) {
+      untyped_vector vec(type_info, resource);
+      assert(storage.size() % vec.mAlignedSz == 0);
+      assert(reinterpret_cast<std::uintptr_t>(storage.data()) % type_info.alignment == 0);
+      if (storage.empty()) { return vec; }
+      vec.mBuffer = storage.data();
+      vec.mSize = storage.size() / vec.mAlignedSz;
+      vec.mCapacity = vec.mSize;
+      vec.mBorrowed = true;
+      return vec;
    }
 
    /// @brief Destructor
-   ~untyped_vector() = default;
+   ~untyped_vector() { release(); }
 
-   /// @brief Copy constructor
-   untyped_vector(const untyped_vector &other) = default;
+   /// @brief Copy constructor. The copy allocates from the same memory resource as @p other.
+   untyped_vector(const untyped_vector &other) :
+       mTypeInfo(other.mTypeInfo), mAlignedSz(other.mAlignedSz), mResource(other.mResource) {
+      copy_elements_from(other);
+   }
 
    /// @brief Move constructor
-   untyped_vector(untyped_vector &&other) noexcept = default;
-
-   /// @brief Copy assignment
-   untyped_vector &operator=(const untyped_vector &other) = default;
+   untyped_vector(untyped_vector &&other) noexcept :
+       mTypeInfo(other.mTypeInfo),
+       mAlignedSz(other.mAlignedSz),
+       mResource(other.mResource),
+       mBuffer(std::exchange(other.mBuffer, nullptr)),
+       mSize(std::exchange(other.mSize, 0)),
+       mCapacity(std::exchange(other.mCapacity, 0)),
+       mBorrowed(std::exchange(other.mBorrowed, false)) {}
+
+   /// @brief Copy assignment. Keeps allocating from this vector's memory resource.
+   untyped_vector &operator=(const untyped_vector &other) {
+      if (this == &other) { return *this; }
+      release();
+      mTypeInfo = other.mTypeInfo;
+      mAlignedSz = other.mAlignedSz;
+      copy_elements_from(other);
+      return *this;
+   }
 
-   /// @brief Move assignment
-   untyped_vector &operator=(untyped_vector &&other) noexcept = default;
+   /// @brief Move assignment. Adopts @p other's storage together with its memory resource.
+   untyped_vector &operator=(untyped_vector &&other) noexcept {
+      if (this == &other) { return *this; }
+      release();
+      mTypeInfo = other.mTypeInfo;
+      mAlignedSz = other.mAlignedSz;
+      mResource = other.mResource;
+      mBuffer = std::exchange(other.mBuffer, nullptr);
+      mSize = std::exchange(other.mSize, 0);
+      mCapacity = std::exchange(other.mCapacity, 0);
+      mBorrowed = std::exchange(other.mBorrowed, false);
+      return *this;
+   }
 
    /// @brief Returns the number of elements stored
-   size_t size() const { return mData.size() / mAlignedSz; }
+   size_t size() const { return mSize; }
 
    /// @brief Returns the allocated capacity in terms of elements
-   size_t capacity() const { return mData.capacity() / mAlignedSz; }
+   size_t capacity() const { return mCapacity; }
 
    /// @brief Returns true if the vector is empty
-   bool empty() const { return mData.empty(); }
+   bool empty() const { return mSize == 0; }
+
+   /// @brief Returns the memory resource backing this vector
+   std::pmr::memory_resource *resource() const { return mResource; }
 
    /// @brief Reserves capacity for at least the specified number of elements
-   void reserve(size_t new_capacity) { mData.reserve(new_capacity * mAlignedSz); }
+   void reserve(size_t new_capacity) {
+      if (new_capacity > mCapacity) { reallocate(new_capacity); }
+   }
+
+   /// @brief Reallocates to exactly size() elements, or frees the buffer when empty. Borrowed
+   /// storage already has no spare capacity and is left alone.
+   void shrink_to_fit() {
+      if (mCapacity == mSize || mBorrowed) { return; }
+      if (mSize == 0) {
+         release();
+      } else {
+         reallocate(mSize);
+      }
+   }
+
+   /// @brief Bytes of storage this vector owns, spare capacity included; 0 for borrowed storage.
+   size_t memory_usage() const { return mBorrowed ? 0 : mCapacity * mAlignedSz; }
 
    /// @brief Clears all elements from the vector
-   void clear() { mData.clear(); }
+   void clear() { mSize = 0; }
 
    /// @brief Removes the last element
    void pop_back() {
-      if (!mData.empty()) { mData.resize(mData.size() - mAlignedSz); }
+      if (mSize != 0) { --mSize; }
+   }
+
+   /// @brief Resizes to @p count elements without initializing any newly added ones.
+   ///
+   /// The contents of new elements are indeterminate until written, e.g. through data<T>() or
+   /// at<T>(). Intended for bulk loads that overwrite every byte anyway.
+   void resize_uninitialized(size_t count) {
+      if (count > mCapacity) { reallocate(std::max(count, mCapacity * 2)); }
+      mSize = count;
+   }
+
+   /// @brief Appends @p count elements without initializing them.
+   /// @return The raw bytes of the new elements, to be filled in by the caller.
+   std::span<std::byte> append_uninitialized(size_t count) {
+      const size_t first = mSize;
+      resize_uninitialized(mSize + count);
+      return std::span<std::byte>(element_ptr(first), count * mAlignedSz);
    }
 
    /// @brief Exchanges the contents of slots @p i and @p j without knowing the stored type.
    ///
-   /// Trivially destructible elements are swapped by exchanging each byte of the two slots in place.
+   /// Trivially copyable elements are swapped through a fixed-size temporary; common slot sizes get
+   /// their own kernel and larger slots are swapped in 64-byte blocks, which compilers lower to
+   /// vector loads and stores.
    /// @throws std::out_of_range if @p i or @p j is >= size().
    void swap(size_t i, size_t j) noexcept(false) {
       const size_t n = size();
       if (i >= n || j >= n) { THROW(std::out_of_range, "untyped_vector::swap - out of range"); }
       if (i == j) { return; }
-      std::byte *const a = element_ptr(i);
-      std::byte *const b = element_ptr(j);
-      for (size_t k = 0; k < mAlignedSz; ++k) { std::swap(a[k], b[k]); }
+      swap_slots(element_ptr(i), element_ptr(j), mAlignedSz);
    }
 
-   /// @brief Swaps the element at index with the last element and pops the last element.
+   /// @brief Removes the element at index by moving the last element into its slot.
    /// @throws std::out_of_range if index >= size().
    void swap_and_pop(size_t index) {
       const size_t n = size();
       if (index >= n) { THROW(std::out_of_range, "untyped_vector::swap_and_pop - out of range"); }
-      if (index + 1 == n) {
-         pop_back();
-         return;
-      }
-      swap(index, n - 1);
+      if (index + 1 != n) { std::memcpy(element_ptr(index), element_ptr(n - 1), mAlignedSz); }
       pop_back();
    }
 
+   /// @brief Overwrites element @p index with a byte copy of element @p other_index of @p other,
+   /// without knowing the stored type.
+   /// @throws std::runtime_error if @p other stores a different type.
+   /// @throws std::out_of_range if either index is out of range.
+   void copy_from(size_t index, const untyped_vector &other, size_t other_index) {
+      check_same_type(other, "untyped_vector::copy_from");
+      if (index >= mSize || other_index >= other.mSize) {
+         THROW(std::out_of_range, "untyped_vector::copy_from - out of range");
+      }
+      std::memcpy(element_ptr(index), other.element_ptr(other_index), mAlignedSz);
+   }
+
+   // Whole-vector operations through the stored type's ty_kernels. They need no template argument
+   // and run the typed loops, so tools holding only a ty_id get typed speed.
+
+   /// @brief Sets every element to a copy of the object at @p value.
+   /// @throws std::runtime_error if the stored type has no kernels (see ty_info::kernels).
+   void fill(const void *value) {
+      const ty_kernels &k = kernels("untyped_vector::fill");
+      if (mSize != 0) { k.fill_n(mBuffer, value, mSize); }
+   }
+
+   /// @brief Makes the elements a copy of those of @p other, keeping this vector's resource.
+   /// @throws std::runtime_error if @p other stores a different type or the type has no kernels.
+   void assign_elements(const untyped_vector &other) {
+      check_same_type(other, "untyped_vector::assign_elements");
+      const ty_kernels &k = kernels("untyped_vector::assign_elements");
+      if (&other == this) { return; }
+      resize_uninitialized(other.mSize);
+      if (mSize != 0) { k.copy_n(mBuffer, other.mBuffer, mSize); }
+   }
+
+   /// @brief Index of the first element that differs from @p other, or the smaller size if one
+   /// vector is a prefix of the other. The vectors are equal if this returns size() and the
+   /// sizes match.
+   /// @throws std::runtime_error if @p other stores a different type or the type has no kernels.
+   size_t mismatch(const untyped_vector &other) const {
+      check_same_type(other, "untyped_vector::mismatch");
+      const ty_kernels &k = kernels("untyped_vector::mismatch");
+      const size_t count = std::min(mSize, other.mSize);
+      return count == 0 ? 0 : k.compare_n(mBuffer, other.mBuffer, count);
+   }
+
+   /// @brief Hash of the elements, chained from @p seed; see ty_kernels::hash_n.
+   /// @throws std::runtime_error if the stored type has no kernels.
+   uint64_t hash(uint64_t seed = 0) const {
+      const ty_kernels &k = kernels("untyped_vector::hash");
+      return mSize == 0 ? hash_bytes(nullptr, 0, seed) : k.hash_n(mBuffer, mSize, seed);
+   }
+
+   /// @brief Replaces every element with its delta against the matching element of @p base, e.g.
+   /// to send a row over the network; elements equal to @p base become all zero bytes.
+   /// @throws std::runtime_error if @p base stores a different type or the type has no kernels.
+   /// @throws std::invalid_argument if the sizes differ.
+   void delta_encode(const untyped_vector &base) {
+      const ty_kernels &k = delta_kernels(base, "untyped_vector::delta_encode");
+      if (mSize != 0) { k.delta_encode_n(mBuffer, base.mBuffer, mSize); }
+   }
+
+   /// @brief Inverse of delta_encode with the same @p base.
+   /// @throws std::runtime_error if @p base stores a different type or the type has no kernels.
+   /// @throws std::invalid_argument if the sizes differ.
+   void delta_decode(const untyped_vector &base) {
+      const ty_kernels &k = delta_kernels(base, "untyped_vector::delta_decode");
+      if (mSize != 0) { k.delta_decode_n(mBuffer, base.mBuffer, mSize); }
+   }
+
+   /// @brief Replaces the contents with the elements at @p indices, in that order.
+   ///
+   /// Afterwards size() == indices.size() and element k is the former element indices[k]. Indices
+   /// may repeat or be omitted, so this covers both compaction and reordering.
+   /// @throws std::out_of_range if any index is >= size(); the vector is left unchanged.
+   void gather(std::span<const size_t> indices) {
+      check_indices(indices, "untyped_vector::gather - out of range");
+      const size_t newCapacity = std::max(indices.size(), mCapacity);
+      std::byte *fresh = allocate_buffer(newCapacity);
+      for (size_t k = 0; k < indices.size(); ++k) {
+         std::memcpy(fresh + (k * mAlignedSz), element_ptr(indices[k]), mAlignedSz);
+      }
+      adopt_buffer(fresh, newCapacity, indices.size());
+   }
+
+   /// @brief Moves element k to position @p indices[k] for every k.
+   ///
+   /// @p indices must be a permutation of [0, size()); the inverse operation of gather with the
+   /// same indices.
+   /// @throws std::out_of_range if indices.size() != size() or any index is >= size().
+   /// @throws std::invalid_argument if an index repeats. The vector is left unchanged either way.
+   void scatter(std::span<const size_t> indices) {
+      if (indices.size() != mSize) {
+         THROW(std::out_of_range, "untyped_vector::scatter - index count does not match size");
+      }
+      check_indices(indices, "untyped_vector::scatter - out of range");
+      std::vector<bool> seen(mSize, false);
+      for (const size_t idx : indices) {
+         if (seen[idx]) {
+            THROW(std::invalid_argument, "untyped_vector::scatter - not a permutation");
+         }
+         seen[idx] = true;
+      }
+      std::byte *fresh = allocate_buffer(mCapacity);
+      for (size_t k = 0; k < indices.size(); ++k) {
+         std::memcpy(fresh + (indices[k] * mAlignedSz), element_ptr(k), mAlignedSz);
+      }
+      adopt_buffer(fresh, mCapacity, mSize);
+   }
+
+   /// @brief Applies swap_and_pop for each of @p indices in order, shrinking the storage once.
+   ///
+   /// Each removal moves the current last element into the hole, which yields the same layout as
+   /// repeated swap_and_pop calls without resizing the byte buffer per element.
+   /// @throws std::out_of_range if an index is >= the size at the point it is removed.
+   void swap_and_pop(std::span<const size_t> indices) {
+      size_t n = size();
+      for (const size_t index : indices) {
+         if (index >= n) {
+            // Commit the removals performed so far so the vector stays consistent.
+            mSize = n;
+            THROW(std::out_of_range, "untyped_vector::swap_and_pop - out of range");
+         }
+         --n;
+         if (index != n) { std::memcpy(element_ptr(index), element_ptr(n), mAlignedSz); }
+      }
+      mSize = n;
+   }
+
    /// @brief Pushes a value onto the back of the vector
    template<typename T>
    void push_back(const T &value) {
@@ -111,13 +333,24 @@ class untyped_vector {
    ///
    /// The added element is zero-initialized. Use at<T>() to assign a value.
    /// This method does not require knowing the concrete type at call site.
-   void push_back_default() {
+   void push_back_default() { push_back_default(1); }
+
+   /// @brief Appends @p count default-initialized elements with a single resize.
+   ///
+   /// Equivalent to calling push_back_default() @p count times. The first new slot receives the
+   /// default value representation and is then replicated by doubling copies.
+   void push_back_default(size_t count) {
       // Debug assert instead of a more robust check because we enforce types stored to be
       // trivially copyable (see verify_type).
       assert(mTypeInfo.default_value_rep != nullptr);
-      mData.resize(mData.size() + mAlignedSz);
-      void *slot = element_ptr(size() - 1);
-      std::memcpy(slot, mTypeInfo.default_value_rep, mTypeInfo.size);
+      if (count == 0) { return; }
+      std::byte *const base = append_uninitialized(count).data();
+      std::memcpy(base, mTypeInfo.default_value_rep, mTypeInfo.size);
+      std::memset(base + mTypeInfo.size, 0, mAlignedSz - mTypeInfo.size);
+      for (size_t filled = 1; filled < count; filled *= 2) {
+         const size_t chunk = std::min(filled, count - filled);
+         std::memcpy(base + (filled * mAlignedSz), base, chunk * mAlignedSz);
+      }
    }
 
    /// @brief Resizes the container to contain count elements
@@ -129,14 +362,14 @@ class untyped_vector {
       // Same size? Do nothing.
       if (count == old_n) { return; }
 
-      // Shrink the vector. Trivial destructibility means we can just resize the vector.
+      // Shrink the vector. Trivial destructibility means we can just drop the tail.
       if (count < old_n) {
-         mData.resize(count * mAlignedSz);
+         mSize = count;
          return;
       }
 
       // Grow the Vector
-      mData.resize(count * mAlignedSz);
+      resize_uninitialized(count);
       for (size_t i = old_n; i < count; ++i) { write_element_at<T>(element_ptr(i), value); }
    }
 
@@ -162,6 +395,39 @@ class untyped_vector {
       return *reinterpret_cast<const T *>(element_ptr(index));
    }
 
+   /// @brief Pointer to the element at @p index, or nullptr if T is not the stored type or
+   /// @p index is out of bounds.
+   template<trivially_copyable T>
+   T *try_at(size_t index) noexcept {
+      if (!holds<T>() || index >= size()) { return nullptr; }
+      return reinterpret_cast<T *>(element_ptr(index));
+   }
+
+   template<trivially_copyable T>
+   const T *try_at(size_t index) const noexcept {
+      if (!holds<T>() || index >= size()) { return nullptr; }
+      return reinterpret_cast<const T *>(element_ptr(index));
+   }
+
+   /// @brief Like at(), but the type and bounds checks only run when TR_DEBUG_CHECKS is enabled.
+   template<trivially_copyable T>
+   T &unchecked_at(size_t index) {
+#if TR_DEBUG_CHECKS
+      return at<T>(index);
+#else
+      return *reinterpret_cast<T *>(element_ptr(index));
+#endif
+   }
+
+   template<trivially_copyable T>
+   const T &unchecked_at(size_t index) const {
+#if TR_DEBUG_CHECKS
+      return at<T>(index);
+#else
+      return *reinterpret_cast<const T *>(element_ptr(index));
+#endif
+   }
+
    /// @brief Returns a reference to the first element
    ///
    /// Throws std::runtime_error if the type doesn't match.
@@ -200,13 +466,25 @@ class untyped_vector {
    /// @brief Returns the type hash of the stored elements
    uint64_t type_hash() const { return mTypeInfo.id; }
 
+   /// @brief Returns the type information the vector was created with
+   const ty_info &type_info() const { return mTypeInfo; }
+
+   /// @brief Returns the raw bytes of every element, including per-slot alignment padding
+   std::span<const std::byte> bytes() const { return {mBuffer, mSize * mAlignedSz}; }
+
+   /// @brief Mutable raw bytes of every element; writes must leave valid objects behind.
+   std::span<std::byte> bytes() { return {mBuffer, mSize * mAlignedSz}; }
+
+   /// @brief Distance in bytes between consecutive elements: the size rounded up to the alignment.
+   size_t stride() const { return mAlignedSz; }
+
    /// @brief Returns a span of the elements for iteration
    ///
    /// Throws std::runtime_error if the type doesn't match the stored type.
    template<typename T>
    std::span<T> data() {
       verify_type<T>();
-      return std::span<T>(reinterpret_cast<T *>(mData.data()), size());
+      return std::span<T>(reinterpret_cast<T *>(mBuffer), size());
    }
 
    /// @brief Returns a const span of the elements for iteration
@@ -215,17 +493,194 @@ class untyped_vector {
    template<typename T>
    std::span<const T> data() const {
       verify_type<T>();
-      return std::span<const T>(reinterpret_cast<const T *>(mData.data()), size());
+      return std::span<const T>(reinterpret_cast<const T *>(mBuffer), size());
+   }
+
+   /// @brief Like data(), but the type check only runs when TR_DEBUG_CHECKS is enabled.
+   template<trivially_copyable T>
+   std::span<T> unchecked_data() {
+#if TR_DEBUG_CHECKS
+      verify_type<T>();
+#endif
+      return std::span<T>(reinterpret_cast<T *>(mBuffer), size());
+   }
+
+   template<trivially_copyable T>
+   std::span<const T> unchecked_data() const {
+#if TR_DEBUG_CHECKS
+      verify_type<T>();
+#endif
+      return std::span<const T>(reinterpret_cast<const T *>(mBuffer), size());
+   }
+
+   /// @brief Typed handle to an untyped_vector whose element type was verified once on creation.
+   ///
+   /// Element access goes straight through a raw pointer; only bounds are checked, and only when
+   /// TR_DEBUG_CHECKS is enabled. The view stays valid across reallocations of the vector, but not
+   /// after the vector itself is destroyed or moved from. T may be const-qualified for read-only
+   /// access.
+   template<typename T>
+   class typed_view {
+     public:
+      using value_type = std::remove_const_t<T>;
+      using vector_type =
+          std::conditional_t<std::is_const_v<T>, const untyped_vector, untyped_vector>;
+
+      /// @throws std::runtime_error if T doesn't match the stored type.
+      explicit typed_view(vector_type &vec) : mVec(&vec) { vec.template verify_type<value_type>(); }
+
+      size_t size() const { return mVec->size(); }
+      bool empty() const { return mVec->empty(); }
+
+      T *data() const { return reinterpret_cast<T *>(mVec->mBuffer); }
+      T *begin() const { return data(); }
+      T *end() const { return data() + size(); }
+      std::span<T> span() const { return std::span<T>(data(), size()); }
+
+      T &operator[](size_t index) const {
+#if TR_DEBUG_CHECKS
+         if (index >= size()) {
+            THROW(std::out_of_range, "untyped_vector::typed_view - out of range");
+         }
+#endif
+         return data()[index];
+      }
+
+     private:
+      vector_type *mVec;
+   };
+
+   /// @brief Returns a typed_view over the elements.
+   /// @throws std::runtime_error if the type doesn't match the stored type.
+   template<trivially_copyable T>
+   typed_view<T> view() {
+      return typed_view<T>(*this);
+   }
+
+   template<trivially_copyable T>
+   typed_view<const T> view() const {
+      return typed_view<const T>(*this);
    }
 
   private:
-   std::vector<std::byte> mData;
    ty_info mTypeInfo;
    size_t mAlignedSz;
+   std::pmr::memory_resource *mResource;
+   std::byte *mBuffer {nullptr};
+   size_t mSize {0};
+   size_t mCapacity {0};
+   bool mBorrowed {false}; ///< mBuffer is external storage (see borrow) and is never deallocated.
 
    /// Access the ith element as a pointer to its raw bytes.
-   std::byte *element_ptr(size_t i) { return mData.data() + (i * mAlignedSz); }
-   const std::byte *element_ptr(size_t i) const { return mData.data() + (i * mAlignedSz); }
+   std::byte *element_ptr(size_t i) { return mBuffer + (i * mAlignedSz); }
+   const std::byte *element_ptr(size_t i) const { return mBuffer + (i * mAlignedSz); }
+
+   /// A whole cache line, so that slices of different vectors' elements starting at the same index
+   /// never share a line with a neighbouring allocation, and chunks cut at line multiples from the
+   /// start stay line-aligned. Over-aligned types get their ty_info::alignment.
+   size_t storage_alignment() const { return std::max(mTypeInfo.alignment, CACHE_LINE_SIZE); }
+
+   std::byte *allocate_buffer(size_t capacity) {
+      return static_cast<std::byte *>(
+          mResource->allocate(capacity * mAlignedSz, storage_alignment()));
+   }
+
+   /// Frees the current buffer and takes ownership of @p buffer.
+   void adopt_buffer(std::byte *buffer, size_t capacity, size_t size) {
+      release();
+      mBuffer = buffer;
+      mCapacity = capacity;
+      mSize = size;
+   }
+
+   void reallocate(size_t new_capacity) {
+      TR_TRACE_ZONE("untyped_vector::reallocate");
+      TR_TRACE_COUNTER("untyped_vector::reallocated_bytes", new_capacity * mAlignedSz);
+      std::byte *fresh = allocate_buffer(new_capacity);
+      if (mSize != 0) { std::memcpy(fresh, mBuffer, mSize * mAlignedSz); }
+      adopt_buffer(fresh, new_capacity, mSize);
+   }
+
+   void check_indices(std::span<const size_t> indices, const char *message) const {
+      for (const size_t index : indices) {
+         if (index >= mSize) { THROW(std::out_of_range, "{}", message); }
+      }
+   }
+
+   template<size_t N>
+   static void swap_fixed(std::byte *a, std::byte *b) {
+      std::byte tmp[N];
+      std::memcpy(tmp, a, N);
+      std::memcpy(a, b, N);
+      std::memcpy(b, tmp, N);
+   }
+
+   /// Swaps two non-overlapping slots of @p n bytes each.
+   static void swap_slots(std::byte *a, std::byte *b, size_t n) {
+      switch (n) {
+         case 4: swap_fixed<4>(a, b); return;
+         case 8: swap_fixed<8>(a, b); return;
+         case 16: swap_fixed<16>(a, b); return;
+         case 32: swap_fixed<32>(a, b); return;
+         case 64: swap_fixed<64>(a, b); return;
+         default: break;
+      }
+
+      constexpr size_t blockSz = 64;
+      for (; n >= blockSz; n -= blockSz, a += blockSz, b += blockSz) { swap_fixed<blockSz>(a, b); }
+      std::byte tmp[blockSz];
+      std::memcpy(tmp, a, n);
+      std::memcpy(a, b, n);
+      std::memcpy(b, tmp, n);
+   }
+
+   void release() {
+      if (mBuffer && !mBorrowed) {
+         mResource->deallocate(mBuffer, mCapacity * mAlignedSz, storage_alignment());
+      }
+      mBuffer = nullptr;
+      mCapacity = 0;
+      mBorrowed = false;
+   }
+
+   void copy_elements_from(const untyped_vector &other) {
+      mSize = 0;
+      if (other.mSize == 0) { return; }
+      reallocate(other.mSize);
+      std::memcpy(mBuffer, other.mBuffer, other.mSize * mAlignedSz);
+      mSize = other.mSize;
+   }
+
+   void check_same_type(const untyped_vector &other, const char *message) const {
+      if (other.mTypeInfo.id != mTypeInfo.id) {
+         THROW(std::runtime_error, "{} - type mismatch: expected '{}', got '{}'", message,
+               mTypeInfo.name, other.mTypeInfo.name);
+      }
+   }
+
+   const ty_kernels &kernels(const char *message) const {
+      if (mTypeInfo.kernels == nullptr) {
+         THROW(std::runtime_error, "{} - type '{}' has no kernels", message, mTypeInfo.name);
+      }
+      // Kernels step by sizeof(T), which is always a multiple of alignof(T).
+      assert(mAlignedSz == mTypeInfo.size);
+      return *mTypeInfo.kernels;
+   }
+
+   const ty_kernels &delta_kernels(const untyped_vector &base, const char *message) const {
+      check_same_type(base, message);
+      if (base.mSize != mSize) { THROW(std::invalid_argument, "{} - size mismatch", message); }
+      return kernels(message);
+   }
+
+   /// Whether the stored elements are T. Size and alignment are compared as well as the id, since
+   /// storage borrowed from a snapshot takes them from the file: a type that changed layout under
+   /// the same name must not be read through.
+   template<typename T>
+   bool holds() const noexcept {
+      return mTypeInfo.id == getTypeID<T>() && mTypeInfo.size == sizeof(T) &&
+             mTypeInfo.alignment == alignof(T);
+   }
 
    /// @brief Helper to verify type matches the stored type
    /// Also performs compile-time checking to confirm that the type is trivially destructible.
@@ -236,6 +691,12 @@ class untyped_vector {
                "untyped_vector::verify_type - type mismatch: expected '{}', got '{}'",
                mTypeInfo.name, get_unique_type_name<T>());
       }
+      if (mTypeInfo.size != sizeof(T) || mTypeInfo.alignment != alignof(T)) {
+         THROW(std::runtime_error,
+               "untyped_vector::verify_type - layout mismatch for '{}': stored {} bytes aligned to "
+               "{}, requested {} bytes aligned to {}",
+               mTypeInfo.name, mTypeInfo.size, mTypeInfo.alignment, sizeof(T), alignof(T));
+      }
    }
 
    /// Copy value into one aligned slot at slot.
@@ -247,8 +708,7 @@ class untyped_vector {
 
    template<trivially_copyable T>
    void append_element(const T &value) {
-      mData.resize(mData.size() + mAlignedSz);
-      write_element_at<T>(element_ptr(size() - 1), value);
+      write_element_at<T>(append_uninitialized(1).data(), value);
    }
 };
 
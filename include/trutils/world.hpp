@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "panic.hpp"
+#include "simple_flatmap.hpp"
+#include "slot_map.hpp"
+#include "table.hpp"
+#include "trace.hpp"
+#include "type_id.hpp"
+
+namespace tr {
+
+/// Default tag for world entity keys.
+struct entity_tag {};
+
+/// @brief Entities with any set of components, stored grouped by component signature.
+///
+/// Every distinct set of component types (an archetype) owns a table whose columns are the
+/// entities having exactly that set, with one dense row per component plus one holding each
+/// column's entity. Adding or removing a component moves the entity's column to the neighbouring
+/// archetype with one untyped cell copy per shared component (table::move_column); the step is
+/// cached as an edge on both archetypes, so repeated transitions skip the signature lookup.
+///
+/// A query for components Ts... visits only the archetypes holding all of them and iterates their
+/// rows densely, so it never touches entities lacking one. The matching archetypes are cached per
+/// query and extended incrementally as archetypes are created.
+///
+/// Components must be trivially copyable, like all table cells. References and query results are
+/// invalidated by create, destroy, add and remove, which must not be called from within for_each.
+template<typename EntityTag = entity_tag>
+class world {
+  public:
+   using entity = Key<EntityTag>;
+
+   /// @param resource Memory resource the component rows are allocated from.
+   explicit world(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+       mResource(resource) {
+      (void)archetype_for({});
+   }
+
+   /// @brief Creates an entity without components.
+   [[nodiscard]] entity create() {
+      const entity e = mLocations.insert(location {});
+      auto &root = mArchetypes[EMPTY_ARCHETYPE].cells;
+      const auto column = root.insert_column();
+      root.template cell<entity>(column) = e;
+      mLocations.get(e).column = column;
+      return e;
+   }
+
+   /// @brief Destroys @p e and its components.
+   /// @return false if @p e is not alive.
+   bool destroy(entity e) {
+      if (!mLocations.contains(e)) { return false; }
+      const location loc = mLocations.remove(e);
+      mArchetypes[loc.archetype].cells.erase_column(loc.column);
+      return true;
+   }
+
+   bool alive(entity e) const { return mLocations.contains(e); }
+
+   /// Number of live entities.
+   size_t size() const { return mLocations.size(); }
+
+   /// Number of archetypes created so far, including the empty one; archetypes are never freed.
+   size_t archetype_count() const { return mArchetypes.size(); }
+
+   /// @throws std::out_of_range if @p e is not alive.
+   template<typename T>
+   bool has(entity e) const {
+      return mArchetypes[mLocations.get(e).archetype].cells.template contains_row<T>();
+   }
+
+   /// @brief Gives @p e a component T holding @p value, moving it to the matching archetype.
+   /// @throws std::out_of_range if @p e is not alive.
+   /// @throws std::invalid_argument if @p e already has a T.
+   template<typename T>
+   T &add(entity e, const T &value = T {}) {
+      check_component<T>();
+      location &loc = mLocations.get(e);
+      if (mArchetypes[loc.archetype].cells.template contains_row<T>()) {
+         THROW(std::invalid_argument, "world::add - entity already has the component");
+      }
+      mTypes.insert(getTypeID<T>(), getTypeInfo<T>());
+
+      const uint32_t to = add_target(loc.archetype, getTypeID<T>());
+      auto &cells = mArchetypes[to].cells;
+      loc = {to, mArchetypes[loc.archetype].cells.move_column(loc.column, cells)};
+      return cells.template cell<T>(loc.column) = value;
+   }
+
+   /// @brief Removes component T from @p e, moving it to the matching archetype.
+   /// @return false if @p e has no T.
+   /// @throws std::out_of_range if @p e is not alive.
+   template<typename T>
+   bool remove(entity e) {
+      location &loc = mLocations.get(e);
+      if (!mArchetypes[loc.archetype].cells.template contains_row<T>()) { return false; }
+
+      const uint32_t to = remove_target(loc.archetype, getTypeID<T>());
+      loc = {to, mArchetypes[loc.archetype].cells.move_column(loc.column, mArchetypes[to].cells)};
+      return true;
+   }
+
+   /// @throws std::out_of_range if @p e is not alive or has no T.
+   template<typename T>
+   T &get(entity e) {
+      const location loc = mLocations.get(e);
+      return mArchetypes[loc.archetype].cells.template cell<T>(loc.column);
+   }
+
+   /// @throws std::out_of_range if @p e is not alive or has no T.
+   template<typename T>
+   const T &get(entity e) const {
+      const location loc = mLocations.get(e);
+      return mArchetypes[loc.archetype].cells.template cell<T>(loc.column);
+   }
+
+   /// @brief Calls @p fn for every entity having all of Ts..., archetype by archetype.
+   ///
+   /// @p fn is called as fn(entity, Ts &...) if it accepts a leading entity, and as fn(Ts &...)
+   /// otherwise, which skips reading the entity row.
+   template<typename... Ts, typename Fn>
+   void for_each(Fn &&fn) {
+      for_each_impl<Ts...>(*this, fn);
+   }
+
+   template<typename... Ts, typename Fn>
+   void for_each(Fn &&fn) const {
+      for_each_impl<Ts...>(*this, fn);
+   }
+
+   /// Number of entities having all of Ts....
+   template<typename... Ts>
+   size_t count() const {
+      size_t result = 0;
+      for (const uint32_t idx : matching<Ts...>()) {
+         result += mArchetypes[idx].cells.column_count();
+      }
+      return result;
+   }
+
+   /// @brief Indices of the archetypes holding all of Ts..., in creation order.
+   ///
+   /// Cached per query; archetypes created since the last call are checked on the next one.
+   /// @throws std::runtime_error if another query's cached signature has the same hash.
+   template<typename... Ts>
+   std::span<const uint32_t> matching() const {
+      std::array<ty_id, sizeof...(Ts)> ids {getTypeID<Ts>()...};
+      std::sort(ids.begin(), ids.end());
+      const ty_id hash = hash_signature(ids);
+      query_cache *cache = mQueries.find(hash);
+      if (!cache) {
+         query_cache created;
+         created.signature.assign(ids.begin(), ids.end());
+         cache = &mQueries.insert(hash, std::move(created)).second;
+      } else if (!std::ranges::equal(cache->signature, ids)) {
+         THROW(std::runtime_error, "world - query signature hash collision");
+      }
+      for (; cache->checked < mArchetypes.size(); ++cache->checked) {
+         const auto &signature = mArchetypes[cache->checked].signature;
+         if (std::includes(signature.begin(), signature.end(), ids.begin(), ids.end())) {
+            cache->archetypes.push_back(static_cast<uint32_t>(cache->checked));
+         }
+      }
+      return cache->archetypes;
+   }
+
+  private:
+   struct archetype_column_tag {};
+   using archetype_table = table<archetype_column_tag>;
+   using edge_map =
+       simple_flatmap<ty_id, uint32_t, identity_hash, std::equal_to<ty_id>, open_addressing_index>;
+
+   static constexpr uint32_t EMPTY_ARCHETYPE = 0;
+
+   struct archetype {
+      std::vector<ty_id> signature; ///< Sorted ids of the component types.
+      archetype_table cells;        ///< One column per entity, one row per component.
+      edge_map addEdges;            ///< Archetype reached by adding a component type.
+      edge_map removeEdges;         ///< Archetype reached by removing a component type.
+   };
+
+   struct location {
+      uint32_t archetype {EMPTY_ARCHETYPE};
+      typename archetype_table::column_key column;
+   };
+
+   struct query_cache {
+      std::vector<ty_id> signature; ///< Sorted ids of the queried types.
+      std::vector<uint32_t> archetypes;
+      size_t checked {0}; ///< Archetypes already tested against the query.
+   };
+
+   template<typename Self, typename T>
+   using cell_of = std::conditional_t<std::is_const_v<Self>, const T, T>;
+
+   template<typename T>
+   static constexpr void check_component() {
+      static_assert(trivially_copyable<T>, "world - components must be trivially copyable");
+      static_assert(!std::is_same_v<T, entity>, "world - entity is reserved for the entity row");
+   }
+
+   static ty_id hash_signature(std::span<const ty_id> ids) {
+      // FNV-1a over the sorted ids, so equal sets hash equally whatever order they came in.
+      ty_id hash = 0xcbf29ce484222325ULL;
+      for (const ty_id id : ids) {
+         hash ^= id;
+         hash *= 0x100000001b3ULL;
+      }
+      return hash;
+   }
+
+   /// Index of the archetype for @p signature, which must be sorted, creating it if needed.
+   uint32_t archetype_for(std::vector<ty_id> signature) {
+      const ty_id hash = hash_signature(signature);
+      if (const uint32_t *idx = mArchetypeIndex.find(hash)) {
+         if (mArchetypes[*idx].signature != signature) {
+            THROW(std::runtime_error, "world - archetype signature hash collision");
+         }
+         return *idx;
+      }
+
+      TR_TRACE_ZONE("world::create_archetype");
+      archetype created;
+      (void)created.cells.template create_row<entity>(mResource);
+      for (const ty_id id : signature) { created.cells.create_row(mTypes.at(id), mResource); }
+      created.signature = std::move(signature);
+
+      const auto idx = static_cast<uint32_t>(mArchetypes.size());
+      mArchetypes.push_back(std::move(created));
+      mArchetypeIndex.insert(hash, idx);
+      TR_TRACE_COUNTER("world::archetypes", mArchetypes.size());
+      return idx;
+   }
+
+   uint32_t add_target(uint32_t from, ty_id id) {
+      if (const uint32_t *to = mArchetypes[from].addEdges.find(id)) { return *to; }
+      auto signature = mArchetypes[from].signature;
+      signature.insert(std::lower_bound(signature.begin(), signature.end(), id), id);
+      const uint32_t to = archetype_for(std::move(signature));
+      mArchetypes[from].addEdges.insert(id, to);
+      mArchetypes[to].removeEdges.insert(id, from);
+      return to;
+   }
+
+   uint32_t remove_target(uint32_t from, ty_id id) {
+      if (const uint32_t *to = mArchetypes[from].removeEdges.find(id)) { return *to; }
+      auto signature = mArchetypes[from].signature;
+      signature.erase(std::lower_bound(signature.begin(), signature.end(), id));
+      const uint32_t to = archetype_for(std::move(signature));
+      mArchetypes[from].removeEdges.insert(id, to);
+      mArchetypes[to].addEdges.insert(id, from);
+      return to;
+   }
+
+   template<typename... Ts, typename Self, typename Fn>
+   static void for_each_impl(Self &self, Fn &fn) {
+      for (const uint32_t idx : self.template matching<Ts...>()) {
+         auto &cells = self.mArchetypes[idx].cells;
+         if constexpr (std::is_invocable_v<Fn &, entity, cell_of<Self, Ts> &...>) {
+            cells.template query<entity, Ts...>().for_each(
+                [&](const entity &e, cell_of<Self, Ts> &...components) { fn(e, components...); });
+         } else {
+            cells.template query<Ts...>().for_each(
+                [&](cell_of<Self, Ts> &...components) { fn(components...); });
+         }
+      }
+   }
+
+   std::pmr::memory_resource *mResource;
+   SlotMap<entity, location> mLocations;
+   std::vector<archetype> mArchetypes;
+   edge_map mArchetypeIndex; ///< Archetype index by signature hash.
+   simple_flatmap<ty_id, ty_info, identity_hash, std::equal_to<ty_id>, open_addressing_index>
+       mTypes; ///< Type info of every component type seen, to build archetype rows from.
+   mutable simple_flatmap<ty_id, query_cache, identity_hash, std::equal_to<ty_id>,
+                          open_addressing_index>
+       mQueries;
+};
+
+} // namespace tr
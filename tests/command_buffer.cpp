@@ -0,0 +1,98 @@
+// NOLINTBEGIN
+
+#include "trutils/command_buffer.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace tr;
+
+TEST_CASE("command_buffer defers creates, writes and erases to playback", "[command_buffer]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<double>();
+   std::vector<table<>::column_key> existing;
+   t.insert_columns(4, std::back_inserter(existing));
+
+   command_buffer<> cb;
+   REQUIRE(cb.empty());
+   const auto p0 = cb.create();
+   const auto p1 = cb.create();
+   cb.write<int>(p0, 10);
+   cb.write<double>(p1, 2.5);
+   cb.write<int>(existing[2], 7);
+   cb.write<int>(existing[2], 8);
+   cb.write<int>(existing[1], 99);
+   cb.erase(existing[1]);
+   cb.erase(existing[3]);
+   cb.erase(existing[3]);
+   REQUIRE(cb.create_count() == 2);
+
+   // Nothing is applied until playback.
+   REQUIRE(t.column_count() == 4);
+   REQUIRE(t.cell<int>(existing[2]) == 0);
+
+   std::vector<table<>::column_key> created;
+   cb.playback(t, std::back_inserter(created));
+   REQUIRE(cb.empty());
+   REQUIRE(created.size() == 2);
+   REQUIRE(t.column_count() == 4);
+   REQUIRE(t.cell<int>(created[0]) == 10);
+   REQUIRE(t.cell<double>(created[1]) == 2.5);
+   REQUIRE(t.cell<int>(existing[2]) == 8);
+   REQUIRE_FALSE(t.contains_column(existing[1]));
+   REQUIRE_FALSE(t.contains_column(existing[3]));
+}
+
+TEST_CASE("command_buffer plays back several buffers as one batch", "[command_buffer]") {
+   table<> t;
+   t.create_row<int>();
+
+   command_buffer<> a;
+   command_buffer<> b;
+   for (int i = 0; i < 300; ++i) { a.write<int>(a.create(), i); }
+   b.write<int>(b.create(), -1);
+   b.write<float>(b.create(), 1.0F);
+
+   std::vector<command_buffer<> *> buffers {&a, &b};
+   std::vector<table<>::column_key> created;
+   command_buffer<>::playback(t, buffers, std::back_inserter(created));
+   REQUIRE(created.size() == 302);
+   REQUIRE(t.column_count() == 302);
+   for (int i = 0; i < 300; ++i) { REQUIRE(t.cell<int>(created[static_cast<size_t>(i)]) == i); }
+   REQUIRE(t.cell<int>(created[300]) == -1);
+   REQUIRE(t.cell<int>(created[301]) == 0);
+   REQUIRE(a.empty());
+   REQUIRE(b.empty());
+}
+
+TEST_CASE("slot_map_command_buffer defers inserts and removes", "[command_buffer][SlotMap]") {
+   SlotMap<Key<DefaultTag>, std::string> map;
+   const auto k0 = map.insert(std::string("a"));
+   const auto k1 = map.insert(std::string("b"));
+
+   slot_map_command_buffer<Key<DefaultTag>, std::string> cb;
+   cb.insert(std::string("c"));
+   cb.insert(std::string("d"));
+   cb.remove(k0);
+   cb.remove(k0);
+   REQUIRE(map.size() == 2);
+
+   std::vector<Key<DefaultTag>> inserted;
+   cb.playback(map, std::back_inserter(inserted));
+   REQUIRE(cb.empty());
+   REQUIRE(inserted.size() == 2);
+   REQUIRE(map.size() == 3);
+   REQUIRE_FALSE(map.contains(k0));
+   REQUIRE(map.get(k1) == "b");
+   REQUIRE(map.get(inserted[0]) == "c");
+   REQUIRE(map.get(inserted[1]) == "d");
+
+   cb.insert(std::string("discarded"));
+   cb.clear();
+   REQUIRE(cb.empty());
+}
+
+// NOLINTEND
@@ -0,0 +1,85 @@
+// NOLINTBEGIN
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include "trutils/concurrent_stack_alloc.hpp"
+
+using namespace tr;
+
+TEST_CASE("ConcurrentStackAlloc honours size and alignment", "[concurrent_stack_alloc]") {
+   ConcurrentStackAlloc<256> sa;
+   for (const size_t alignment : {1, 2, 8, 16, 64, 128}) {
+      auto *p = static_cast<unsigned char *>(sa.allocate(24, alignment));
+      REQUIRE(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+      std::memset(p, 0x5A, 24);
+   }
+
+   // Larger than a block: served from a dedicated allocation.
+   auto *big = static_cast<unsigned char *>(sa.allocate(10000, 256));
+   REQUIRE(reinterpret_cast<uintptr_t>(big) % 256 == 0);
+   std::memset(big, 0x11, 10000);
+
+   std::pmr::vector<int> values(&sa);
+   for (int i = 0; i < 1000; ++i) { values.push_back(i); }
+   REQUIRE(values[999] == 999);
+   REQUIRE(big[9999] == 0x11);
+   REQUIRE(sa.is_equal(sa));
+}
+
+TEST_CASE("ConcurrentStackAlloc reset reuses its blocks", "[concurrent_stack_alloc]") {
+   ConcurrentStackAlloc<256> sa;
+   std::vector<void *> first;
+   for (int i = 0; i < 20; ++i) { first.push_back(sa.allocate(64, 16)); }
+   (void)sa.allocate(5000, 8);
+
+   for (int frame = 0; frame < 3; ++frame) {
+      sa.reset();
+      for (size_t i = 0; i < first.size(); ++i) { REQUIRE(sa.allocate(64, 16) == first[i]); }
+   }
+}
+
+TEST_CASE("ConcurrentStackAlloc hands out disjoint memory across threads",
+          "[concurrent_stack_alloc]") {
+   constexpr size_t kThreads = 8;
+   constexpr size_t kPerThread = 2000;
+   ConcurrentStackAlloc<1024> sa;
+
+   for (int frame = 0; frame < 2; ++frame) {
+      std::vector<std::vector<uint32_t *>> results(kThreads);
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < kThreads; ++t) {
+         workers.emplace_back([&, t] {
+            for (size_t i = 0; i < kPerThread; ++i) {
+               const size_t count = 1 + (i % 7);
+               auto *p = static_cast<uint32_t *>(
+                   sa.allocate(count * sizeof(uint32_t), alignof(uint32_t)));
+               std::fill_n(p, count, static_cast<uint32_t>((t << 16) | i));
+               results[t].push_back(p);
+            }
+            if (t == 0) { (void)sa.allocate(4096, 64); }
+         });
+      }
+      for (auto &worker : workers) { worker.join(); }
+
+      // Every allocation still holds what its owner wrote, so none overlapped.
+      for (size_t t = 0; t < kThreads; ++t) {
+         for (size_t i = 0; i < kPerThread; ++i) {
+            const uint32_t *p = results[t][i];
+            const size_t count = 1 + (i % 7);
+            for (size_t k = 0; k < count; ++k) {
+               REQUIRE(p[k] == static_cast<uint32_t>((t << 16) | i));
+            }
+         }
+      }
+      sa.reset();
+   }
+}
+
+// NOLINTEND
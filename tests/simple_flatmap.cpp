@@ -3,6 +3,8 @@
 #include "trutils/simple_flatmap.hpp"
 
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -12,8 +14,9 @@ using namespace tr;
 
 namespace {
 
-template<typename Key, typename T, typename Hash, typename KeyEqual>
-void expect_matches_ref(const simple_flatmap<Key, T, Hash, KeyEqual> &map,
+template<typename Key, typename T, typename Hash, typename KeyEqual,
+         template<typename, typename, typename> class Index>
+void expect_matches_ref(const simple_flatmap<Key, T, Hash, KeyEqual, Index> &map,
                         const std::unordered_map<Key, T, Hash, KeyEqual> &ref) {
    REQUIRE(map.size() == ref.size());
    REQUIRE(map.empty() == ref.empty());
@@ -176,4 +179,41 @@ TEST_CASE("simple_flatmap custom hash and equality", "[simple_flatmap]") {
    REQUIRE(map.contains(Point {1, 2}));
 }
 
+TEST_CASE("simple_flatmap open addressing index matches reference under churn",
+          "[simple_flatmap][open_addressing]") {
+   simple_flatmap<uint64_t, int, identity_hash, std::equal_to<uint64_t>, open_addressing_index> map;
+   std::unordered_map<uint64_t, int, identity_hash> ref;
+   std::mt19937_64 rng(1234);
+
+   for (int i = 0; i < 20000; ++i) {
+      // A small key range forces collisions, displacement and backward-shift deletion.
+      const uint64_t key = rng() % 512;
+      if (rng() % 3 == 0) {
+         REQUIRE(map.erase(key) == (ref.erase(key) != 0));
+      } else {
+         map[key] = i;
+         ref[key] = i;
+      }
+   }
+   expect_matches_ref(map, ref);
+   REQUIRE_THROWS_AS(map.at(100000), std::out_of_range);
+
+   map.clear();
+   REQUIRE(map.empty());
+   REQUIRE_FALSE(map.contains(0));
+}
+
+TEST_CASE("simple_flatmap open addressing index with hashed keys and reserve",
+          "[simple_flatmap][open_addressing]") {
+   simple_flatmap<std::string, int, std::hash<std::string>, std::equal_to<std::string>,
+                  open_addressing_index>
+       map;
+   map.reserve(100);
+   for (int i = 0; i < 100; ++i) { map.insert(std::to_string(i), i); }
+   REQUIRE(map.size() == 100);
+   for (int i = 0; i < 100; i += 2) { REQUIRE(map.erase(std::to_string(i))); }
+   for (int i = 0; i < 100; ++i) { REQUIRE(map.contains(std::to_string(i)) == (i % 2 == 1)); }
+   REQUIRE(map.at("51") == 51);
+}
+
 // NOLINTEND
\ No newline at end of file
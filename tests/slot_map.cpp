@@ -1,13 +1,27 @@
 // NOLINTBEGIN
 
 #include "trutils/slot_map.hpp"
+#include "trutils/stack_alloc.hpp"
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/generators/catch_generators_random.hpp>
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory_resource>
+#include <random>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 using Catch::Generators::RandomIntegerGenerator;
 
@@ -96,4 +110,503 @@ TEST_CASE("Basic Sanity Tests For SlotMap", "[SlotMap]") {
    drain(map, data, 1);
 }
 
-// NOLINTEND
\ No newline at end of file
+TEST_CASE("SparseSet insert_n drains the freelist then appends", "[SparseSet]") {
+   using namespace tr;
+
+   SparseSet<> set;
+   std::vector<Key<DefaultTag>> keys;
+   set.insert_n(8, std::back_inserter(keys));
+   REQUIRE(set.size() == 8);
+   REQUIRE(set.erase(keys[1]));
+   REQUIRE(set.erase(keys[5]));
+
+   SparseSet<> reference = set;
+   std::vector<Key<DefaultTag>> batch;
+   set.insert_n(5, std::back_inserter(batch));
+   REQUIRE(batch.size() == 5);
+   for (const auto &key : batch) { REQUIRE(key == reference.insert()); }
+
+   REQUIRE(set.size() == 11);
+   for (size_t i = 0; i < set.size(); ++i) {
+      REQUIRE(set.get(set.key_at_dense(i)) == i);
+      REQUIRE(reference.key_at_dense(i) == set.key_at_dense(i));
+   }
+   REQUIRE_FALSE(set.contains(keys[1]));
+}
+
+TEST_CASE("small batches grow storage geometrically", "[SparseSet][SlotMap]") {
+   using namespace tr;
+
+   SparseSet<> set;
+   SlotMap<Key<DefaultTag>, int> map;
+   std::vector<Key<DefaultTag>> keys;
+   const std::vector<int> batch {1, 2, 3};
+   size_t setGrowths = 0;
+   size_t mapGrowths = 0;
+   for (int i = 0; i < 100; ++i) {
+      const size_t setCapacity = set.capacity();
+      const int *mapData = map.data().data();
+      set.insert_n(batch.size(), std::back_inserter(keys));
+      map.insert_range(batch, std::back_inserter(keys));
+      setGrowths += set.capacity() != setCapacity ? 1 : 0;
+      mapGrowths += map.data().data() != mapData ? 1 : 0;
+   }
+   // Reserving exactly size + count would reallocate on every one of the 100 batches.
+   REQUIRE(setGrowths <= 10);
+   REQUIRE(mapGrowths <= 10);
+   REQUIRE(map.size() == 300);
+}
+
+TEST_CASE("SlotMap insert_range and remove_batch", "[SlotMap]") {
+   using namespace tr;
+
+   SlotMap<Key<DefaultTag>, std::string> map;
+   const auto single = map.insert("single");
+
+   const std::vector<std::string> names {"a", "b", "c", "d", "e"};
+   std::vector<Key<DefaultTag>> keys;
+   map.insert_range(names, std::back_inserter(keys));
+   REQUIRE(map.size() == 6);
+   for (size_t i = 0; i < names.size(); ++i) { REQUIRE(map.get(keys[i]) == names[i]); }
+
+   // Unsized ranges go through the same path.
+   const std::list<std::string> more {"x", "y"};
+   map.insert_range(more, std::back_inserter(keys));
+   REQUIRE(map.get(keys[6]) == "y");
+
+   SlotMap<Key<DefaultTag>, std::string> sequential = map;
+   const std::vector<Key<DefaultTag>> doomed {keys[0], keys[3], keys[0], single, keys[6]};
+   REQUIRE(map.remove_batch(doomed) == 4);
+   for (const auto key : {keys[0], keys[3], single, keys[6]}) { (void)sequential.remove(key); }
+
+   REQUIRE(map.size() == 4);
+   REQUIRE(std::vector<std::string>(map.begin(), map.end()) ==
+           std::vector<std::string>(sequential.begin(), sequential.end()));
+   for (const auto key : {keys[1], keys[2], keys[4], keys[5]}) {
+      REQUIRE(map.contains(key) == sequential.contains(key));
+   }
+   REQUIRE(map.get(keys[5]) == "x");
+   REQUIRE(map.remove_batch(doomed) == 0);
+}
+
+namespace {
+/// Runs the same insert/remove/iterate churn against any storage backend and a reference map.
+template<typename Map>
+void exercise_storage(Map &map, size_t count) {
+   using K = tr::Key<tr::DefaultTag>;
+   std::unordered_map<K, uint64_t> ref;
+   for (uint64_t i = 0; i < count; ++i) { ref.insert({map.insert(i * 7), i * 7}); }
+
+   std::vector<K> doomed;
+   for (const auto &[key, value] : ref) {
+      if (value % 3 == 0) { doomed.push_back(key); }
+   }
+   for (size_t i = 0; i < doomed.size(); ++i) {
+      if (i % 2 == 0) {
+         REQUIRE(map.remove(doomed[i]) == ref[doomed[i]]);
+         ref.erase(doomed[i]);
+      }
+   }
+   std::erase_if(doomed, [&](const K &key) { return !ref.contains(key); });
+   REQUIRE(map.remove_batch(doomed) == doomed.size());
+   for (const K &key : doomed) { ref.erase(key); }
+
+   REQUIRE(map.size() == ref.size());
+   uint64_t sum = 0;
+   uint64_t refSum = 0;
+   for (const uint64_t value : map) { sum += value; }
+   for (const auto &[key, value] : ref) {
+      REQUIRE(map.get(key) == value);
+      refSum += value;
+   }
+   REQUIRE(sum == refSum);
+}
+} // namespace
+
+TEST_CASE("SlotMap works with chunked_vector storage", "[SlotMap][storage]") {
+   using namespace tr;
+   SlotMap<Key<DefaultTag>, uint64_t, chunked_vector> map;
+   exercise_storage(map, 5000);
+
+   chunked_vector<int, 4> vec;
+   for (int i = 0; i < 10; ++i) { vec.push_back(i); }
+   const int *third = &vec[2];
+   for (int i = 10; i < 100; ++i) { vec.push_back(i); }
+   REQUIRE(third == &vec[2]);
+   REQUIRE(std::ranges::equal(vec, std::views::iota(0, 100)));
+   REQUIRE(vec.end() - vec.begin() == 100);
+   REQUIRE_THROWS_AS(vec.at(100), std::out_of_range);
+
+   while (vec.size() > 5) { vec.pop_back(); }
+   vec.shrink_to_fit();
+   REQUIRE(vec.capacity() == 8);
+}
+
+TEST_CASE("SlotMap works with inline_vector storage", "[SlotMap][storage]") {
+   using namespace tr;
+   SlotMap<Key<DefaultTag>, uint64_t, inline_storage<256>::type> map;
+   exercise_storage(map, 256);
+   REQUIRE(map.data().size() == map.size());
+
+   SlotMap<Key<DefaultTag>, std::string, inline_storage<2>::type> small;
+   (void)small.insert("a");
+   (void)small.insert("b");
+   REQUIRE_THROWS_AS(small.insert("c"), std::length_error);
+}
+
+TEST_CASE("SlotMap works with pmr vector storage on a StackAlloc", "[SlotMap][storage]") {
+   using namespace tr;
+   StackAlloc<> arena;
+   SlotMap<Key<DefaultTag>, uint64_t, std::pmr::vector> map {std::pmr::vector<uint64_t>(&arena)};
+   exercise_storage(map, 100);
+}
+
+TEST_CASE("SlotMap insert_range rolls back when the key space runs out", "[SlotMap]") {
+   using namespace tr;
+   // 4-bit ids leave room for 13 live keys.
+   using tiny_key = Key<DefaultTag, key_layout<4, 8>>;
+   SlotMap<tiny_key, int> map;
+   const auto a = map.insert(1);
+   const auto b = map.insert(2);
+   const auto c = map.insert(3);
+   REQUIRE(map.remove(b) == 2);
+
+   // The freed slot is handed out before the sparse array runs out, then insert_n throws.
+   const std::vector<int> values(12, 7);
+   std::vector<tiny_key> keys;
+   REQUIRE_THROWS_AS(map.insert_range(values, std::back_inserter(keys)), std::runtime_error);
+   REQUIRE(keys.empty());
+   REQUIRE(map.size() == 2);
+   REQUIRE(map.get(a) == 1);
+   REQUIRE(map.get(c) == 3);
+   REQUIRE(std::vector<int>(map.begin(), map.end()) == std::vector<int> {1, 3});
+
+   // The rolled-back slots are reusable.
+   map.insert_range(std::vector<int>(11, 9), std::back_inserter(keys));
+   REQUIRE(map.size() == 13);
+   for (const auto key : keys) { REQUIRE(map.get(key) == 9); }
+}
+
+TEST_CASE("SlotMap insert_range rolls back values when storage overflows", "[SlotMap]") {
+   using namespace tr;
+   SlotMap<Key<DefaultTag>, int, inline_storage<4>::type> map;
+   const auto first = map.insert(1);
+
+   // Unsized, so the overflow only shows up on the fourth push.
+   const std::vector<int> values {2, 3, 4, 5, 6, 7};
+   std::vector<Key<DefaultTag>> keys;
+   REQUIRE_THROWS_AS(
+       map.insert_range(values | std::views::filter([](int) { return true; }),
+                        std::back_inserter(keys)),
+       std::length_error);
+   REQUIRE(keys.empty());
+   REQUIRE(map.size() == 1);
+   REQUIRE(map.get(first) == 1);
+
+   REQUIRE(map.remove(first) == 1);
+   const auto next = map.insert(7);
+   REQUIRE(map.get(next) == 7);
+   REQUIRE(map.size() == 1);
+}
+
+TEST_CASE("Key layouts pack id and version into the configured width", "[SparseSet][key_layout]") {
+   using namespace tr;
+   using small_key = Key<DefaultTag, key_layout<24, 8>>;
+   using wide_key = Key<DefaultTag, key_layout<40, 24>>;
+   static_assert(sizeof(small_key) == sizeof(uint32_t));
+   static_assert(sizeof(wide_key) == sizeof(uint64_t));
+   static_assert(sizeof(Key<DefaultTag>) == sizeof(uint64_t));
+
+   SparseSet<small_key> small;
+   std::vector<small_key> keys;
+   small.insert_n(100, std::back_inserter(keys));
+   for (size_t i = 0; i < keys.size(); ++i) {
+      REQUIRE(small.get(keys[i]) == i);
+      REQUIRE(keys[i].getID() == i);
+   }
+
+   // An 8-bit version retires a slot after 255 reuses instead of wrapping around.
+   small.clear();
+   auto key = small.insert();
+   const auto firstKey = key;
+   for (int i = 0; i < 254; ++i) {
+      REQUIRE(small.erase(key));
+      key = small.insert();
+      REQUIRE(key.getID() == firstKey.getID());
+   }
+   REQUIRE(small.erase(key));
+   REQUIRE(small.insert().getID() != firstKey.getID());
+   REQUIRE_FALSE(small.contains(firstKey));
+
+   SlotMap<wide_key, int> map;
+   const auto a = map.insert(1);
+   const auto b = map.insert(2);
+   (void)map.remove(a);
+   REQUIRE_FALSE(map.contains(a));
+   REQUIRE(map.get(b) == 2);
+   REQUIRE(std::hash<wide_key> {}(a) != std::hash<wide_key> {}(b));
+}
+
+TEST_CASE("SparseSet shrink_to_fit trims trailing free entries", "[SparseSet][shrink_to_fit]") {
+   using namespace tr;
+   SparseSet<> set;
+   std::vector<Key<DefaultTag>> keys;
+   set.insert_n(1000, std::back_inserter(keys));
+   for (size_t i = 10; i < keys.size(); ++i) { REQUIRE(set.erase(keys[i])); }
+   REQUIRE(set.erase(keys[3]));
+   REQUIRE(set.erase(keys[7]));
+   REQUIRE(set.erase(keys[5]));
+   REQUIRE(set.sparse_size() == 1000);
+
+   set.shrink_to_fit();
+   REQUIRE(set.sparse_size() == 10);
+   REQUIRE(set.size() == 7);
+   for (const size_t i : {0, 1, 2, 4, 6, 8, 9}) { REQUIRE(set.contains(keys[i])); }
+
+   // The freelist is rebuilt in ascending order, then new entries are appended.
+   REQUIRE(set.insert().getID() == 3);
+   REQUIRE(set.insert().getID() == 5);
+   REQUIRE(set.insert().getID() == 7);
+   const auto appended = set.insert();
+   REQUIRE(appended.getID() == 10);
+
+   // Stale keys into the trimmed range never match the re-created entries.
+   REQUIRE_FALSE(set.contains(keys[10]));
+   REQUIRE_FALSE(set.contains(keys[3]));
+   REQUIRE(set.contains(appended));
+   REQUIRE(set.get(appended) == 10);
+}
+
+template<typename KeyType>
+using small_pages = tr::paged_sparse_array<KeyType, 64>;
+
+TEST_CASE("SparseSet from_bytes rejects corrupt freelists", "[SparseSet][snapshot]") {
+   using namespace tr;
+   using set_type = SparseSet<>;
+   using entry = sparse_entry<Key<DefaultTag>::layout>;
+   set_type set;
+   std::vector<Key<DefaultTag>> keys;
+   set.insert_n(6, std::back_inserter(keys));
+   REQUIRE(set.erase(keys[1]));
+   REQUIRE(set.erase(keys[4])); // freelist: 4 -> 1 -> end
+
+   const auto dense = set.dense_bytes();
+   const auto load = [&](const std::vector<entry> &sparse, uint32_t head) {
+      return set_type::from_bytes(dense, std::as_bytes(std::span(sparse)), head);
+   };
+   const auto image = [&] {
+      std::vector<entry> sparse(set.sparse_size());
+      std::memcpy(sparse.data(), set.sparse_bytes().data(), set.sparse_bytes().size());
+      return sparse;
+   };
+
+   const auto intact = load(image(), set.freelist_head());
+   REQUIRE(intact.get(keys[5]) == set.get(keys[5]));
+
+   auto cycle = image();
+   cycle[1].setDenseIdx(4);
+   REQUIRE_THROWS_AS(load(cycle, 4), std::runtime_error);
+
+   auto outOfRange = image();
+   outOfRange[1].setDenseIdx(100);
+   REQUIRE_THROWS_AS(load(outOfRange, 4), std::runtime_error);
+
+   // Slot 3 holds a live key, so handing it out again would alias it.
+   auto throughLive = image();
+   throughLive[1].setDenseIdx(3);
+   REQUIRE_THROWS_AS(load(throughLive, 4), std::runtime_error);
+   REQUIRE_THROWS_AS(load(image(), 3), std::runtime_error);
+}
+
+TEST_CASE("Paged SparseSet tracks keys like the flat one", "[SparseSet][paged]") {
+   using namespace tr;
+   SparseSet<Key<DefaultTag>, small_pages> set;
+   std::vector<Key<DefaultTag>> live;
+   std::vector<Key<DefaultTag>> stale;
+   std::mt19937_64 rng {7};
+
+   for (int step = 0; step < 20000; ++step) {
+      if (live.empty() || rng() % 5 < 3) {
+         live.push_back(set.insert());
+      } else {
+         const size_t idx = rng() % live.size();
+         REQUIRE(set.erase(live[idx]));
+         REQUIRE_FALSE(set.erase(live[idx]));
+         stale.push_back(live[idx]);
+         live[idx] = live.back();
+         live.pop_back();
+      }
+   }
+
+   REQUIRE(set.size() == live.size());
+   std::unordered_set<size_t> denseIdxs;
+   for (const auto key : live) {
+      REQUIRE(set.contains(key));
+      REQUIRE(set.key_at_dense(set.get(key)) == key);
+      denseIdxs.insert(set.get(key));
+   }
+   REQUIRE(denseIdxs.size() == live.size());
+   for (const auto key : stale) { REQUIRE_FALSE(set.contains(key)); }
+
+   auto copy = set;
+   for (const auto key : live) { REQUIRE(copy.get(key) == set.get(key)); }
+   REQUIRE(copy.erase(live.front()));
+   REQUIRE(set.contains(live.front()));
+}
+
+TEST_CASE("Paged SparseSet frees pages without live keys", "[SparseSet][paged]") {
+   using namespace tr;
+   SparseSet<Key<DefaultTag>, small_pages> set;
+   std::vector<Key<DefaultTag>> keys;
+   set.insert_n(64 * 4, std::back_inserter(keys));
+   REQUIRE(set.sparse_size() == 64 * 4);
+
+   // The first page to empty is kept as a spare, the second is freed.
+   for (size_t i = 64; i < 64 * 3; ++i) { REQUIRE(set.erase(keys[i])); }
+   REQUIRE(set.sparse_size() == 64 * 3);
+
+   // Lookups into a freed page miss without touching it.
+   for (size_t i = 64; i < 64 * 3; ++i) { REQUIRE_FALSE(set.contains(keys[i])); }
+   for (size_t i = 0; i < 64; ++i) { REQUIRE(set.contains(keys[i])); }
+
+   // Refilling re-creates pages; old keys into them stay invalid.
+   std::vector<Key<DefaultTag>> refill;
+   set.insert_n(64 * 2, std::back_inserter(refill));
+   REQUIRE(set.sparse_size() == 64 * 4);
+   REQUIRE(set.size() == 64 * 4);
+   for (size_t i = 64; i < 64 * 3; ++i) { REQUIRE_FALSE(set.contains(keys[i])); }
+   for (const auto key : refill) {
+      REQUIRE(key.getID() >= 64);
+      REQUIRE(key.getID() < 64 * 3);
+      REQUIRE(set.contains(key));
+   }
+
+   // shrink_to_fit also drops the spare page.
+   for (const auto key : refill) { REQUIRE(set.erase(key)); }
+   REQUIRE(set.sparse_size() == 64 * 3);
+   set.shrink_to_fit();
+   REQUIRE(set.sparse_size() == 64 * 2);
+   REQUIRE(set.insert().getID() == 64);
+
+   set.clear();
+   REQUIRE(set.sparse_size() == 0);
+   REQUIRE_FALSE(set.contains(keys[0]));
+}
+
+TEST_CASE("SlotMap get_many gathers values in key order", "[SlotMap][get_many]") {
+   using namespace tr;
+   SlotMap<Key<DefaultTag>, uint64_t, chunked_vector> map;
+   std::vector<Key<DefaultTag>> keys;
+   for (uint64_t i = 0; i < 1000; ++i) { keys.push_back(map.insert(i * 3)); }
+   for (size_t i = 0; i < keys.size(); i += 7) { (void)map.remove(keys[i]); }
+   std::erase_if(keys, [&](auto key) { return !map.contains(key); });
+   std::shuffle(keys.begin(), keys.end(), std::mt19937_64 {3});
+
+   std::vector<uint64_t> values;
+   map.get_many(keys, std::back_inserter(values));
+   REQUIRE(values.size() == keys.size());
+   for (size_t i = 0; i < keys.size(); ++i) { REQUIRE(values[i] == map.get(keys[i])); }
+
+   std::vector<uint64_t> none;
+   map.get_many({}, std::back_inserter(none));
+   REQUIRE(none.empty());
+
+   auto stale = keys;
+   stale.push_back(keys.front());
+   (void)map.remove(keys.front());
+   values.clear();
+   REQUIRE_THROWS_AS(map.get_many(stale, std::back_inserter(values)), std::out_of_range);
+
+   SparseSet<> set;
+   const auto a = set.insert();
+   const auto b = set.insert();
+   std::array<Key<DefaultTag>, 2> setKeys {b, a};
+   std::array<Key<DefaultTag>::ID, 1> tooShort {};
+   REQUIRE_THROWS_AS(set.get_many(setKeys, tooShort), std::invalid_argument);
+   std::array<Key<DefaultTag>::ID, 2> indices {};
+   set.get_many(setKeys, indices);
+   REQUIRE(indices == std::array<Key<DefaultTag>::ID, 2> {1, 0});
+}
+
+TEST_CASE("SplitSlotMap keeps hot fields in step with values", "[SlotMap][split]") {
+   using namespace tr;
+   struct body {
+      float x;
+      std::string name;
+   };
+   auto project = [](const body &b) { return b.x; };
+   SplitSlotMap<Key<DefaultTag>, body, decltype(project)> map(project);
+
+   const auto a = map.insert({1.0F, "a"});
+   const auto b = map.insert({2.0F, "b"});
+   const auto c = map.insert({3.0F, "c"});
+   REQUIRE(map.size() == 3);
+   REQUIRE(map.hot(b) == 2.0F);
+   REQUIRE(map.get(b).name == "b");
+
+   map.update(b, [](body &value) { value.x = 20.0F; });
+   REQUIRE(map.hot(b) == 20.0F);
+   REQUIRE(map.get(b).x == 20.0F);
+
+   REQUIRE_THROWS(map.update(c, [](body &value) {
+      value.x = 30.0F;
+      throw std::runtime_error("fail");
+   }));
+   REQUIRE(map.hot(c) == 30.0F);
+
+   REQUIRE(map.remove(a).name == "a");
+   REQUIRE_THROWS_AS(map.remove(a), std::runtime_error);
+   REQUIRE_FALSE(map.contains(a));
+   REQUIRE(map.hot(c) == 30.0F);
+   REQUIRE(map.get(c).name == "c");
+   REQUIRE(std::ranges::equal(map.hot_data(), std::vector<float> {30.0F, 20.0F}));
+
+   std::array<Key<DefaultTag>, 2> keys {b, c};
+   std::vector<float> hot;
+   map.get_hot_many(keys, std::back_inserter(hot));
+   REQUIRE(hot == std::vector<float> {20.0F, 30.0F});
+   std::vector<body> values;
+   map.get_many(keys, std::back_inserter(values));
+   REQUIRE(values[1].name == "c");
+
+   map.clear();
+   REQUIRE(map.size() == 0);
+   REQUIRE(map.hot_data().empty());
+}
+
+TEST_CASE("try_get, find and try_remove report missing keys", "[SlotMap][nothrow]") {
+   using namespace tr;
+   SparseSet<> set;
+   const auto a = set.insert();
+   const auto b = set.insert();
+   static_assert(noexcept(set.try_get(a)));
+   REQUIRE(set.try_get(b) == 1U);
+   (void)set.erase(a);
+   REQUIRE_FALSE(set.try_get(a).has_value());
+   REQUIRE(set.try_get(b) == 0U);
+
+   SlotMap<Key<DefaultTag>, std::string> map;
+   const auto x = map.insert(std::string("x"));
+   const auto y = map.insert(std::string("y"));
+   static_assert(noexcept(map.find(x)));
+   REQUIRE(map.find(x) != nullptr);
+   *map.find(x) = "xx";
+   REQUIRE(std::as_const(map).find(x)->size() == 2);
+
+   REQUIRE(map.try_remove(x) == "xx");
+   REQUIRE(map.find(x) == nullptr);
+   REQUIRE_FALSE(map.try_remove(x).has_value());
+   REQUIRE(map.get(y) == "y");
+   REQUIRE(map.size() == 1);
+
+   auto project = [](const std::string &s) { return s.size(); };
+   SplitSlotMap<Key<DefaultTag>, std::string, decltype(project)> split(project);
+   const auto z = split.insert("zzz");
+   REQUIRE(*split.find_hot(z) == 3);
+   REQUIRE(*split.find(z) == "zzz");
+   (void)split.remove(z);
+   REQUIRE(split.find(z) == nullptr);
+   REQUIRE(split.find_hot(z) == nullptr);
+}
+
+// NOLINTEND
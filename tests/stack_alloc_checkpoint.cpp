@@ -1,8 +1,11 @@
 // NOLINTBEGIN
 
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
 #include <cstring>
 #include <memory_resource>
+#include <thread>
+#include <vector>
 
 #include "trutils/stack_alloc.hpp"
 
@@ -150,4 +153,154 @@ TEST_CASE("StackAlloc do_is_equal identity", "[stack_alloc][pmr]") {
    REQUIRE_FALSE(a.is_equal(b));
 }
 
+TEST_CASE("StackAlloc reset reuses its blocks", "[stack_alloc][reset]") {
+   constexpr size_t kBlock = 256;
+   constexpr size_t kChunk = (kBlock - 2 * sizeof(size_t)) / 2;
+   const auto align = alignof(std::max_align_t);
+   StackAlloc<kBlock> sa;
+
+   std::vector<void *> first;
+   for (int i = 0; i < 8; ++i) { first.push_back(sa.allocate(kChunk, align)); }
+
+   for (int frame = 0; frame < 3; ++frame) {
+      sa.reset();
+      for (size_t i = 0; i < first.size(); ++i) {
+         void *p = sa.allocate(kChunk, align);
+         REQUIRE(p == first[i]);
+         std::memset(p, static_cast<int>(i), kChunk);
+      }
+   }
+
+   {
+      StackAllocCheckpoint cp(sa);
+      REQUIRE(sa.allocate(kChunk, align) != nullptr);
+   }
+}
+
+TEST_CASE("StackAlloc serves oversized requests from large blocks", "[stack_alloc][large]") {
+   StackAlloc<256> sa;
+   auto *small = static_cast<unsigned char *>(sa.allocate(16, 8));
+   std::memset(small, 0x11, 16);
+
+   void *blockPtr = nullptr;
+   {
+      StackAllocCheckpoint cp(sa);
+      auto *big = static_cast<unsigned char *>(sa.allocate(10000, 64));
+      REQUIRE(reinterpret_cast<uintptr_t>(big) % 64 == 0);
+      std::memset(big, 0x22, 10000);
+
+      blockPtr = sa.allocate(16, 8);
+      REQUIRE(blockPtr == small + 16);
+      REQUIRE(big[9999] == 0x22);
+
+      // May land inside the current block if it happens to span a 4096-byte boundary, so it comes
+      // after the placement checks above.
+      auto *aligned = sa.allocate(8, 4096);
+      REQUIRE(reinterpret_cast<uintptr_t>(aligned) % 4096 == 0);
+   }
+   REQUIRE(small[15] == 0x11);
+   REQUIRE(sa.allocate(16, 8) == blockPtr);
+
+   auto span = sa.allocArr<int>(5000, 7);
+   REQUIRE(span[4999] == 7);
+   sa.reset();
+}
+
+TEST_CASE("scratch gives each thread its own arena", "[stack_alloc][scratch]") {
+   StackAlloc<> *mainArena = &scratch();
+   REQUIRE(&scratch() == mainArena);
+
+   StackAlloc<> *workerArena = nullptr;
+   std::thread worker([&] {
+      StackAllocCheckpoint scope(scratch());
+      std::pmr::vector<int> values(&scratch());
+      for (int i = 0; i < 1000; ++i) { values.push_back(i); }
+      REQUIRE(values.back() == 999);
+      workerArena = &scratch();
+   });
+   worker.join();
+   REQUIRE(workerArena != mainArena);
+
+   StackAllocCheckpoint scope(scratch());
+   void *p = scratch().allocate(32, 8);
+   REQUIRE(p != nullptr);
+}
+
+#if TR_STACK_ALLOC_STATS
+TEST_CASE("StackAlloc stats track usage, waste and scope peaks", "[stack_alloc][stats]") {
+   constexpr size_t kBlock = 256;
+   constexpr size_t kUsable = kBlock - 2 * sizeof(size_t);
+   StackAlloc<kBlock> sa;
+
+   (void)sa.allocate(1, 1);
+   (void)sa.allocate(8, 8); // 7 bytes of padding
+   auto stats = sa.stats();
+   REQUIRE(stats.allocations == 2);
+   REQUIRE(stats.bytesInUse == 9);
+   REQUIRE(stats.paddingBytes == 7);
+   REQUIRE(stats.blockCount == 1);
+
+   // Everything allocated in the scope below, plus the second block's tail.
+   const size_t scopePeak = (kUsable - 16) + 64 + (kUsable - 64) + (kUsable - 8) + 1000;
+   {
+      StackAllocCheckpoint cp(sa);
+      (void)sa.allocate(kUsable - 16, 8); // fills the first block exactly
+      (void)sa.allocate(64, 8);           // spills into a second block
+      REQUIRE(sa.stats().blockCount == 2);
+      REQUIRE(sa.stats().blockTailBytes == 0);
+      (void)sa.allocate(kUsable - 8, 8); // leaves a tail in the second block
+      REQUIRE(sa.stats().blockTailBytes == kUsable - 64);
+
+      {
+         StackAllocCheckpoint inner(sa);
+         (void)sa.allocate(1000, 8); // large block
+         REQUIRE(sa.stats().largeBlockCount == 1);
+         REQUIRE(inner.peak_bytes() == 1000);
+      }
+      REQUIRE(sa.stats().largeBlockCount == 0);
+      REQUIRE(cp.peak_bytes() == scopePeak);
+   }
+
+   stats = sa.stats();
+   REQUIRE(stats.bytesInUse == 9);
+   REQUIRE(stats.paddingBytes == 7);
+   REQUIRE(stats.blockTailBytes == 0);
+   REQUIRE(stats.blockCount == 3);
+   REQUIRE(stats.allocations == 6);
+   REQUIRE(stats.highWaterMark == 16 + scopePeak);
+
+   struct capture {
+      std::vector<stack_alloc_stats> frames;
+   } seen;
+   sa.set_stats_hook(
+       [](const stack_alloc_stats &frame, void *user) {
+          static_cast<capture *>(user)->frames.push_back(frame);
+       },
+       &seen);
+   sa.reset();
+   (void)sa.allocate(4, 4);
+   sa.reset();
+   REQUIRE(seen.frames.size() == 2);
+   REQUIRE(seen.frames[0].frameAllocations == 6);
+   REQUIRE(seen.frames[1].frameAllocations == 1);
+   REQUIRE(seen.frames[1].frames == 1);
+   REQUIRE(sa.stats().bytesInUse == 0);
+   REQUIRE(sa.stats().allocations == 7);
+}
+#else
+TEST_CASE("StackAlloc stats are zero when compiled out", "[stack_alloc][stats]") {
+   StackAlloc<> sa;
+   (void)sa.allocate(64, 8);
+   StackAllocCheckpoint cp(sa);
+   REQUIRE(sa.stats().allocations == 0);
+   REQUIRE(cp.peak_bytes() == 0);
+
+   bool called = false;
+   sa.set_stats_hook(
+       [](const stack_alloc_stats &, void *user) { *static_cast<bool *>(user) = true; }, &called);
+   sa.reset();
+   REQUIRE_FALSE(called);
+}
+#endif
+
 // NOLINTEND
@@ -0,0 +1,82 @@
+// NOLINTBEGIN
+
+#include "trutils/execution.hpp"
+#include "trutils/static_table.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <execution>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+struct Position {
+   float x {};
+   float y {};
+};
+
+using physics_table = static_table<column_tag, int, double, Position>;
+
+} // namespace
+
+TEST_CASE("static_table exposes its fixed schema", "[static_table]") {
+   static_assert(physics_table::row_count() == 3);
+   static_assert(physics_table::contains_row<Position>());
+   static_assert(!physics_table::contains_row<float>());
+
+   physics_table t;
+   REQUIRE(t.column_count() == 0);
+   REQUIRE(t.get_row<int>().empty());
+}
+
+TEST_CASE("static_table cell and query_column", "[static_table]") {
+   physics_table t;
+   const auto k0 = t.insert_column();
+   const auto k1 = t.insert_column();
+   t.cell<int>(k0) = 3;
+   t.cell<Position>(k1).y = 2.0F;
+
+   auto [i, p] = t.query_column<int, Position>(k1);
+   REQUIRE(i == 0);
+   REQUIRE(p.y == 2.0F);
+   i = 9;
+   REQUIRE(t.cell<int>(k1) == 9);
+   REQUIRE(t.get_row<int>().size() == 2);
+
+   REQUIRE(t.erase_column(k0));
+   REQUIRE_FALSE(t.contains_column(k0));
+   REQUIRE(t.cell<int>(k1) == 9);
+   REQUIRE_THROWS_AS(t.cell<int>(k0), std::out_of_range);
+}
+
+TEST_CASE("static_table shares row_view, columns_iter and query with table", "[static_table]") {
+   physics_table t;
+   std::vector<physics_table::column_key> keys;
+   t.insert_columns(5, std::back_inserter(keys));
+
+   table<>::row_view<double> rv = t.get_row_view<double>();
+   for (size_t i = 0; i < keys.size(); ++i) { rv.at(keys[i]) = static_cast<double>(i); }
+
+   REQUIRE(t.erase_columns(std::vector {keys[0], keys[4]}) == 2);
+   size_t visited = 0;
+   for (auto it = t.columns_begin<double, int>(); it != t.columns_end<double, int>(); ++it) {
+      auto [key, cells] = *it;
+      REQUIRE(std::get<0>(cells) == rv.at(key));
+      ++visited;
+   }
+   REQUIRE(visited == 3);
+
+   t.query<double, int>().for_each([](double d, int &i) { i = static_cast<int>(d) * 2; });
+   const physics_table &ct = t;
+   int sum = 0;
+   ct.for_each_parallel<int>(policy_executor(std::execution::seq), 16, [&](auto chunk) {
+      for (const int v : chunk.template get<int>()) { sum += v; }
+   });
+   REQUIRE(sum == (1 + 2 + 3) * 2);
+}
+
+// NOLINTEND
@@ -1,10 +1,23 @@
 // NOLINTBEGIN
 
+#include "trutils/execution.hpp"
 #include "trutils/table.hpp"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <sstream>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <stdexcept>
+#include <thread>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 using namespace tr;
 
@@ -273,4 +286,1029 @@ TEST_CASE("columns_begin empty range when no columns", "[table][columns_iter]")
    REQUIRE(t.columns_begin<int>() == t.columns_end<int>());
 }
 
+TEST_CASE("insert_columns appends default cells to every row", "[table][insert_columns]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   const auto k0 = t.insert_column();
+   t.cell<int>(k0) = 5;
+
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(3, std::back_inserter(keys));
+   REQUIRE(keys.size() == 3);
+   REQUIRE(t.column_count() == 4);
+   REQUIRE(t.get_row<int>().size() == 4);
+   REQUIRE(t.get_row<Foo>().size() == 4);
+   REQUIRE(t.cell<int>(k0) == 5);
+
+   for (size_t i = 0; i < keys.size(); ++i) {
+      REQUIRE((*std::next(t.columns_begin<int>(), static_cast<std::ptrdiff_t>(i + 1))).first ==
+              keys[i]);
+      REQUIRE(t.cell<int>(keys[i]) == 0);
+      REQUIRE(t.cell<Foo>(keys[i]).x == 0);
+   }
+}
+
+TEST_CASE("repeated insert_columns grows capacity geometrically", "[table][insert_columns]") {
+   table<> t;
+   t.create_row<int>();
+   std::vector<table<>::column_key> keys;
+   size_t growths = 0;
+   for (int i = 0; i < 100; ++i) {
+      const size_t capacity = t.column_capacity();
+      t.insert_columns(2, std::back_inserter(keys));
+      growths += t.column_capacity() != capacity ? 1 : 0;
+   }
+   REQUIRE(t.column_count() == 200);
+   // Reserving exactly size + count would reallocate the column mapping on every batch.
+   REQUIRE(growths <= 10);
+}
+
+TEST_CASE("erase_columns matches sequential erase_column", "[table][erase_columns]") {
+   table<> batched;
+   table<> sequential;
+   for (auto *t : {&batched, &sequential}) { t->create_row<int>(); }
+
+   std::vector<table<>::column_key> keys;
+   batched.insert_columns(8, std::back_inserter(keys));
+   std::vector<table<>::column_key> seqKeys;
+   sequential.insert_columns(8, std::back_inserter(seqKeys));
+   for (size_t i = 0; i < keys.size(); ++i) {
+      batched.cell<int>(keys[i]) = static_cast<int>(i);
+      sequential.cell<int>(seqKeys[i]) = static_cast<int>(i);
+   }
+
+   const std::vector<table<>::column_key> toErase {keys[1], keys[6], keys[1], keys[0],
+                                                   table<>::column_key {}};
+   REQUIRE(batched.erase_columns(toErase) == 3);
+   for (size_t idx : {1, 6, 0}) { REQUIRE(sequential.erase_column(seqKeys[idx])); }
+
+   REQUIRE(batched.column_count() == 5);
+   const auto lhs = batched.get_row<int>();
+   const auto rhs = sequential.get_row<int>();
+   REQUIRE(std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()));
+   for (size_t idx : {2, 3, 4, 5, 7}) {
+      REQUIRE(batched.cell<int>(keys[idx]) == static_cast<int>(idx));
+   }
+   REQUIRE_FALSE(batched.get_row_view<int>().contains(keys[6]));
+}
+
+TEST_CASE("reorder_columns permutes every row and keeps keys valid", "[table][reorder]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(5, std::back_inserter(keys));
+   for (size_t i = 0; i < keys.size(); ++i) {
+      t.cell<int>(keys[i]) = static_cast<int>(i);
+      t.cell<Foo>(keys[i]).x = static_cast<int>(i * 10);
+   }
+
+   const std::vector<size_t> order {3, 0, 4, 1, 2};
+   t.reorder_columns(order);
+   for (size_t k = 0; k < order.size(); ++k) {
+      REQUIRE(t.get_row<int>()[k] == static_cast<int>(order[k]));
+      REQUIRE(t.column_index(keys[order[k]]) == k);
+   }
+   for (size_t i = 0; i < keys.size(); ++i) {
+      REQUIRE(t.cell<int>(keys[i]) == static_cast<int>(i));
+      REQUIRE(t.cell<Foo>(keys[i]).x == static_cast<int>(i * 10));
+   }
+
+   const std::vector<size_t> repeated {0, 0, 1, 2, 3};
+   const std::vector<size_t> tooShort {0, 1};
+   REQUIRE_THROWS_AS(t.reorder_columns(repeated), std::invalid_argument);
+   REQUIRE_THROWS_AS(t.reorder_columns(tooShort), std::invalid_argument);
+   REQUIRE(t.get_row<int>()[0] == 3);
+}
+
+TEST_CASE("sort_columns orders dense storage by one row", "[table][reorder]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(64, std::back_inserter(keys));
+   for (size_t i = 0; i < keys.size(); ++i) {
+      t.cell<int>(keys[i]) = static_cast<int>((i * 37) % 16);
+      t.cell<Foo>(keys[i]).x = static_cast<int>(i);
+   }
+   // Churn the dense order.
+   for (size_t i = 0; i < keys.size(); i += 5) { REQUIRE(t.erase_column(keys[i])); }
+
+   SECTION("in one call") {
+      t.sort_columns<int>();
+      const auto row = t.get_row<int>();
+      REQUIRE(std::is_sorted(row.begin(), row.end()));
+   }
+
+   SECTION("descending") {
+      t.sort_columns<int>(std::greater<> {});
+      const auto row = t.get_row<int>();
+      REQUIRE(std::is_sorted(row.begin(), row.end(), std::greater<> {}));
+   }
+
+   SECTION("incrementally") {
+      size_t calls = 0;
+      while (!t.sort_columns_incremental<int>(4)) { ++calls; }
+      REQUIRE(calls > 1);
+      REQUIRE(calls <= t.column_count() / 4);
+      const auto row = t.get_row<int>();
+      REQUIRE(std::is_sorted(row.begin(), row.end()));
+      REQUIRE(t.sort_columns_incremental<int>(0));
+   }
+
+   for (size_t i = 0; i < keys.size(); ++i) {
+      if (i % 5 == 0) {
+         REQUIRE_FALSE(t.contains_column(keys[i]));
+         continue;
+      }
+      REQUIRE(t.cell<int>(keys[i]) == static_cast<int>((i * 37) % 16));
+      REQUIRE(t.cell<Foo>(keys[i]).x == static_cast<int>(i));
+   }
+}
+
+TEST_CASE("sort_columns_incremental resumes and restarts its pass", "[table][reorder]") {
+   table<> t;
+   t.create_row<int>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(64, std::back_inserter(keys));
+   for (size_t i = 0; i < keys.size(); ++i) {
+      t.cell<int>(keys[i]) = static_cast<int>(keys.size() - i);
+   }
+   auto sorted = [&] {
+      const auto row = t.get_row<int>();
+      return std::is_sorted(row.begin(), row.end());
+   };
+
+   SECTION("a column inserted mid-pass is sorted in too") {
+      REQUIRE_FALSE(t.sort_columns_incremental<int>(8));
+      const auto late = t.insert_column();
+      t.cell<int>(late) = -1;
+      while (!t.sort_columns_incremental<int>(8)) {}
+      REQUIRE(sorted());
+      REQUIRE(t.get_row<int>()[0] == -1);
+   }
+
+   SECTION("cells written mid-pass are picked up by the next pass") {
+      REQUIRE_FALSE(t.sort_columns_incremental<int>(8));
+      t.cell<int>(keys[0]) = 1000;
+      while (!t.sort_columns_incremental<int>(8)) {}
+      REQUIRE(sorted());
+      REQUIRE(t.get_row<int>().back() == 1000);
+   }
+
+   SECTION("switching comparator starts over") {
+      REQUIRE_FALSE(t.sort_columns_incremental<int>(8));
+      while (!t.sort_columns_incremental<int>(8, std::greater<> {})) {}
+      const auto row = t.get_row<int>();
+      REQUIRE(std::is_sorted(row.begin(), row.end(), std::greater<> {}));
+   }
+}
+
+TEST_CASE("dense_bitset follows dense array operations", "[table][dense_bitset]") {
+   dense_bitset bits(130);
+   bits.set(1);
+   bits.set(64, 66);
+   REQUIRE(bits.count() == 67);
+   REQUIRE_FALSE(bits.test(63));
+   REQUIRE(bits.test(129));
+
+   bits.swap_and_pop(1); // bit 129 moves to 1
+   REQUIRE(bits.size() == 129);
+   REQUIRE(bits.test(1));
+   REQUIRE(bits.count() == 66);
+
+   bits.swap(1, 2);
+   REQUIRE_FALSE(bits.test(1));
+   REQUIRE(bits.test(2));
+
+   const std::vector<size_t> order {64, 0, 2};
+   bits.gather(order);
+   REQUIRE(bits.size() == 3);
+   std::vector<size_t> set;
+   bits.for_each_set([&](size_t idx) { set.push_back(idx); });
+   REQUIRE(set == std::vector<size_t> {0, 2});
+
+   bits.resize(200, true);
+   bits.resize(70);
+   REQUIRE(bits.count() == 69);
+   REQUIRE(bits.words().back() == (uint64_t {1} << 6) - 1);
+   REQUIRE_THROWS_AS(bits.set(60, 11), std::out_of_range);
+}
+
+TEST_CASE("dirty tracking records cell writes per row", "[table][dirty]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(100, std::back_inserter(keys));
+   REQUIRE_THROWS_AS(t.track_dirty<double>(), std::out_of_range);
+   REQUIRE_THROWS_AS(t.for_each_dirty<int>([](const int &) {}), std::out_of_range);
+
+   t.track_dirty<int>();
+   REQUIRE(t.is_dirty_tracked<int>());
+   REQUIRE_FALSE(t.is_dirty_tracked<Foo>());
+   REQUIRE_FALSE(t.is_dirty<int>(keys[0]));
+
+   t.cell<int>(keys[3]) = 3;
+   t.get_row_view<int>().at(keys[70]) = 70;
+   std::get<0>(t.query_column<int, Foo>(keys[90])) = 90;
+   t.cell<Foo>(keys[4]).x = 4; // untracked row
+   t.get_row<int>()[10] = 10;
+   t.mark_dirty<int>(10, 1);
+
+   std::vector<std::pair<table<>::column_key, int>> dirty;
+   t.for_each_dirty<int>([&](table<>::column_key key, const int &value) {
+      dirty.emplace_back(key, value);
+   });
+   REQUIRE(dirty == std::vector<std::pair<table<>::column_key, int>> {
+                        {keys[3], 3}, {keys[10], 10}, {keys[70], 70}, {keys[90], 90}});
+
+   // The bits move with their columns.
+   REQUIRE(t.erase_column(keys[3]));
+   REQUIRE_FALSE(t.is_dirty<int>(keys[99]));
+   REQUIRE(t.is_dirty<int>(keys[70]));
+   t.sort_columns<int>();
+   REQUIRE(t.is_dirty<int>(keys[70]));
+   REQUIRE(t.is_dirty<int>(keys[90]));
+   REQUIRE_FALSE(t.is_dirty<int>(keys[50]));
+
+   t.clear_dirty<int>();
+   int count = 0;
+   t.for_each_dirty<int>([&](const int &) { ++count; });
+   REQUIRE(count == 0);
+
+   // New columns start dirty.
+   const auto added = t.insert_column();
+   REQUIRE(t.is_dirty<int>(added));
+   REQUIRE_FALSE(t.is_dirty<int>(keys[70]));
+
+   REQUIRE(t.erase_row<int>());
+   REQUIRE_FALSE(t.is_dirty_tracked<int>());
+}
+
+TEST_CASE("column iterators leave dirty bits alone", "[table][dirty]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(8, std::back_inserter(keys));
+   t.track_dirty<int>();
+   t.track_dirty<Foo>();
+
+   int sum = 0;
+   for (auto it = t.columns_begin<int, Foo>(); it != t.columns_end<int, Foo>(); ++it) {
+      const auto &[value, foo] = (*it).second;
+      sum += value + foo.x;
+   }
+   REQUIRE(sum == 0);
+   for (const auto key : keys) {
+      REQUIRE_FALSE(t.is_dirty<int>(key));
+      REQUIRE_FALSE(t.is_dirty<Foo>(key));
+   }
+}
+
+TEST_CASE("sparse rows hold cells only for some columns", "[table][sparse_row]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo, sparse_storage>();
+   REQUIRE(t.contains_row<Foo>());
+   REQUIRE(t.is_sparse_row<Foo>());
+   REQUIRE_FALSE(t.is_sparse_row<int>());
+   REQUIRE(t.row_count() == 2);
+   REQUIRE_THROWS_AS(t.create_row<Foo>(), std::invalid_argument);
+   REQUIRE_THROWS_AS((t.create_row<int, sparse_storage>()), std::invalid_argument);
+
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(100, std::back_inserter(keys));
+   REQUIRE(t.cell_count<int>() == 100);
+   REQUIRE(t.cell_count<Foo>() == 0);
+
+   for (size_t i = 0; i < keys.size(); i += 10) {
+      t.cell<int>(keys[i]) = static_cast<int>(i);
+      REQUIRE(t.add_cell<Foo>(keys[i], Foo {static_cast<int>(i * 2)}).x == static_cast<int>(i * 2));
+   }
+   REQUIRE(t.cell_count<Foo>() == 10);
+   REQUIRE_THROWS_AS(t.add_cell<Foo>(keys[0]), std::invalid_argument);
+   REQUIRE_THROWS_AS(t.add_cell<int>(keys[1]), std::out_of_range);
+   REQUIRE(t.has_cell<Foo>(keys[10]));
+   REQUIRE_FALSE(t.has_cell<Foo>(keys[11]));
+   REQUIRE(t.has_cell<int>(keys[11]));
+   REQUIRE_FALSE(t.has_cell<double>(keys[11]));
+
+   REQUIRE(t.cell<Foo>(keys[30]).x == 60);
+   REQUIRE(std::as_const(t).unchecked_cell<Foo>(keys[30]).x == 60);
+   REQUIRE_THROWS_AS(t.cell<Foo>(keys[31]), std::out_of_range);
+   auto [value, foo] = t.query_column<int, Foo>(keys[40]);
+   REQUIRE(value == 40);
+   REQUIRE(foo.x == 80);
+
+   // Erasing a column drops its sparse cell; removing the cell keeps the column.
+   REQUIRE(t.erase_column(keys[20]));
+   REQUIRE(t.remove_cell<Foo>(keys[50]));
+   REQUIRE_FALSE(t.remove_cell<Foo>(keys[50]));
+   REQUIRE(t.contains_column(keys[50]));
+   REQUIRE(t.cell_count<Foo>() == 8);
+   REQUIRE(t.cell<Foo>(keys[90]).x == 180);
+
+   // Joining is driven by the sparse row, in any order of the row types.
+   std::vector<int> visited;
+   t.for_each_with<int, Foo>([&](table<>::column_key key, int &cell, Foo &other) {
+      REQUIRE(t.cell<Foo>(key).x == other.x);
+      REQUIRE(other.x == cell * 2);
+      visited.push_back(cell);
+   });
+   std::sort(visited.begin(), visited.end());
+   REQUIRE(visited == std::vector<int> {0, 10, 30, 40, 60, 70, 80, 90});
+
+   int count = 0;
+   std::as_const(t).for_each_with<Foo, int>([&](const Foo &, const int &) { ++count; });
+   REQUIRE(count == 8);
+   count = 0;
+   t.for_each_with<int>([&](int &) { ++count; });
+   REQUIRE(count == 99);
+
+   REQUIRE_THROWS_AS(t.get_row<Foo>(), std::out_of_range);
+   std::ostringstream out;
+   REQUIRE_THROWS_AS(t.serialize(out), std::runtime_error);
+
+   REQUIRE(t.erase_row<Foo>());
+   REQUIRE_FALSE(t.contains_row<Foo>());
+   REQUIRE_FALSE(t.has_cell<Foo>(keys[10]));
+}
+
+TEST_CASE("for_each_with intersects several sparse rows", "[table][sparse_row]") {
+   table<> t;
+   t.create_row<int, sparse_storage>();
+   t.create_row<Foo, sparse_storage>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(30, std::back_inserter(keys));
+   for (size_t i = 0; i < keys.size(); i += 2) { t.add_cell<int>(keys[i], static_cast<int>(i)); }
+   for (size_t i = 0; i < keys.size(); i += 3) { t.add_cell<Foo>(keys[i]); }
+
+   std::vector<int> visited;
+   t.for_each_with<int, Foo>([&](int &cell, Foo &) { visited.push_back(cell); });
+   std::sort(visited.begin(), visited.end());
+   REQUIRE(visited == std::vector<int> {0, 6, 12, 18, 24});
+}
+
+TEST_CASE("query iterates keys and cells in dense order", "[table][query]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<double>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(4, std::back_inserter(keys));
+   for (size_t i = 0; i < keys.size(); ++i) {
+      t.cell<int>(keys[i]) = static_cast<int>(i);
+      t.cell<double>(keys[i]) = static_cast<double>(i) * 0.5;
+   }
+   REQUIRE(t.erase_column(keys[1]));
+
+   auto q = t.query<double, int>();
+   REQUIRE(q.size() == 3);
+   size_t visited = 0;
+   for (auto [key, d, i] : q) {
+      REQUIRE(t.cell<int>(key) == i);
+      REQUIRE(d == static_cast<double>(i) * 0.5);
+      d = -1.0;
+      ++visited;
+   }
+   REQUIRE(visited == 3);
+   for (const double d : t.get_row<double>()) { REQUIRE(d == -1.0); }
+}
+
+TEST_CASE("query for_each with and without keys", "[table][query]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(5, std::back_inserter(keys));
+
+   t.query<int, Foo>().for_each([](int &i, Foo &f) {
+      i += 2;
+      f.x = i * 10;
+   });
+   t.query<int>().for_each([&](table<>::column_key key, int &i) {
+      REQUIRE(t.cell<Foo>(key).x == i * 10);
+   });
+
+   const table<> &ct = t;
+   int sum = 0;
+   ct.query<Foo>().for_each([&](const Foo &f) { sum += f.x; });
+   REQUIRE(sum == 100);
+}
+
+TEST_CASE("query throws when a requested row type is missing", "[table][query]") {
+   table<> t;
+   t.create_row<int>();
+   REQUIRE_THROWS_AS((t.query<int, double>()), std::out_of_range);
+   REQUIRE(t.query<int>().empty());
+}
+
+TEST_CASE("query chunks cover every column once with line-aligned sizes", "[table][parallel]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<double>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(100, std::back_inserter(keys));
+
+   auto q = t.query<int, double>();
+   const size_t chunkSize = decltype(q)::aligned_chunk_size(10);
+   REQUIRE(chunkSize == 16);
+   REQUIRE(q.chunk_count(10) == 7);
+
+   size_t covered = 0;
+   for (size_t c = 0; c < q.chunk_count(10); ++c) {
+      auto chunk = q.chunk_at(c, 10);
+      REQUIRE(chunk.offset == covered);
+      REQUIRE(chunk.get<int>().size() == chunk.size);
+      REQUIRE(chunk.key(0) == keys[chunk.offset]);
+      // No two chunks share a cache line in either row.
+      REQUIRE(reinterpret_cast<std::uintptr_t>(chunk.get<int>().data()) % CACHE_LINE_SIZE == 0);
+      REQUIRE(reinterpret_cast<std::uintptr_t>(chunk.get<double>().data()) % CACHE_LINE_SIZE ==
+              0);
+      covered += chunk.size;
+   }
+   REQUIRE(covered == 100);
+   REQUIRE_THROWS_AS(q.chunk_at(7, 10), std::out_of_range);
+}
+
+TEST_CASE("for_each_parallel runs every chunk on a custom executor", "[table][parallel]") {
+   table<> t;
+   t.create_row<int>();
+   t.create_row<Foo>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(1000, std::back_inserter(keys));
+
+   auto threadExecutor = [](size_t count, auto &&task) {
+      std::vector<std::thread> workers;
+      for (size_t i = 0; i < count; ++i) { workers.emplace_back([&task, i] { task(i); }); }
+      for (auto &worker : workers) { worker.join(); }
+   };
+   t.for_each_parallel<int, Foo>(threadExecutor, 128, [](auto chunk) {
+      auto ints = chunk.template get<int>();
+      auto foos = chunk.template get<Foo>();
+      for (size_t i = 0; i < chunk.size; ++i) {
+         ints[i] = static_cast<int>(chunk.offset + i);
+         foos[i].x = ints[i] * 2;
+      }
+   });
+
+   for (size_t i = 0; i < keys.size(); ++i) {
+      REQUIRE(t.cell<int>(keys[i]) == static_cast<int>(i));
+      REQUIRE(t.cell<Foo>(keys[i]).x == static_cast<int>(i) * 2);
+   }
+
+   const table<> &ct = t;
+   long long sum = 0;
+   ct.for_each_parallel<int>(policy_executor(std::execution::seq), 100, [&](auto chunk) {
+      for (const int v : chunk.template get<int>()) { sum += v; }
+   });
+   REQUIRE(sum == 999LL * 1000LL / 2LL);
+}
+
+TEST_CASE("unchecked_cell matches cell for live columns", "[table][unchecked]") {
+   table<> t;
+   t.create_row<int>();
+   const auto k0 = t.insert_column();
+   const auto k1 = t.insert_column();
+   t.unchecked_cell<int>(k1) = 5;
+   REQUIRE(t.cell<int>(k1) == 5);
+   REQUIRE(&t.unchecked_cell<int>(k0) == &t.cell<int>(k0));
+
+   const table<> &ct = t;
+   REQUIRE(ct.unchecked_cell<int>(k1) == 5);
+   REQUIRE_THROWS_AS(t.unchecked_cell<double>(k0), std::out_of_range);
+#if TR_DEBUG_CHECKS
+   REQUIRE(t.erase_column(k0));
+   REQUIRE_THROWS_AS(t.unchecked_cell<int>(k0), std::out_of_range);
+#endif
+}
+
+TEST_CASE("create_row allocates from the given memory resource", "[table][pmr]") {
+   std::pmr::monotonic_buffer_resource resource;
+   table<> t;
+   t.create_row<int>(&resource);
+   t.create_row<double>();
+   std::vector<table<>::column_key> keys;
+   t.insert_columns(64, std::back_inserter(keys));
+   t.cell<int>(keys[63]) = 4;
+   REQUIRE(t.cell<int>(keys[63]) == 4);
+   REQUIRE(t.get_row<int>().size() == 64);
+}
+
+namespace {
+
+struct snapshot_file {
+   std::filesystem::path path;
+
+   explicit snapshot_file(const char *name) :
+       path(std::filesystem::temp_directory_path() / name) {}
+   ~snapshot_file() { std::filesystem::remove(path); }
+};
+
+struct Vec3 {
+   float x {}, y {}, z {};
+};
+
+struct other_column_tag {};
+
+} // namespace
+
+TEST_CASE("map_readonly round-trips a serialized table", "[table][snapshot]") {
+   snapshot_file file("trutils_table_roundtrip.snapshot");
+   std::vector<table<>::column_key> keys;
+   {
+      table<> t;
+      t.create_row<int>();
+      t.create_row<Vec3>();
+      t.create_row<double>();
+      t.insert_columns(6, std::back_inserter(keys));
+      REQUIRE(t.erase_column(keys[2]));
+      keys.erase(keys.begin() + 2);
+      for (size_t i = 0; i < keys.size(); ++i) {
+         t.cell<int>(keys[i]) = static_cast<int>(i);
+         t.cell<Vec3>(keys[i]) = Vec3 {1.0f * i, 2.0f * i, 3.0f * i};
+         t.cell<double>(keys[i]) = 0.5 * static_cast<double>(i);
+      }
+      t.serialize(file.path);
+   }
+
+   table<> mapped = table<>::map_readonly(file.path);
+   REQUIRE(mapped.column_count() == keys.size());
+   REQUIRE(mapped.row_count() == 3);
+   for (size_t i = 0; i < keys.size(); ++i) {
+      REQUIRE(mapped.contains_column(keys[i]));
+      REQUIRE(mapped.cell<int>(keys[i]) == static_cast<int>(i));
+      REQUIRE(mapped.cell<Vec3>(keys[i]).z == 3.0f * i);
+      REQUIRE(mapped.get_row_view<double>().at(keys[i]) == 0.5 * static_cast<double>(i));
+   }
+
+   // Cell writes stay private to the process; structural changes copy rows out of the mapping.
+   mapped.cell<int>(keys[0]) = 42;
+   const auto added = mapped.insert_column();
+   REQUIRE(mapped.cell<int>(added) == 0);
+   REQUIRE(mapped.cell<Vec3>(added).x == 0.0f);
+   REQUIRE(mapped.cell<int>(keys[0]) == 42);
+   REQUIRE(mapped.cell<double>(keys[4]) == 2.0);
+
+   const table<> reopened = table<>::map_readonly(file.path);
+   REQUIRE(reopened.cell<int>(keys[0]) == 0);
+   REQUIRE(reopened.column_count() == keys.size());
+}
+
+TEST_CASE("map_readonly snapshot keeps the column freelist", "[table][snapshot]") {
+   snapshot_file file("trutils_table_freelist.snapshot");
+   table<> t;
+   t.create_row<int>();
+   const auto a = t.insert_column();
+   const auto b = t.insert_column();
+   t.erase_column(a);
+   t.serialize(file.path);
+
+   table<> mapped = table<>::map_readonly(file.path);
+   const auto reused = t.insert_column();
+   const auto mappedReused = mapped.insert_column();
+   REQUIRE(reused == mappedReused);
+   REQUIRE_FALSE(mapped.contains_column(a));
+   REQUIRE(mapped.contains_column(b));
+}
+
+TEST_CASE("map_readonly rejects invalid snapshots", "[table][snapshot]") {
+   snapshot_file file("trutils_table_invalid.snapshot");
+   {
+      std::ofstream out(file.path, std::ios::binary);
+      out << "definitely not a table snapshot";
+   }
+   REQUIRE_THROWS_AS(table<>::map_readonly(file.path), std::runtime_error);
+
+   table<> t;
+   t.create_row<int>();
+   (void)t.insert_column();
+   t.serialize(file.path);
+   REQUIRE_THROWS_AS(table<other_column_tag>::map_readonly(file.path), std::runtime_error);
+
+   std::filesystem::resize_file(file.path, std::filesystem::file_size(file.path) - 1);
+   REQUIRE_THROWS_AS(table<>::map_readonly(file.path), std::runtime_error);
+
+   REQUIRE_THROWS_AS(table<>::map_readonly(file.path.string() + ".missing"), std::runtime_error);
+}
+
+TEST_CASE("table row operations by ty_id", "[table][kernels]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   (void)tab.create_row<float>();
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(4, std::back_inserter(keys));
+   tab.track_dirty<int>();
+
+   size_t rows = 0;
+   tab.for_each_row([&](const untyped_vector &row) {
+      ++rows;
+      REQUIRE(row.size() == 4);
+   });
+   REQUIRE(rows == 2);
+
+   const int nine = 9;
+   tab.fill_row(getTypeID<int>(), &nine);
+   REQUIRE(tab.cell<int>(keys[2]) == 9);
+   REQUIRE(tab.is_dirty<int>(keys[3]));
+
+   table<> replica;
+   (void)replica.create_row<int>();
+   std::vector<table<>::column_key> replicaKeys;
+   replica.insert_columns(4, std::back_inserter(replicaKeys));
+   REQUIRE(replica.hash_row(getTypeID<int>()) != tab.hash_row(getTypeID<int>()));
+   replica.assign_row(getTypeID<int>(), tab.get_row_untyped(getTypeID<int>()));
+   REQUIRE(replica.hash_row(getTypeID<int>()) == tab.hash_row(getTypeID<int>()));
+   REQUIRE(replica.get_row_untyped(getTypeID<int>()).mismatch(
+               tab.get_row_untyped(getTypeID<int>())) == 4);
+
+   REQUIRE_THROWS_AS(tab.get_row_untyped(getTypeID<double>()), std::out_of_range);
+   REQUIRE_THROWS_AS(tab.fill_row(getTypeID<double>(), &nine), std::out_of_range);
+   REQUIRE_THROWS_AS(replica.assign_row(getTypeID<int>(), tab.get_row_untyped(getTypeID<float>())),
+                     std::runtime_error);
+   (void)replica.insert_column();
+   REQUIRE_THROWS_AS(replica.assign_row(getTypeID<int>(), tab.get_row_untyped(getTypeID<int>())),
+                     std::invalid_argument);
+}
+
+TEST_CASE("row_hash follows writes through the tracked paths", "[table][hash]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(3000, std::back_inserter(keys));
+   REQUIRE_THROWS_AS(tab.row_hash<int>(), std::out_of_range);
+   tab.track_hashes<int>();
+   REQUIRE(tab.is_hash_tracked<int>());
+   REQUIRE(tab.chunk_hashes<int>().size() == 3);
+
+   const uint64_t initial = tab.row_hash<int>();
+   const std::vector<uint64_t> before(tab.chunk_hashes<int>().begin(),
+                                      tab.chunk_hashes<int>().end());
+   tab.cell<int>(keys[1500]) = 7;
+   const auto after = tab.chunk_hashes<int>();
+   REQUIRE(after[0] == before[0]);
+   REQUIRE(after[1] != before[1]);
+   REQUIRE(after[2] == before[2]);
+   REQUIRE(tab.row_hash<int>() != initial);
+
+   tab.cell<int>(keys[1500]) = 0;
+   REQUIRE(tab.row_hash<int>() == initial);
+
+   tab.get_row<int>()[10] = 3;
+   REQUIRE(tab.row_hash<int>() == initial);
+   tab.mark_dirty<int>(10, 1);
+   REQUIRE(tab.row_hash<int>() != initial);
+   tab.get_row_view<int>().at(keys[10]) = 0;
+   REQUIRE(tab.row_hash<int>() == initial);
+
+   const auto key = tab.insert_column();
+   REQUIRE(tab.row_hash<int>() != initial);
+   tab.erase_column(key);
+   REQUIRE(tab.row_hash<int>() == initial);
+
+   tab.untrack_hashes<int>();
+   REQUIRE_FALSE(tab.is_hash_tracked<int>());
+}
+
+TEST_CASE("diff and write_chunk bring a replica in sync", "[table][hash]") {
+   table<> source;
+   table<> replica;
+   std::vector<table<>::column_key> keys;
+   for (table<> *tab : {&source, &replica}) {
+      (void)tab->create_row<int>();
+      (void)tab->create_row<float>();
+      keys.clear();
+      tab->insert_columns(5000, std::back_inserter(keys));
+      tab->track_hashes<int>();
+   }
+   REQUIRE(source.diff(replica).empty());
+
+   source.cell<int>(keys[4999]) = 5;
+   source.cell<int>(keys[10]) = 1;
+   replica.track_dirty<int>();
+
+   auto diffs = source.diff(replica);
+   REQUIRE(diffs.size() == 1);
+   REQUIRE(diffs[0].row == getTypeID<int>());
+   REQUIRE(diffs[0].cells_per_chunk == 1024);
+   REQUIRE(diffs[0].chunks == std::vector<size_t> {0, 4});
+   for (const size_t chunk : diffs[0].chunks) {
+      replica.write_chunk(diffs[0].row, chunk, source.chunk_bytes(diffs[0].row, chunk));
+   }
+   REQUIRE(source.diff(replica).empty());
+   REQUIRE(replica.row_hash<int>() == source.row_hash<int>());
+   REQUIRE(replica.cell<int>(keys[4999]) == 5);
+   REQUIRE(replica.is_dirty<int>(keys[5]));
+   REQUIRE_FALSE(replica.is_dirty<int>(keys[2000]));
+
+   // Untracked rows of the other side are hashed in full; missing chunks count as differing.
+   replica.untrack_hashes<int>();
+   REQUIRE(source.diff(replica).empty());
+   (void)replica.insert_column();
+   REQUIRE(source.diff(replica)[0].chunks == std::vector<size_t> {4});
+
+   REQUIRE_THROWS_AS(replica.chunk_bytes(getTypeID<int>(), 0), std::out_of_range);
+   REQUIRE_THROWS_AS(source.write_chunk(getTypeID<int>(), 5, {}), std::out_of_range);
+   REQUIRE_THROWS_AS(source.write_chunk(getTypeID<int>(), 0, {}), std::invalid_argument);
+}
+
+TEST_CASE("published frames keep their contents and layout until the next acquire",
+          "[table][buffered]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(3000, std::back_inserter(keys));
+   tab.cell<int>(keys[0]) = 1;
+   REQUIRE_THROWS_AS(tab.publish<int>(), std::out_of_range);
+   tab.buffer_row<int>();
+   REQUIRE(tab.is_row_buffered<int>());
+
+   auto reader = tab.reader<int>();
+   auto frame = reader.acquire();
+   REQUIRE(frame.version() == 0);
+   REQUIRE(frame.size() == 3000);
+   REQUIRE(frame.at(keys[0]) == 1);
+
+   tab.cell<int>(keys[0]) = 2;
+   tab.get_row_view<int>().at(keys[2999]) = 3;
+   REQUIRE(reader.acquire().at(keys[0]) == 1);
+   tab.publish<int>();
+   REQUIRE(frame.at(keys[0]) == 1);
+   frame = reader.acquire();
+   REQUIRE(frame.version() == 1);
+   REQUIRE(frame.at(keys[0]) == 2);
+   REQUIRE(frame.at(keys[2999]) == 3);
+
+   // Each copy catches up on the chunks written while it was not the back copy.
+   for (int i = 0; i < 4; ++i) {
+      tab.cell<int>(keys[static_cast<size_t>(i) * 1000 % 3000]) = 10 + i;
+      tab.publish<int>();
+      frame = reader.acquire();
+      REQUIRE(std::ranges::equal(frame.values(), tab.get_row<int>()));
+   }
+
+   tab.get_row<int>()[5] = 7;
+   tab.mark_dirty<int>(5, 1);
+   tab.publish<int>();
+   REQUIRE(reader.acquire().values()[5] == 7);
+
+   tab.erase_column(keys[0]);
+   const auto added = tab.insert_column();
+   tab.publish<int>();
+   frame = reader.acquire();
+   REQUIRE_FALSE(frame.contains(keys[0]));
+   REQUIRE(frame.contains(added));
+   REQUIRE(frame.at(keys[2999]) == 3);
+   REQUIRE(frame.index_of(keys[2999]) == 0);
+   REQUIRE(std::ranges::equal(frame.values(), tab.get_row<int>()));
+   REQUIRE_THROWS_AS(frame.at(keys[0]), std::out_of_range);
+
+   table<> copy = tab;
+   REQUIRE_FALSE(copy.is_row_buffered<int>());
+   tab.unbuffer_row<int>();
+   REQUIRE_FALSE(tab.is_row_buffered<int>());
+}
+
+TEST_CASE("a buffered row can grow past chunk boundaries between publishes",
+          "[table][buffered]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   tab.buffer_row<int>();
+   auto reader = tab.reader<int>();
+
+   // Starts empty, so every write below lands past the chunks the copies were created with.
+   const auto first = tab.insert_column();
+   tab.cell<int>(first) = 5;
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(3000, std::back_inserter(keys));
+   for (int round = 0; round < 3; ++round) {
+      tab.cell<int>(keys[2999]) = round;
+      tab.cell<int>(keys[static_cast<size_t>(round) * 1024]) = 100 + round;
+      tab.publish<int>();
+      const auto frame = reader.acquire();
+      REQUIRE(frame.size() == 3001);
+      REQUIRE(frame.at(first) == 5);
+      REQUIRE(frame.at(keys[2999]) == round);
+      REQUIRE(std::ranges::equal(frame.values(), tab.get_row<int>()));
+   }
+}
+
+TEST_CASE("a reader thread only ever sees whole published frames", "[table][buffered]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(10'000, std::back_inserter(keys));
+   tab.buffer_row<int>();
+   auto reader = tab.reader<int>();
+
+   // Catch2 assertions are not thread-safe, so the reader only records what it saw.
+   constexpr int FRAMES = 500;
+   bool ordered = true;
+   bool whole = true;
+   std::thread consumer([&] {
+      uint64_t last = 0;
+      while (last < FRAMES) {
+         const auto frame = reader.acquire();
+         ordered = ordered && frame.version() >= last;
+         last = frame.version();
+         const int expected = static_cast<int>(last);
+         whole = whole && std::ranges::all_of(frame.values(),
+                                              [expected](int value) { return value == expected; });
+      }
+   });
+   for (int frame = 1; frame <= FRAMES; ++frame) {
+      tab.query<int>().for_each([frame](int &value) { value = frame; });
+      tab.mark_dirty<int>(0, tab.column_count());
+      tab.publish<int>();
+   }
+   consumer.join();
+   REQUIRE(ordered);
+   REQUIRE(whole);
+}
+
+TEST_CASE("try_cell returns nullptr where cell throws", "[table][nothrow]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   tab.create_row<float, sparse_storage>();
+   const auto a = tab.insert_column();
+   const auto b = tab.insert_column();
+   tab.add_cell<float>(a, 1.5F);
+   tab.track_dirty<int>();
+
+   static_assert(noexcept(tab.try_cell<int>(a)));
+   *tab.try_cell<int>(b) = 3;
+   REQUIRE(tab.cell<int>(b) == 3);
+   REQUIRE(tab.is_dirty<int>(b));
+   REQUIRE(*std::as_const(tab).try_cell<float>(a) == 1.5F);
+   REQUIRE(tab.try_cell<float>(b) == nullptr);
+   REQUIRE(tab.try_cell<double>(a) == nullptr);
+   tab.erase_column(a);
+   REQUIRE(tab.try_cell<int>(a) == nullptr);
+
+   REQUIRE(tab.find_row_untyped(getTypeID<int>()) == &tab.get_row_untyped(getTypeID<int>()));
+   REQUIRE(tab.find_row_untyped(getTypeID<float>()) == nullptr);
+}
+
+TEST_CASE("reserve_columns keeps column inserts from reallocating", "[table][capacity]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   tab.reserve_columns(64);
+   REQUIRE(tab.column_capacity() >= 64);
+
+   // Rows created after the reservation are pre-sized as well.
+   (void)tab.create_row<double>();
+   REQUIRE(tab.column_capacity() >= 64);
+
+   const int *intCells = tab.get_row<int>().data();
+   const double *doubleCells = tab.get_row<double>().data();
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(40, std::back_inserter(keys));
+   for (int i = 0; i < 24; ++i) { keys.push_back(tab.insert_column()); }
+   REQUIRE(tab.column_count() == 64);
+   REQUIRE(tab.get_row<int>().data() == intCells);
+   REQUIRE(tab.get_row<double>().data() == doubleCells);
+
+   // Reserving less than what is held never shrinks.
+   tab.reserve_columns(8);
+   REQUIRE(tab.column_capacity() >= 64);
+}
+
+TEST_CASE("shrink_to_fit releases spare column capacity", "[table][capacity]") {
+   table<> tab;
+   (void)tab.create_row<int>();
+   tab.create_row<float, sparse_storage>();
+   tab.reserve_columns(1000);
+   std::vector<table<>::column_key> keys;
+   tab.insert_columns(10, std::back_inserter(keys));
+   tab.add_cell<float>(keys[3], 2.5F);
+   for (size_t i = 0; i < keys.size(); ++i) { tab.cell<int>(keys[i]) = static_cast<int>(i); }
+   const size_t reserved = tab.memory_usage();
+
+   tab.shrink_to_fit();
+   REQUIRE(tab.column_capacity() == 10);
+   REQUIRE(tab.memory_usage() < reserved);
+   for (size_t i = 0; i < keys.size(); ++i) { REQUIRE(tab.cell<int>(keys[i]) == int(i)); }
+   REQUIRE(tab.cell<float>(keys[3]) == 2.5F);
+
+   // The reservation for future rows is dropped too.
+   (void)tab.create_row<double>();
+   REQUIRE(tab.memory_usage<double>() == 10 * sizeof(double));
+}
+
+TEST_CASE("memory_usage reports per-row and total storage", "[table][capacity]") {
+   table<> tab;
+   REQUIRE(tab.memory_usage<int>() == 0);
+   (void)tab.create_row<int>();
+   (void)tab.create_row<uint64_t>();
+   std::vector<table<>::column_key> keys;
+   tab.reserve_columns(100);
+   tab.insert_columns(100, std::back_inserter(keys));
+
+   REQUIRE(tab.memory_usage<int>() == 100 * sizeof(int));
+   REQUIRE(tab.memory_usage<uint64_t>() == 100 * sizeof(uint64_t));
+   // The column mapping accounts for the rest.
+   REQUIRE(tab.memory_usage() > tab.memory_usage<int>() + tab.memory_usage<uint64_t>());
+
+   // Trackers attached to a row count towards it.
+   tab.track_dirty<int>();
+   tab.track_hashes<int>();
+   REQUIRE(tab.memory_usage<int>() > 100 * sizeof(int));
+   REQUIRE(tab.memory_usage<uint64_t>() == 100 * sizeof(uint64_t));
+}
+
+namespace {
+
+/// Two tables given the same columns from one insert sequence, so their keys agree.
+struct joined_tables {
+   explicit joined_tables(size_t count) {
+      (void)physics.create_row<float>();
+      (void)gameplay.create_row<int>();
+      (void)gameplay.create_row<float>();
+      physics.insert_columns(count, std::back_inserter(keys));
+      std::vector<table<>::column_key> mirrored;
+      gameplay.insert_columns(count, std::back_inserter(mirrored));
+      REQUIRE(mirrored == keys);
+      for (size_t i = 0; i < count; ++i) {
+         physics.cell<float>(keys[i]) = static_cast<float>(i);
+         gameplay.cell<int>(keys[i]) = static_cast<int>(i) * 10;
+         gameplay.cell<float>(keys[i]) = -1.0F;
+      }
+   }
+
+   table<> physics;
+   table<> gameplay;
+   std::vector<table<>::column_key> keys;
+};
+
+} // namespace
+
+TEST_CASE("join visits exactly the columns both tables hold", "[table][join]") {
+   joined_tables tables(100);
+   // Drop every third column from gameplay and reorder it, so the dense orders differ.
+   for (size_t i = 0; i < tables.keys.size(); i += 3) {
+      REQUIRE(tables.gameplay.erase_column(tables.keys[i]));
+   }
+   tables.gameplay.sort_columns<int>(std::greater<> {});
+
+   std::vector<table<>::column_key> visited;
+   join(tables.physics, tables.gameplay)
+       .query<float, int>()
+       .for_each([&](table<>::column_key key, float &f, int &i) {
+          // float comes from the left table even though both tables have that row.
+          REQUIRE(i == static_cast<int>(f) * 10);
+          visited.push_back(key);
+       });
+   REQUIRE(visited.size() == 66);
+   for (const auto key : visited) { REQUIRE(tables.gameplay.contains_column(key)); }
+
+   // Either argument order finds the same columns; the smaller table drives.
+   size_t count = 0;
+   auto flipped = join(std::as_const(tables.gameplay), std::as_const(tables.physics));
+   auto query = flipped.query<int, float>();
+   REQUIRE(query.driver_size() == 66);
+   query.for_each([&](const int &, const float &f) {
+      REQUIRE(f == -1.0F);
+      ++count;
+   });
+   REQUIRE(count == 66);
+}
+
+TEST_CASE("join iterator matches for_each", "[table][join]") {
+   joined_tables tables(50);
+   for (size_t i = 0; i < tables.keys.size(); i += 2) {
+      REQUIRE(tables.physics.erase_column(tables.keys[i]));
+   }
+   auto query = join(tables.physics, tables.gameplay).query<int, float>();
+
+   std::vector<table<>::column_key> fromLoop;
+   query.for_each([&](table<>::column_key key, int &, float &) { fromLoop.push_back(key); });
+   std::vector<table<>::column_key> fromIter;
+   for (auto [key, i, f] : query) {
+      f += 1.0F;
+      fromIter.push_back(key);
+   }
+   REQUIRE(fromIter == fromLoop);
+   REQUIRE(fromIter.size() == 25);
+   for (const auto key : fromIter) { REQUIRE(tables.physics.cell<float>(key) > 0.0F); }
+
+   // Writes went to the left table's float row, not the right one's.
+   REQUIRE(tables.gameplay.cell<float>(fromIter.front()) == -1.0F);
+}
+
+TEST_CASE("join rejects rows neither table has", "[table][join]") {
+   joined_tables tables(4);
+   REQUIRE_THROWS_AS((join(tables.physics, tables.gameplay).query<int, double>()),
+                     std::out_of_range);
+
+   table<> empty;
+   (void)empty.create_row<int>();
+   size_t count = 0;
+   join(tables.physics, empty).query<float, int>().for_each([&](float &, int &) { ++count; });
+   REQUIRE(count == 0);
+   auto query = join(empty, tables.physics).query<float>();
+   REQUIRE(query.begin() == query.end());
+}
+
 // NOLINTEND
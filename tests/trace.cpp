@@ -0,0 +1,115 @@
+// NOLINTBEGIN
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "trutils/sparse_set.hpp"
+#include "trutils/stack_alloc.hpp"
+#include "trutils/table.hpp"
+#include "trutils/trace.hpp"
+
+using namespace tr;
+
+namespace {
+
+struct recorded_events {
+   std::vector<std::string> zones;
+   std::vector<std::string> counters;
+   int depth = 0;
+   int maxDepth = 0;
+   int64_t lastColumns = -1;
+};
+
+/// Installs hooks recording into @p events for the lifetime of the guard.
+struct recording_guard {
+   explicit recording_guard(recorded_events &events) {
+      trace_hooks hooks;
+      hooks.zone_begin = [](const char *name, void *user) {
+         auto &rec = *static_cast<recorded_events *>(user);
+         rec.zones.emplace_back(name);
+         rec.maxDepth = std::max(rec.maxDepth, ++rec.depth);
+      };
+      hooks.zone_end = [](const char *, void *user) {
+         --static_cast<recorded_events *>(user)->depth;
+      };
+      hooks.counter = [](const char *name, int64_t value, void *user) {
+         auto &rec = *static_cast<recorded_events *>(user);
+         rec.counters.emplace_back(name);
+         if (std::string(name) == "table::columns") { rec.lastColumns = value; }
+      };
+      hooks.user = &events;
+      set_trace_hooks(hooks);
+   }
+   ~recording_guard() { set_trace_hooks({}); }
+};
+
+[[maybe_unused]] bool contains(const std::vector<std::string> &names, const std::string &name) {
+   return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+} // namespace
+
+TEST_CASE("structural mutations and reallocations emit trace events", "[trace]") {
+   recorded_events events;
+   {
+      recording_guard guard(events);
+      table<> tab;
+      (void)tab.create_row<int>();
+      (void)tab.create_row<float>();
+      std::vector<table<>::column_key> keys;
+      tab.insert_columns(100, std::back_inserter(keys));
+      (void)tab.insert_column();
+      tab.erase_column(keys[0]);
+
+      StackAlloc<256> alloc;
+      for (int i = 0; i < 8; ++i) { (void)alloc.allocate(100); }
+      (void)alloc.allocate(1024);
+   }
+
+#if TR_TRACE
+   REQUIRE(contains(events.zones, "table::create_row"));
+   REQUIRE(contains(events.zones, "table::insert_columns"));
+   REQUIRE(contains(events.zones, "table::erase_column"));
+   REQUIRE(contains(events.zones, "untyped_vector::reallocate"));
+   REQUIRE(contains(events.zones, "SparseSet::grow"));
+   REQUIRE(contains(events.zones, "open_addressing_index::rehash"));
+   REQUIRE(contains(events.zones, "StackAlloc::spill"));
+   REQUIRE(contains(events.zones, "StackAlloc::allocate_large"));
+   REQUIRE(contains(events.counters, "StackAlloc::blocks"));
+   REQUIRE(events.lastColumns == 100);
+   // Reallocations nest inside the table zone that caused them, and every zone was closed.
+   REQUIRE(events.maxDepth >= 2);
+   REQUIRE(events.depth == 0);
+#else
+   REQUIRE(events.zones.empty());
+   REQUIRE(events.counters.empty());
+#endif
+}
+
+TEST_CASE("tracing leaves SparseSet growth to std::vector", "[trace]") {
+   recorded_events events;
+   recording_guard guard(events);
+   SparseSet<> set;
+   std::vector<Key<DefaultTag>::ID> reference;
+   for (int i = 0; i < 1000; ++i) {
+      (void)set.insert();
+      reference.push_back(0);
+      REQUIRE(set.capacity() == reference.capacity());
+   }
+}
+
+TEST_CASE("no events reach removed hooks", "[trace]") {
+   recorded_events events;
+   { recording_guard guard(events); }
+   table<> tab;
+   (void)tab.create_row<int>();
+   (void)tab.insert_column();
+   REQUIRE(events.zones.empty());
+   REQUIRE(events.counters.empty());
+}
+
+// NOLINTEND
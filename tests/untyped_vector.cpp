@@ -2,7 +2,13 @@
 #include "trutils/untyped_vector.hpp"
 
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace tr;
 
@@ -198,4 +204,287 @@ TEST_CASE("untyped_vector erase without element type at call site", "[untyped_ve
    REQUIRE_THROWS_AS(vec.swap_and_pop(0), std::out_of_range);
 }
 
+TEST_CASE("untyped_vector bulk push_back_default", "[untyped_vector]") {
+   untyped_vector vec(getTypeInfo<AlignedType>());
+   vec.push_back<AlignedType>({7});
+   vec.push_back_default(0);
+   REQUIRE(vec.size() == 1);
+   vec.push_back_default(13);
+   REQUIRE(vec.size() == 14);
+   REQUIRE(vec.at<AlignedType>(0).value == 7);
+   for (size_t i = 1; i < vec.size(); ++i) { REQUIRE(vec.at<AlignedType>(i).value == 0); }
+}
+
+TEST_CASE("untyped_vector batched swap_and_pop", "[untyped_vector][erase]") {
+   untyped_vector batched(getTypeInfo<int>());
+   untyped_vector sequential(getTypeInfo<int>());
+   for (int i = 0; i < 6; ++i) {
+      batched.push_back<int>(i);
+      sequential.push_back<int>(i);
+   }
+
+   const std::vector<size_t> indices {1, 4, 0};
+   batched.swap_and_pop(indices);
+   for (size_t idx : indices) { sequential.swap_and_pop(idx); }
+
+   REQUIRE(batched.size() == 3);
+   for (size_t i = 0; i < batched.size(); ++i) {
+      REQUIRE(batched.at<int>(i) == sequential.at<int>(i));
+   }
+
+   const std::vector<size_t> bad {0, 2};
+   REQUIRE_THROWS_AS(batched.swap_and_pop(bad), std::out_of_range);
+   REQUIRE(batched.size() == 2);
+}
+
+TEST_CASE("untyped_vector unchecked accessors and typed_view", "[untyped_vector][unchecked]") {
+   untyped_vector vec(getTypeInfo<int>());
+   for (int i = 0; i < 4; ++i) { vec.push_back<int>(i); }
+
+   REQUIRE(vec.unchecked_at<int>(2) == 2);
+   vec.unchecked_data<int>()[3] = 30;
+   REQUIRE(vec.at<int>(3) == 30);
+
+   auto view = vec.view<int>();
+   REQUIRE(view.size() == 4);
+   view[0] = 10;
+   vec.push_back<int>(4); // Views survive reallocation.
+   REQUIRE(view.size() == 5);
+   REQUIRE(view[0] == 10);
+   int sum = 0;
+   for (const int v : view) { sum += v; }
+   REQUIRE(sum == 10 + 1 + 2 + 30 + 4);
+
+   const untyped_vector &cvec = vec;
+   auto cview = cvec.view<int>();
+   static_assert(std::is_same_v<decltype(cview[0]), const int &>);
+   REQUIRE(cview.span().size() == 5);
+
+   REQUIRE_THROWS_AS(vec.view<double>(), std::runtime_error);
+#if TR_DEBUG_CHECKS
+   REQUIRE_THROWS_AS(vec.unchecked_at<double>(0), std::runtime_error);
+   REQUIRE_THROWS_AS(vec.unchecked_at<int>(5), std::out_of_range);
+   REQUIRE_THROWS_AS(view[5], std::out_of_range);
+#endif
+}
+
+struct alignas(64) CacheLineType {
+   float lanes[16];
+};
+
+TEST_CASE("untyped_vector honours over-alignment", "[untyped_vector][alignment]") {
+   untyped_vector vec(getTypeInfo<CacheLineType>());
+   for (int i = 0; i < 9; ++i) { vec.push_back_default(); }
+   REQUIRE(reinterpret_cast<std::uintptr_t>(vec.data<CacheLineType>().data()) % 64 == 0);
+   vec.at<CacheLineType>(8).lanes[15] = 1.0F;
+   vec.reserve(100);
+   REQUIRE(reinterpret_cast<std::uintptr_t>(vec.data<CacheLineType>().data()) % 64 == 0);
+   REQUIRE(vec.at<CacheLineType>(8).lanes[15] == 1.0F);
+}
+
+TEST_CASE("untyped_vector allocates from a memory resource", "[untyped_vector][pmr]") {
+   std::byte arena[1024];
+   std::pmr::monotonic_buffer_resource resource(arena, sizeof(arena),
+                                                std::pmr::null_memory_resource());
+   untyped_vector vec(getTypeInfo<int>(), &resource);
+   REQUIRE(vec.resource() == &resource);
+   for (int i = 0; i < 32; ++i) { vec.push_back<int>(i); }
+   const auto *first = reinterpret_cast<const std::byte *>(vec.data<int>().data());
+   REQUIRE(first >= arena);
+   REQUIRE(first < arena + sizeof(arena));
+
+   untyped_vector copy = vec;
+   REQUIRE(copy.resource() == &resource);
+   REQUIRE(copy.at<int>(31) == 31);
+
+   untyped_vector moved = std::move(copy);
+   REQUIRE(moved.resource() == &resource);
+   REQUIRE(moved.size() == 32);
+   REQUIRE(copy.empty());
+}
+
+TEST_CASE("untyped_vector uninitialized growth", "[untyped_vector]") {
+   untyped_vector vec(getTypeInfo<int>());
+   vec.push_back<int>(1);
+   auto bytes = vec.append_uninitialized(3);
+   REQUIRE(bytes.size() == 3 * sizeof(int));
+   const int values[3] {2, 3, 4};
+   std::memcpy(bytes.data(), values, sizeof(values));
+   REQUIRE(vec.size() == 4);
+   REQUIRE(vec.at<int>(3) == 4);
+
+   vec.resize_uninitialized(2);
+   REQUIRE(vec.size() == 2);
+   REQUIRE(vec.at<int>(1) == 2);
+   vec.resize_uninitialized(10);
+   REQUIRE(vec.size() == 10);
+   REQUIRE(vec.capacity() >= 10);
+   REQUIRE(vec.at<int>(0) == 1);
+}
+
+template<size_t N>
+struct Bytes {
+   unsigned char b[N];
+};
+
+template<size_t N>
+void check_swap_of_size() {
+   untyped_vector vec(getTypeInfo<Bytes<N>>());
+   Bytes<N> x {};
+   Bytes<N> y {};
+   for (size_t i = 0; i < N; ++i) {
+      x.b[i] = static_cast<unsigned char>(i);
+      y.b[i] = static_cast<unsigned char>(255 - i);
+   }
+   vec.push_back<Bytes<N>>(x);
+   vec.push_back<Bytes<N>>(y);
+   vec.swap(0, 1);
+   REQUIRE(std::memcmp(&vec.at<Bytes<N>>(0), &y, N) == 0);
+   REQUIRE(std::memcmp(&vec.at<Bytes<N>>(1), &x, N) == 0);
+}
+
+TEST_CASE("untyped_vector swap across slot sizes", "[untyped_vector][swap]") {
+   check_swap_of_size<1>();
+   check_swap_of_size<4>();
+   check_swap_of_size<8>();
+   check_swap_of_size<12>();
+   check_swap_of_size<16>();
+   check_swap_of_size<32>();
+   check_swap_of_size<64>();
+   check_swap_of_size<100>();
+   check_swap_of_size<200>();
+
+   untyped_vector vec(getTypeInfo<int>());
+   vec.push_back<int>(1);
+   REQUIRE_THROWS_AS(vec.swap(0, 1), std::out_of_range);
+}
+
+TEST_CASE("untyped_vector gather and scatter", "[untyped_vector][gather]") {
+   untyped_vector vec(getTypeInfo<int>());
+   for (int i = 0; i < 5; ++i) { vec.push_back<int>(i * 10); }
+
+   const std::vector<size_t> perm {3, 0, 4, 1, 2};
+   vec.gather(perm);
+   REQUIRE(vec.size() == 5);
+   for (size_t k = 0; k < perm.size(); ++k) {
+      REQUIRE(vec.at<int>(k) == static_cast<int>(perm[k]) * 10);
+   }
+
+   vec.scatter(perm);
+   for (int i = 0; i < 5; ++i) { REQUIRE(vec.at<int>(static_cast<size_t>(i)) == i * 10); }
+
+   const std::vector<size_t> keep {4, 4, 1};
+   vec.gather(keep);
+   REQUIRE(vec.size() == 3);
+   REQUIRE(vec.at<int>(0) == 40);
+   REQUIRE(vec.at<int>(1) == 40);
+   REQUIRE(vec.at<int>(2) == 10);
+
+   const std::vector<size_t> bad {0, 3};
+   REQUIRE_THROWS_AS(vec.gather(bad), std::out_of_range);
+   REQUIRE_THROWS_AS(vec.scatter(bad), std::out_of_range);
+   REQUIRE(vec.size() == 3);
+   REQUIRE(vec.at<int>(2) == 10);
+
+   // Duplicates would leave a slot of the new buffer unwritten.
+   const std::vector<size_t> duplicate {0, 0, 2};
+   REQUIRE_THROWS_AS(vec.scatter(duplicate), std::invalid_argument);
+   REQUIRE(vec.at<int>(0) == 40);
+   REQUIRE(vec.at<int>(1) == 40);
+   REQUIRE(vec.at<int>(2) == 10);
+}
+
+TEST_CASE("untyped_vector kernel-driven bulk operations", "[untyped_vector][kernels]") {
+   struct pod {
+      int16_t a;
+      int8_t b;
+   };
+   REQUIRE(getTypeInfo<int>().kernels == &gTypeKernels<int>);
+   REQUIRE(getTypeInfo<pod>().kernels != nullptr);
+
+   untyped_vector ints(getTypeInfo<int>());
+   ints.resize<int>(100);
+   const int seven = 7;
+   ints.fill(&seven);
+   for (const int v : ints.data<int>()) { REQUIRE(v == 7); }
+
+   untyped_vector copy(getTypeInfo<int>());
+   copy.assign_elements(ints);
+   REQUIRE(copy.size() == 100);
+   REQUIRE(copy.mismatch(ints) == 100);
+   REQUIRE(copy.hash() == ints.hash());
+   REQUIRE(copy.hash(1) != ints.hash());
+   copy.at<int>(42) = -3;
+   REQUIRE(copy.mismatch(ints) == 42);
+   REQUIRE(copy.hash() != ints.hash());
+
+   // Integer deltas are wrapping differences; equal cells encode to zero.
+   copy.delta_encode(ints);
+   REQUIRE(copy.at<int>(0) == 0);
+   REQUIRE(copy.at<int>(42) == -10);
+   copy.delta_decode(ints);
+   REQUIRE(copy.at<int>(42) == -3);
+   REQUIRE(copy.mismatch(ints) == 42);
+
+   untyped_vector floats(getTypeInfo<float>());
+   floats.push_back<float>(0.0F);
+   untyped_vector negZero(getTypeInfo<float>());
+   negZero.push_back<float>(-0.0F);
+   REQUIRE(floats.mismatch(negZero) == 1);
+   REQUIRE(floats.hash() == negZero.hash());
+
+   untyped_vector baseFloats(getTypeInfo<float>());
+   baseFloats.push_back<float>(1.5F);
+   floats.at<float>(0) = 2.25F;
+   floats.delta_encode(baseFloats);
+   floats.delta_decode(baseFloats);
+   REQUIRE(floats.at<float>(0) == 2.25F);
+
+   untyped_vector pods(getTypeInfo<pod>());
+   pods.resize<pod>(3, pod {1, 2});
+   untyped_vector podCopy(getTypeInfo<pod>());
+   podCopy.assign_elements(pods);
+   REQUIRE(podCopy.mismatch(pods) == 3);
+   podCopy.delta_encode(pods);
+   REQUIRE(podCopy.at<pod>(1).a == 0);
+
+   REQUIRE_THROWS_AS(ints.assign_elements(floats), std::runtime_error);
+   REQUIRE_THROWS_AS(ints.mismatch(floats), std::runtime_error);
+   REQUIRE_THROWS_AS(ints.delta_encode(untyped_vector(getTypeInfo<int>())), std::invalid_argument);
+
+   ty_info bare = getTypeInfo<int>();
+   bare.kernels = nullptr;
+   untyped_vector opaque(bare);
+   REQUIRE_THROWS_AS(opaque.hash(), std::runtime_error);
+   REQUIRE_THROWS_AS(opaque.fill(&seven), std::runtime_error);
+
+   untyped_vector empty(getTypeInfo<int>());
+   REQUIRE(empty.hash() == untyped_vector(getTypeInfo<int>()).hash());
+   REQUIRE(empty.mismatch(ints) == 0);
+}
+
+TEST_CASE("untyped_vector try_at returns nullptr on misses", "[untyped_vector][nothrow]") {
+   untyped_vector ints(getTypeInfo<int>());
+   ints.push_back<int>(4);
+   static_assert(noexcept(ints.try_at<int>(0)));
+   REQUIRE(*ints.try_at<int>(0) == 4);
+   REQUIRE(ints.try_at<int>(1) == nullptr);
+   REQUIRE(ints.try_at<float>(0) == nullptr);
+   REQUIRE(std::as_const(ints).try_at<int>(0) == &ints.at<int>(0));
+}
+
+TEST_CASE("untyped_vector rejects a type whose layout changed", "[untyped_vector][borrow]") {
+   // What a snapshot row looks like after its struct grew under the same name: the id matches,
+   // but the file's element size does not.
+   ty_info info = getTypeInfo<int>();
+   info.size = 8;
+   info.alignment = 8;
+   alignas(8) std::byte storage[16] {};
+   const auto vec = untyped_vector::borrow(info, storage);
+   REQUIRE(vec.size() == 2);
+   REQUIRE_THROWS_AS(vec.at<int>(0), std::runtime_error);
+   REQUIRE_THROWS_AS(vec.data<int>(), std::runtime_error);
+   REQUIRE(vec.try_at<int>(0) == nullptr);
+}
+
 // NOLINTEND
\ No newline at end of file
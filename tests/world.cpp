@@ -0,0 +1,162 @@
+// NOLINTBEGIN
+
+#include "trutils/world.hpp"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace tr;
+
+namespace {
+
+struct position {
+   float x, y;
+};
+
+struct velocity {
+   float dx, dy;
+};
+
+struct health {
+   int32_t hp;
+};
+
+} // namespace
+
+TEST_CASE("world moves entities between archetypes on add and remove", "[world]") {
+   world<> w;
+   REQUIRE(w.archetype_count() == 1);
+
+   const auto a = w.create();
+   const auto b = w.create();
+   REQUIRE(w.size() == 2);
+   REQUIRE(w.alive(a));
+   REQUIRE_FALSE(w.has<position>(a));
+
+   w.add<position>(a, {1.0F, 2.0F});
+   w.add<velocity>(a, {3.0F, 4.0F});
+   w.add<position>(b, {5.0F, 6.0F});
+   REQUIRE(w.archetype_count() == 3);
+   REQUIRE(w.has<position>(a));
+   REQUIRE(w.has<velocity>(a));
+   REQUIRE_FALSE(w.has<velocity>(b));
+   REQUIRE(w.get<position>(a).y == 2.0F);
+   REQUIRE(w.get<velocity>(a).dx == 3.0F);
+   REQUIRE(w.get<position>(b).x == 5.0F);
+   REQUIRE_THROWS_AS(w.get<velocity>(b), std::out_of_range);
+   REQUIRE_THROWS_AS(w.add<position>(a), std::invalid_argument);
+
+   // The same transition reuses the cached edge and archetype.
+   w.add<velocity>(b, {7.0F, 8.0F});
+   REQUIRE(w.archetype_count() == 3);
+   REQUIRE(w.get<position>(b).x == 5.0F);
+
+   REQUIRE(w.remove<position>(a));
+   REQUIRE_FALSE(w.remove<position>(a));
+   REQUIRE(w.archetype_count() == 4);
+   REQUIRE(w.get<velocity>(a).dy == 4.0F);
+   REQUIRE(w.get<position>(b).y == 6.0F);
+
+   // Adding back lands in the existing {position, velocity} archetype, whatever the order.
+   w.add<position>(a, {9.0F, 9.0F});
+   REQUIRE(w.archetype_count() == 4);
+   REQUIRE(w.get<position>(a).x == 9.0F);
+
+   REQUIRE(w.destroy(a));
+   REQUIRE_FALSE(w.destroy(a));
+   REQUIRE_FALSE(w.alive(a));
+   REQUIRE(w.size() == 1);
+   REQUIRE_THROWS_AS(w.get<position>(a), std::out_of_range);
+   REQUIRE_THROWS_AS(w.add<health>(a), std::out_of_range);
+   REQUIRE(w.get<velocity>(b).dx == 7.0F);
+}
+
+TEST_CASE("world queries visit only matching archetypes", "[world][query]") {
+   world<> w;
+   std::vector<world<>::entity> movers;
+   for (int i = 0; i < 100; ++i) {
+      const auto e = w.create();
+      w.add<position>(e, {static_cast<float>(i), 0.0F});
+      if (i % 3 == 0) {
+         w.add<velocity>(e, {1.0F, 2.0F});
+         movers.push_back(e);
+      }
+      if (i % 5 == 0) { w.add<health>(e, {i}); }
+   }
+
+   REQUIRE(w.count<position>() == 100);
+   REQUIRE(w.count<velocity>() == movers.size());
+   REQUIRE(w.count<velocity, position>() == movers.size());
+   REQUIRE(w.count<velocity, health>() == 7);
+   REQUIRE(w.count<>() == 100);
+
+   w.for_each<position, velocity>([](position &p, const velocity &v) {
+      p.x += v.dx;
+      p.y += v.dy;
+   });
+
+   std::vector<world<>::entity> visited;
+   w.for_each<velocity, position>([&](world<>::entity e, velocity &, position &p) {
+      visited.push_back(e);
+      REQUIRE(p.y == 2.0F);
+   });
+   REQUIRE(visited.size() == movers.size());
+   for (const auto e : movers) {
+      REQUIRE(std::find(visited.begin(), visited.end(), e) != visited.end());
+      REQUIRE(w.get<position>(e).y == 2.0F);
+   }
+
+   const auto &cw = w;
+   int total = 0;
+   cw.for_each<health>([&](const health &h) { total += h.hp; });
+   REQUIRE(total == 950);
+
+   // The cache picks up archetypes created after the first query.
+   const auto matched = w.matching<velocity>().size();
+   struct tag {
+      int32_t value;
+   };
+   w.add<tag>(movers.front(), {1});
+   REQUIRE(w.matching<velocity>().size() == matched + 1);
+   REQUIRE(w.count<velocity>() == movers.size());
+}
+
+TEST_CASE("table move_column carries shared rows", "[table][move_column]") {
+   table<> src;
+   table<> dst;
+   (void)src.create_row<int>();
+   (void)src.create_row<float>();
+   (void)dst.create_row<int>();
+   dst.create_row(getTypeInfo<double>());
+   REQUIRE_THROWS_AS(dst.create_row(getTypeInfo<double>()), std::invalid_argument);
+
+   const auto k0 = src.insert_column();
+   const auto k1 = src.insert_column();
+   src.cell<int>(k0) = 10;
+   src.cell<int>(k1) = 11;
+   src.cell<float>(k1) = 1.5F;
+
+   const auto moved = src.move_column(k0, dst);
+   REQUIRE_FALSE(src.contains_column(k0));
+   REQUIRE(src.column_count() == 1);
+   REQUIRE(src.cell<int>(k1) == 11);
+   REQUIRE(dst.cell<int>(moved) == 10);
+   REQUIRE(dst.cell<double>(moved) == 0.0);
+   REQUIRE_THROWS_AS(src.move_column(k0, dst), std::out_of_range);
+   REQUIRE_THROWS_AS(src.move_column(k1, src), std::invalid_argument);
+
+   untyped_vector ints(getTypeInfo<int>());
+   untyped_vector floats(getTypeInfo<float>());
+   ints.push_back<int>(1);
+   ints.push_back<int>(2);
+   floats.push_back<float>(1.0F);
+   ints.copy_from(0, ints, 1);
+   REQUIRE(ints.at<int>(0) == 2);
+   REQUIRE_THROWS_AS(ints.copy_from(0, floats, 0), std::runtime_error);
+   REQUIRE_THROWS_AS(ints.copy_from(2, ints, 0), std::out_of_range);
+}
+
+// NOLINTEND